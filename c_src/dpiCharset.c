@@ -0,0 +1,239 @@
+#include "dpiCharset.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BLOCK 32
+#define BLOCK_ASCII_MASK(_p) \
+    _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(_p)))
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCK 16
+#define BLOCK_ASCII_MASK(_p) \
+    _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(_p)))
+#endif
+
+#if defined(BLOCK) && defined(_MSC_VER)
+#include <intrin.h>
+static unsigned ctz(unsigned mask)
+{
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned)idx;
+}
+#elif defined(BLOCK)
+#define ctz(_mask) ((unsigned)__builtin_ctz(_mask))
+#endif
+
+// number of ASCII bytes at the start of s
+static size_t ascii_prefix(const unsigned char *s, size_t len)
+{
+    size_t i = 0;
+
+#ifdef BLOCK
+    for (; i + BLOCK <= len; i += BLOCK)
+    {
+        unsigned mask = (unsigned)BLOCK_ASCII_MASK(s + i);
+        if (mask)
+            return i + ctz(mask);
+    }
+#endif
+    while (i < len && s[i] < 0x80)
+        i++;
+
+    return i;
+}
+
+/*******************************************************************************
+ * Charset tables
+ ******************************************************************************/
+
+// 0x81, 0x8D, 0x8F, 0x90 and 0x9D are unassigned and map to the C1 controls
+// like in MultiByteToWideChar
+const dpiCharsetTable dpiCharset_we8mswin1252 = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+    0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+    0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+    0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+    0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+    0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+    0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+    0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+    0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+    0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+    0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+    0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+    0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF};
+
+const dpiCharsetTable dpiCharset_we8iso8859p1 = {
+    0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087,
+    0x0088, 0x0089, 0x008A, 0x008B, 0x008C, 0x008D, 0x008E, 0x008F,
+    0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097,
+    0x0098, 0x0099, 0x009A, 0x009B, 0x009C, 0x009D, 0x009E, 0x009F,
+    0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+    0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+    0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+    0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+    0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+    0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+    0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+    0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+    0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+    0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+    0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+    0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF};
+
+/*******************************************************************************
+ * UTF-8 validation
+ ******************************************************************************/
+
+/*
+ * validates the multi byte sequence starting at s[i], returns its length or
+ * 0 if it is malformed
+ */
+static size_t utf8_sequence(const unsigned char *s, size_t i, size_t len)
+{
+    unsigned char c = s[i];
+
+    if (c >= 0xC2 && c <= 0xDF)
+    {
+        if (i + 1 < len && (s[i + 1] & 0xC0) == 0x80)
+            return 2;
+    }
+    else if (c >= 0xE0 && c <= 0xEF)
+    {
+        // E0 needs A0-BF (no overlongs), ED 80-9F (no surrogates)
+        unsigned char lo = c == 0xE0 ? 0xA0 : 0x80,
+                      hi = c == 0xED ? 0x9F : 0xBF;
+        if (i + 2 < len && s[i + 1] >= lo && s[i + 1] <= hi &&
+            (s[i + 2] & 0xC0) == 0x80)
+            return 3;
+    }
+    else if (c >= 0xF0 && c <= 0xF4)
+    {
+        // F0 needs 90-BF (no overlongs), F4 80-8F (max U+10FFFF)
+        unsigned char lo = c == 0xF0 ? 0x90 : 0x80,
+                      hi = c == 0xF4 ? 0x8F : 0xBF;
+        if (i + 3 < len && s[i + 1] >= lo && s[i + 1] <= hi &&
+            (s[i + 2] & 0xC0) == 0x80 && (s[i + 3] & 0xC0) == 0x80)
+            return 4;
+    }
+
+    return 0;
+}
+
+int dpiCharset_isUtf8Scalar(const unsigned char *s, size_t len)
+{
+    size_t i = 0, n;
+
+    while (i < len)
+    {
+        if (s[i] < 0x80)
+            i++;
+        else if ((n = utf8_sequence(s, i, len)))
+            i += n;
+        else
+            return 0;
+    }
+
+    return 1;
+}
+
+int dpiCharset_isUtf8(const unsigned char *s, size_t len)
+{
+    size_t i = 0, n;
+
+    while ((i += ascii_prefix(s + i, len - i)) < len)
+    {
+        if (!(n = utf8_sequence(s, i, len)))
+            return 0;
+        i += n;
+    }
+
+    return 1;
+}
+
+/*******************************************************************************
+ * Single byte charsets to UTF-8
+ ******************************************************************************/
+
+#define UTF8_LENGTH(_cp) ((_cp) < 0x80 ? 1 : (_cp) < 0x800 ? 2 : 3)
+
+static unsigned char *utf8_put(unsigned char *out, uint16_t cp)
+{
+    if (cp < 0x80)
+        *out++ = (unsigned char)cp;
+    else if (cp < 0x800)
+    {
+        *out++ = (unsigned char)(0xC0 | (cp >> 6));
+        *out++ = (unsigned char)(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        *out++ = (unsigned char)(0xE0 | (cp >> 12));
+        *out++ = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = (unsigned char)(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+size_t dpiCharset_sbToUtf8LengthScalar(
+    const dpiCharsetTable table, const unsigned char *s, size_t len)
+{
+    size_t outLen = 0;
+
+    for (size_t i = 0; i < len; i++)
+        outLen += s[i] < 0x80 ? 1 : UTF8_LENGTH(table[s[i] - 0x80]);
+
+    return outLen;
+}
+
+size_t dpiCharset_sbToUtf8Length(
+    const dpiCharsetTable table, const unsigned char *s, size_t len)
+{
+    size_t i = 0, outLen = 0, n;
+
+    while (i < len)
+    {
+        n = ascii_prefix(s + i, len - i);
+        outLen += n;
+        if ((i += n) < len)
+        {
+            uint16_t cp = table[s[i++] - 0x80];
+            outLen += UTF8_LENGTH(cp);
+        }
+    }
+
+    return outLen;
+}
+
+void dpiCharset_sbToUtf8Scalar(
+    const dpiCharsetTable table, const unsigned char *s, size_t len,
+    unsigned char *out)
+{
+    for (size_t i = 0; i < len; i++)
+        out = s[i] < 0x80 ? (*out = s[i], out + 1)
+                          : utf8_put(out, table[s[i] - 0x80]);
+}
+
+void dpiCharset_sbToUtf8(
+    const dpiCharsetTable table, const unsigned char *s, size_t len,
+    unsigned char *out)
+{
+    size_t i = 0, n;
+
+    while (i < len)
+    {
+        // runs of ASCII are copied as they are
+        n = ascii_prefix(s + i, len - i);
+        memcpy(out, s + i, n);
+        out += n;
+        if ((i += n) < len)
+            out = utf8_put(out, table[s[i++] - 0x80]);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef _DPICHARSET_H_
+#define _DPICHARSET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * UTF-8 validation and single byte charset to UTF-8 transcoding of fetched
+ * strings, independent of erl_nif and ODPI-C. The block loops use AVX2 or
+ * SSE2 when the compiler targets them and skip runs of ASCII bytes 32 or 16
+ * bytes at a time, the *Scalar variants process byte by byte and are kept
+ * as the reference (see test/charset_bench.c)
+ */
+
+// per statement modes of stmt_setCharsetMode
+#define DPI_CHARSET_NONE 0
+#define DPI_CHARSET_UTF8 1
+#define DPI_CHARSET_WE8MSWIN1252 2
+#define DPI_CHARSET_WE8ISO8859P1 3
+
+// code points of the bytes 0x80 - 0xFF of a single byte charset
+typedef uint16_t dpiCharsetTable[128];
+
+extern const dpiCharsetTable dpiCharset_we8mswin1252;
+extern const dpiCharsetTable dpiCharset_we8iso8859p1;
+
+// returns 1 if s is well formed UTF-8 (no overlongs, surrogates or values
+// above U+10FFFF), 0 otherwise
+extern int dpiCharset_isUtf8(const unsigned char *s, size_t len);
+extern int dpiCharset_isUtf8Scalar(const unsigned char *s, size_t len);
+
+// size of the UTF-8 encoding of s
+extern size_t dpiCharset_sbToUtf8Length(
+    const dpiCharsetTable table, const unsigned char *s, size_t len);
+extern size_t dpiCharset_sbToUtf8LengthScalar(
+    const dpiCharsetTable table, const unsigned char *s, size_t len);
+
+// writes the UTF-8 encoding of s to out, which must be large enough
+extern void dpiCharset_sbToUtf8(
+    const dpiCharsetTable table, const unsigned char *s, size_t len,
+    unsigned char *out);
+extern void dpiCharset_sbToUtf8Scalar(
+    const dpiCharsetTable table, const unsigned char *s, size_t len,
+    unsigned char *out);
+
+#endif // _DPICHARSET_H_
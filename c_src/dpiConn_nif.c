@@ -1,29 +1,108 @@
+#ifndef __WIN32__
+#define _POSIX_C_SOURCE 200112L // nanosleep with -std=c11
+#endif
+
 #include "dpiConn_nif.h"
 #include "dpiContext_nif.h"
 #include "dpiStmt_nif.h"
 #include "dpiVar_nif.h"
 #include "dpiData_nif.h"
 #include "dpiQueryInfo_nif.h"
+#include "dpiSubscr_nif.h"
+#include "dpiObject_nif.h"
 #include "stdio.h"
+#include <string.h>
 
-ERL_NIF_TERM ATOM_encoding = 0;
-ERL_NIF_TERM ATOM_nencoding = 0;
+#ifdef __WIN32__
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 ErlNifResourceType *dpiConn_type;
 
+void oranif_sleep(uint32_t ms)
+{
+#ifdef __WIN32__
+    Sleep(ms);
+#else
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void conn_cacheClear(dpiConnCache *cache);
+static void conn_varPoolClear(ErlNifEnv *env, dpiConn_res *connRes);
+static void conn_attrsFree(dpiConnAttrs *attrs);
+
 void dpiConn_res_dtor(ErlNifEnv *env, void *resource)
 {
     CALL_TRACE;
+
+    // the health checker keeps the resource, so it isn't running here
+    dpiConn_res *connRes = (dpiConn_res *)resource;
+    if (connRes->cache)
+    {
+        conn_cacheClear(connRes->cache);
+        enif_mutex_destroy(connRes->cache->lock);
+        enif_free(connRes->cache);
+        connRes->cache = NULL;
+    }
+    if (connRes->varPool)
+    {
+        conn_varPoolClear(env, connRes);
+        enif_mutex_destroy(connRes->varPool->lock);
+        enif_free(connRes->varPool);
+        connRes->varPool = NULL;
+    }
+    if (connRes->attrs)
+    {
+        conn_attrsFree(connRes->attrs);
+        connRes->attrs = NULL;
+    }
+    if (connRes->lock)
+    {
+        enif_cond_destroy(connRes->cond);
+        enif_mutex_destroy(connRes->lock);
+        connRes->lock = NULL;
+    }
+
     RETURNED_TRACE;
 }
 
+/*
+ * string or binary param as data and length, the data is NUL terminated for
+ * ODPI-C params which don't take a length and lives as long as env
+ */
+static int conn_getStringParam(
+    ErlNifEnv *env, ERL_NIF_TERM term, const char **str, uint32_t *length)
+{
+    ErlNifBinary bin;
+    ERL_NIF_TERM copy;
+    unsigned char *data;
+
+    if (!enif_inspect_iolist_as_binary(env, term, &bin) ||
+        bin.size >= UINT32_MAX)
+        return 0;
+
+    data = enif_make_new_binary(env, bin.size + 1, &copy);
+    memcpy(data, bin.data, bin.size);
+    data[bin.size] = '\0';
+    *str = (const char *)data;
+    *length = (uint32_t)bin.size;
+
+    return 1;
+}
+
 DPI_NIF_FUN(conn_create)
 {
     CHECK_ARGCOUNT(6);
 
     dpiContext_res *contextRes;
     ErlNifBinary userName, password, connectString;
-    size_t commonParamsMapSize = 0;
+    size_t commonParamsMapSize = 0, connCreateParamsMapSize = 0;
+    uint32_t stmtCacheSize = 0, length;
+    int setStmtCacheSize = 0;
     if (!enif_get_resource(env, argv[0], dpiContext_type, (void **)&contextRes))
         BADARG_EXCEPTION(0, "resource context");
     if (!enif_inspect_binary(env, argv[1], &userName))
@@ -34,6 +113,9 @@ DPI_NIF_FUN(conn_create)
         BADARG_EXCEPTION(3, "string/binary connectString");
     if (!enif_get_map_size(env, argv[4], &commonParamsMapSize))
         BADARG_EXCEPTION(4, "map commonParams");
+    if (!enif_get_map_size(env, argv[5], &connCreateParamsMapSize) &&
+        enif_compare(argv[5], ATOM_NULL) != 0)
+        BADARG_EXCEPTION(5, "map connCreateParams");
 
     dpiCommonCreateParams commonParams;
     RAISE_EXCEPTION_ON_DPI_ERROR(
@@ -42,36 +124,137 @@ DPI_NIF_FUN(conn_create)
 
     if (commonParamsMapSize > 0)
     {
-        // lazy create
-        if (!(ATOM_encoding | ATOM_nencoding))
-        {
-            ATOM_encoding = enif_make_atom(env, "encoding");
-            ATOM_nencoding = enif_make_atom(env, "nencoding");
-        }
-
         ERL_NIF_TERM mapval;
-        char encodeStr[128];
         if (enif_get_map_value(env, argv[4], ATOM_encoding, &mapval))
         {
-            if (!enif_get_string(
-                    env, mapval, encodeStr, sizeof(encodeStr), ERL_NIF_LATIN1))
+            if (!conn_getStringParam(
+                    env, mapval, &commonParams.encoding, &length))
                 BADARG_EXCEPTION(4, "string\0 commonParams.encoding");
-            commonParams.encoding = encodeStr;
         }
 
-        char nencodeStr[128];
         if (enif_get_map_value(env, argv[4], ATOM_nencoding, &mapval))
         {
-            if (!enif_get_string(
-                    env, mapval, nencodeStr, sizeof(nencodeStr),
-                    ERL_NIF_LATIN1))
+            if (!conn_getStringParam(
+                    env, mapval, &commonParams.nencoding, &length))
                 BADARG_EXCEPTION(4, "string\0 commonParams.nencoding");
-            commonParams.nencoding = nencodeStr;
+        }
+
+        if (enif_get_map_value(
+                env, argv[4], enif_make_atom(env, "createMode"), &mapval))
+        {
+            ERL_NIF_TERM head, tail = mapval;
+            dpiCreateMode m = 0;
+            if (!enif_is_list(env, mapval))
+                BADARG_EXCEPTION(4, "atom list commonParams.createMode");
+            while (enif_get_list_cell(env, tail, &head, &tail))
+            {
+                DPI_CREATE_MODE_FROM_ATOM(head, m);
+                commonParams.createMode |= m;
+            }
+        }
+
+        if (enif_get_map_value(
+                env, argv[4], enif_make_atom(env, "edition"), &mapval))
+        {
+            if (!conn_getStringParam(
+                    env, mapval, &commonParams.edition,
+                    &commonParams.editionLength))
+                BADARG_EXCEPTION(4, "string commonParams.edition");
+        }
+
+        if (enif_get_map_value(
+                env, argv[4], enif_make_atom(env, "driverName"), &mapval))
+        {
+            if (!conn_getStringParam(
+                    env, mapval, &commonParams.driverName,
+                    &commonParams.driverNameLength))
+                BADARG_EXCEPTION(4, "string commonParams.driverName");
+        }
+    }
+
+    dpiConnCreateParams connCreateParams;
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        contextRes->context,
+        dpiContext_initConnCreateParams(
+            contextRes->context, &connCreateParams));
+
+    if (connCreateParamsMapSize > 0)
+    {
+        ERL_NIF_TERM mapval;
+
+        if (enif_get_map_value(
+                env, argv[5], enif_make_atom(env, "authMode"), &mapval))
+        {
+            ERL_NIF_TERM head, tail = mapval;
+            dpiAuthMode m = 0;
+            if (!enif_is_list(env, mapval))
+                BADARG_EXCEPTION(5, "atom list connCreateParams.authMode");
+            while (enif_get_list_cell(env, tail, &head, &tail))
+            {
+                DPI_AUTH_MODE_FROM_ATOM(head, m);
+                connCreateParams.authMode |= m;
+            }
+        }
+
+        if (enif_get_map_value(
+                env, argv[5], enif_make_atom(env, "connectionClass"),
+                &mapval))
+        {
+            if (!conn_getStringParam(
+                    env, mapval, &connCreateParams.connectionClass,
+                    &connCreateParams.connectionClassLength))
+                BADARG_EXCEPTION(5, "string connCreateParams.connectionClass");
+        }
+
+        if (enif_get_map_value(
+                env, argv[5], enif_make_atom(env, "purity"), &mapval))
+        {
+            DPI_PURITY_FROM_ATOM(mapval, connCreateParams.purity);
+        }
+
+        if (enif_get_map_value(
+                env, argv[5], enif_make_atom(env, "newPassword"), &mapval))
+        {
+            if (!conn_getStringParam(
+                    env, mapval, &connCreateParams.newPassword,
+                    &connCreateParams.newPasswordLength))
+                BADARG_EXCEPTION(5, "string connCreateParams.newPassword");
+        }
+
+        if (enif_get_map_value(
+                env, argv[5], enif_make_atom(env, "externalAuth"), &mapval))
+        {
+            if (enif_compare(mapval, ATOM_TRUE) == 0)
+                connCreateParams.externalAuth = 1;
+            else if (enif_compare(mapval, ATOM_FALSE) == 0)
+                connCreateParams.externalAuth = 0;
+            else
+                BADARG_EXCEPTION(5, "bool/atom connCreateParams.externalAuth");
+        }
+
+        if (enif_get_map_value(
+                env, argv[5], enif_make_atom(env, "stmtCacheSize"), &mapval))
+        {
+            if (!enif_get_uint(env, mapval, &stmtCacheSize))
+                BADARG_EXCEPTION(5, "uint connCreateParams.stmtCacheSize");
+            setStmtCacheSize = 1;
         }
     }
 
     dpiConn_res *connRes;
     ALLOC_RESOURCE(connRes, dpiConn);
+    connRes->lock = enif_mutex_create("oranif_conn");
+    connRes->cond = enif_cond_create("oranif_conn");
+    connRes->health = NULL;
+    connRes->lastUse = 0;
+    connRes->cache = NULL;
+    connRes->varPool = NULL;
+    connRes->attrs = NULL;
+    connRes->memBytes = 0;
+
+    // connections may be used by native threads (health checker, scans)
+    // while a NIF is using them
+    commonParams.createMode |= DPI_MODE_CREATE_THREADED;
 
     RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
         contextRes->context,
@@ -79,14 +262,46 @@ DPI_NIF_FUN(conn_create)
             contextRes->context, (const char *)userName.data, userName.size,
             (const char *)password.data, password.size,
             (const char *)connectString.data, connectString.size,
-            &commonParams,
-            NULL, // TODO implement connCreateParams
-            &connRes->conn),
+            &commonParams, &connCreateParams, &connRes->conn),
         connRes, dpiConn);
 
     // Save context into connection for access from dpiError
     connRes->context = contextRes->context;
 
+    connRes->cache = enif_alloc(sizeof(dpiConnCache));
+    connRes->cache->lock = enif_mutex_create("oranif_conn_cache");
+    connRes->cache->entries = NULL;
+    connRes->cache->count = 0;
+    connRes->cache->hits = 0;
+    connRes->cache->misses = 0;
+
+    connRes->varPool = enif_alloc(sizeof(dpiConnVarPool));
+    connRes->varPool->lock = enif_mutex_create("oranif_conn_var_pool");
+    connRes->varPool->entries = NULL;
+    connRes->varPool->count = 0;
+    connRes->varPool->hits = 0;
+    connRes->varPool->misses = 0;
+
+    connRes->attrs = enif_alloc(sizeof(dpiConnAttrs));
+    connRes->attrs->lock = enif_mutex_create("oranif_conn_attrs");
+    for (int a = 0; a < CONN_ATTRS; a++)
+    {
+        connRes->attrs->attrs[a].value = NULL;
+        connRes->attrs->attrs[a].length = 0;
+    }
+    connRes->attrs->sent = 0;
+    connRes->attrs->skipped = 0;
+
+    if (setStmtCacheSize &&
+        DPI_FAILURE == dpiConn_setStmtCacheSize(connRes->conn, stmtCacheSize))
+    {
+        dpiErrorInfo err;
+        dpiContext_getError(connRes->context, &err);
+        dpiConn_release(connRes->conn);
+        RELEASE_RESOURCE(connRes, dpiConn);
+        RAISE_EXCEPTION(dpiErrorInfoMap(env, err));
+    }
+
     ERL_NIF_TERM connResTerm = enif_make_resource(env, connRes);
 
     RETURNED_TRACE;
@@ -118,6 +333,8 @@ DPI_NIF_FUN(conn_prepareStmt)
 
     dpiStmt_res *stmtRes;
     ALLOC_RESOURCE(stmtRes, dpiStmt);
+    dpiStmt_res_init(stmtRes, connRes->context);
+    dpiStmt_res_attach(stmtRes, connRes);
 
     RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
         connRes->context,
@@ -127,14 +344,105 @@ DPI_NIF_FUN(conn_prepareStmt)
             &stmtRes->stmt),
         stmtRes, dpiStmt);
 
-    stmtRes->context = connRes->context;
-
     ERL_NIF_TERM stmtResTerm = enif_make_resource(env, stmtRes);
 
     RETURNED_TRACE;
     return stmtResTerm;
 }
 
+/*******************************************************************************
+ * Variable pool
+ * variables given back with conn_recycleVar keep their OCI buffers and element
+ * handles and are handed out again by conn_newVar for the same creation
+ * parameters, a statement the variable was bound to or defined with still
+ * refers to it and must not be executed again once it is recycled
+ ******************************************************************************/
+
+static int conn_varKeyEqual(dpiVarKey *a, dpiVarKey *b)
+{
+    return a->oracleTypeNum == b->oracleTypeNum &&
+           a->nativeTypeNum == b->nativeTypeNum &&
+           a->maxArraySize == b->maxArraySize && a->size == b->size &&
+           a->sizeIsBytes == b->sizeIsBytes && a->isArray == b->isArray;
+}
+
+// unlinks and returns an idle variable matching key, NULL if there is none
+static dpiConnVarPoolEntry *conn_varPoolTake(
+    dpiConnVarPool *pool, dpiVarKey *key)
+{
+    dpiConnVarPoolEntry *entry = NULL;
+
+    enif_mutex_lock(pool->lock);
+    for (dpiConnVarPoolEntry **link = &pool->entries; *link;
+         link = &(*link)->next)
+        if (conn_varKeyEqual(&(*link)->key, key))
+        {
+            entry = *link;
+            *link = entry->next;
+            pool->count--;
+            break;
+        }
+    if (entry)
+        pool->hits++;
+    else
+        pool->misses++;
+    enif_mutex_unlock(pool->lock);
+
+    return entry;
+}
+
+static void conn_varPoolClear(ErlNifEnv *env, dpiConn_res *connRes)
+{
+    dpiConnVarPool *pool = connRes->varPool;
+
+    while (pool->entries)
+    {
+        dpiConnVarPoolEntry *entry = pool->entries;
+        pool->entries = entry->next;
+        oranif_memRelease(
+            env, ORANIF_MEM_VAR, &connRes->memBytes, entry->memBytes);
+        dpiVar_release(entry->var);
+        enif_free(entry->slab);
+        enif_free(entry);
+    }
+    pool->count = 0;
+}
+
+// native bytes of a variable with elements of elementSize bytes
+static uint64_t conn_varBytes(
+    uint32_t maxArraySize, uint32_t elementSize, int withSlab)
+{
+    return (uint64_t)maxArraySize *
+           (sizeof(dpiData) + elementSize +
+            (withSlab ? sizeof(dpiDataPtr_res) : 0));
+}
+
+/*
+ * replaces the estimate charged for a new variable by the bytes of its actual
+ * element size, which ODPI-C derives from the type and character set, the
+ * variable exists by now, so a larger size is charged even past the limit
+ * which makes memory_limit/1 a soft limit for variables
+ */
+static uint64_t conn_varRecharge(
+    ErlNifEnv *env, dpiConn_res *connRes, dpiVar *var, uint32_t maxArraySize,
+    int withSlab, uint64_t estimate)
+{
+    uint32_t sizeInBytes;
+
+    if (DPI_FAILURE == dpiVar_getSizeInBytes(var, &sizeInBytes))
+        return estimate;
+
+    uint64_t bytes = conn_varBytes(maxArraySize, sizeInBytes, withSlab);
+    if (bytes > estimate)
+        oranif_memCharge(
+            env, ORANIF_MEM_VAR, &connRes->memBytes, bytes - estimate, 1);
+    else
+        oranif_memRelease(
+            env, ORANIF_MEM_VAR, &connRes->memBytes, estimate - bytes);
+
+    return bytes;
+}
+
 DPI_NIF_FUN(conn_newVar)
 {
     CHECK_ARGCOUNT(8);
@@ -171,56 +479,404 @@ DPI_NIF_FUN(conn_newVar)
     else
         BADARG_EXCEPTION(6, "atom isArray");
 
-    if (enif_compare(argv[7], ATOM_NULL))
-        BADARG_EXCEPTION(7, "atom objType");
+    dpiObjectType_res *objTypeRes = NULL;
+    if (enif_compare(argv[7], ATOM_NULL) &&
+        !enif_get_resource(
+            env, argv[7], dpiObjectType_type, (void **)&objTypeRes))
+        BADARG_EXCEPTION(7, "resource objectType or atom null objType");
+
+    dpiVarKey key = {
+        oracleTypeNum, nativeTypeNum, maxArraySize, size, sizeIsBytes,
+        isArray};
+    dpiConnVarPoolEntry *entry = NULL;
+
+    // object variables are bound to their type and never pooled
+    if (!objTypeRes)
+        entry = conn_varPoolTake(connRes->varPool, &key);
+
+    /*
+     * a pooled variable is charged again like a new one, so a lowered limit
+     * applies to it as well, one which doesn't fit is dropped
+     */
+    uint64_t memBytes = conn_varBytes(maxArraySize, size, 1);
+    if (entry)
+    {
+        memBytes = entry->memBytes;
+        oranif_memRelease(
+            env, ORANIF_MEM_VAR, &connRes->memBytes, memBytes);
+    }
+    if (!oranif_memCharge(
+            env, ORANIF_MEM_VAR, &connRes->memBytes, memBytes, 0))
+    {
+        if (entry)
+        {
+            dpiVar_release(entry->var);
+            enif_free(entry->slab);
+            enif_free(entry);
+        }
+        RAISE_STR_EXCEPTION(ORANIF_MEM_LIMIT_ERROR);
+    }
 
     dpiVar_res *varRes;
     ALLOC_RESOURCE(varRes, dpiVar);
+    varRes->connRes = NULL; // nothing to uncharge until fully set up
+    varRes->stmtUses = 0;
 
-    RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
-        connRes->context,
-        dpiConn_newVar(
+    if (entry)
+    {
+        varRes->var = entry->var;
+        varRes->slab = entry->slab;
+        data = entry->data;
+        enif_free(entry);
+    }
+    else
+    {
+        int dpiResult = dpiConn_newVar(
             connRes->conn, oracleTypeNum, nativeTypeNum, maxArraySize, size,
-            sizeIsBytes, isArray,
-            NULL, &varRes->var, &data),
-        varRes, dpiVar);
+            sizeIsBytes, isArray, objTypeRes ? objTypeRes->objType : NULL,
+            &varRes->var, &data);
+        if (DPI_FAILURE == dpiResult)
+            oranif_memRelease(
+                env, ORANIF_MEM_VAR, &connRes->memBytes, memBytes);
+        RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
+            connRes->context, dpiResult, varRes, dpiVar);
+
+        // one slab of element handles, referenced by {Var, Index} terms
+        varRes->slab = enif_alloc(sizeof(dpiDataPtr_res) * maxArraySize);
+        if (!varRes->slab)
+        {
+            dpiVar_release(varRes->var);
+            oranif_memRelease(
+                env, ORANIF_MEM_VAR, &connRes->memBytes, memBytes);
+            RELEASE_RESOURCE(varRes, dpiVar);
+            RAISE_EXCEPTION(ATOM_ENOMEM);
+        }
+        memBytes = conn_varRecharge(
+            env, connRes, varRes->var, maxArraySize, 1, memBytes);
+    }
+    varRes->memBytes = memBytes;
+    varRes->connRes = connRes;
+    enif_keep_resource(connRes);
 
     varRes->context = connRes->context;
+    varRes->nativeTypeNum = nativeTypeNum;
+    varRes->data = data;
+    varRes->maxArraySize = maxArraySize;
+    varRes->conn = objTypeRes ? NULL : connRes->conn;
+    varRes->key = key;
 
     ERL_NIF_TERM varResTerm = enif_make_resource(env, varRes);
 
     ERL_NIF_TERM dataList = enif_make_list(env, 0);
 
-    dpiDataPtr_res *dataRes;
-    varRes->head = NULL;
     for (int i = maxArraySize - 1; i >= 0; i--)
     {
-        ALLOC_RESOURCE(dataRes, dpiDataPtr);
+        dpiDataPtr_res *dataRes = &varRes->slab[i];
         dataRes->stmtRes = NULL;
-        dataRes->next = NULL;
+        dataRes->connRes = connRes; // kept by varRes
         dataRes->isQueryValue = 0;
         dataRes->context = connRes->context;
-        if (varRes->head == NULL)
+        dataRes->dpiDataPtr = data + i;
+        dataRes->type = nativeTypeNum;
+        dataList = enif_make_list_cell(
+            env, enif_make_tuple2(env, varResTerm, enif_make_uint(env, i)),
+            dataList);
+    }
+    ERL_NIF_TERM keys[] = {ATOM_data, ATOM_var};
+    ERL_NIF_TERM values[] = {dataList, varResTerm};
+    ERL_NIF_TERM ret = MAKE_MAP(env, keys, values);
+
+    RETURNED_TRACE;
+    return ret;
+}
+
+DPI_NIF_FUN(conn_recycleVar)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiConn_res *connRes;
+    dpiVar_res *varRes;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_get_resource(env, argv[1], dpiVar_type, (void **)&varRes))
+        BADARG_EXCEPTION(1, "resource var");
+
+    if (!varRes->conn)
+        RAISE_STR_EXCEPTION("variable is released or can't be pooled");
+    if (varRes->conn != connRes->conn)
+        RAISE_STR_EXCEPTION("variable belongs to another connection");
+    if (oranif_atomicAdd(&varRes->stmtUses, 0))
+        RAISE_STR_EXCEPTION("variable is bound or defined on a statement");
+
+    // reset on return, the next user starts from null elements
+    if (varRes->key.isArray)
+        RAISE_EXCEPTION_ON_DPI_ERROR(
+            connRes->context,
+            dpiVar_setNumElementsInArray(varRes->var, 0));
+    for (uint32_t i = 0; i < varRes->maxArraySize; i++)
+    {
+        dpiDataPtr_res *dataRes = &varRes->slab[i];
+        if (dataRes->stmtRes)
+        {
+            RELEASE_RESOURCE(dataRes->stmtRes, dpiStmt);
+            dataRes->stmtRes = NULL;
+        }
+        varRes->data[i].isNull = 1;
+    }
+
+    dpiConnVarPool *pool = connRes->varPool;
+    dpiConnVarPoolEntry *entry = NULL;
+    enif_mutex_lock(pool->lock);
+    if (pool->count < CONN_VAR_POOL_MAX_ENTRIES)
+    {
+        entry = enif_alloc(sizeof(dpiConnVarPoolEntry));
+        entry->key = varRes->key;
+        entry->var = varRes->var;
+        entry->data = varRes->data;
+        entry->slab = varRes->slab;
+        entry->memBytes = varRes->memBytes;
+        entry->next = pool->entries;
+        pool->entries = entry;
+        pool->count++;
+    }
+    enif_mutex_unlock(pool->lock);
+
+    if (!entry)
+    {
+        dpiVar_release(varRes->var);
+        enif_free(varRes->slab);
+    }
+    else // the charge moved to the pool entry
+        varRes->memBytes = 0;
+    dpiVar_res_uncharge(env, varRes);
+
+    // outstanding {Var, Index} handles are rejected from now on
+    varRes->var = NULL;
+    varRes->slab = NULL;
+    varRes->data = NULL;
+    varRes->conn = NULL;
+    RELEASE_RESOURCE(varRes, dpiVar);
+
+    RETURNED_TRACE;
+    return entry ? ATOM_TRUE : ATOM_FALSE;
+}
+
+DPI_NIF_FUN(conn_varPoolStats)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiConn_res *connRes;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+
+    dpiConnVarPool *pool = connRes->varPool;
+    ERL_NIF_TERM keys[] = {ATOM_hits, ATOM_idle, ATOM_misses};
+    ERL_NIF_TERM values[3];
+    enif_mutex_lock(pool->lock);
+    values[0] = enif_make_uint64(env, pool->hits);
+    values[1] = enif_make_uint(env, pool->count);
+    values[2] = enif_make_uint64(env, pool->misses);
+    enif_mutex_unlock(pool->lock);
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
+
+    // #{hits => integer, misses => integer, idle => integer}
+    RETURNED_TRACE;
+    return map;
+}
+
+DPI_NIF_FUN(conn_memoryUsage)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiConn_res *connRes;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+
+    oranif_st *st = (oranif_st *)enif_priv_data(env);
+    enif_mutex_lock(st->lock);
+    ErlNifUInt64 bytes = connRes->memBytes;
+    enif_mutex_unlock(st->lock);
+
+    RETURNED_TRACE;
+    return enif_make_uint64(env, bytes);
+}
+
+// native type of the first non null value, 0 if there is none
+static dpiNativeTypeNum conn_inferArrayType(ErlNifEnv *env, ERL_NIF_TERM list)
+{
+    ERL_NIF_TERM head, tail = list;
+
+    while (enif_get_list_cell(env, tail, &head, &tail))
+        if (enif_is_binary(env, head))
+            return DPI_NATIVE_TYPE_BYTES;
+        else if (enif_is_number(env, head))
+        {
+            double d;
+            return enif_get_double(env, head, &d) ? DPI_NATIVE_TYPE_DOUBLE
+                                                  : DPI_NATIVE_TYPE_INT64;
+        }
+
+    return 0;
+}
+
+/*
+ * fills the array variable from the list, returns 0 for a value of another
+ * type, the byte size of the elements has been checked by the caller
+ */
+static int conn_fillArray(
+    ErlNifEnv *env, dpiVar_res *varRes, ERL_NIF_TERM list, int *dpiResult)
+{
+    ERL_NIF_TERM head, tail = list;
+    ErlNifSInt64 i64;
+    ErlNifBinary bin;
+    double dbl;
+    dpiData *data;
+
+    *dpiResult = DPI_SUCCESS;
+    for (uint32_t i = 0; enif_get_list_cell(env, tail, &head, &tail); i++)
+    {
+        data = &varRes->data[i];
+        if (enif_compare(head, ATOM_NULL) == 0)
+            data->isNull = 1;
+        else if (varRes->nativeTypeNum == DPI_NATIVE_TYPE_INT64 &&
+                 enif_get_int64(env, head, &i64))
+            dpiData_setInt64(data, i64);
+        else if (varRes->nativeTypeNum == DPI_NATIVE_TYPE_DOUBLE &&
+                 (enif_get_double(env, head, &dbl) ||
+                  (enif_get_int64(env, head, &i64) && (dbl = i64, 1))))
+            dpiData_setDouble(data, dbl);
+        else if (varRes->nativeTypeNum == DPI_NATIVE_TYPE_BYTES &&
+                 enif_inspect_binary(env, head, &bin))
         {
-            varRes->head = dataRes;
+            if (DPI_FAILURE ==
+                dpiVar_setFromBytes(
+                    varRes->var, i, (const char *)bin.data, bin.size))
+            {
+                *dpiResult = DPI_FAILURE;
+                return 1;
+            }
         }
         else
+            return 0;
+    }
+
+    return 1;
+}
+
+DPI_NIF_FUN(conn_newArrayVar)
+{
+    CHECK_ARGCOUNT(5);
+
+    dpiConn_res *connRes;
+    dpiNativeTypeNum nativeTypeNum = 0;
+    dpiOracleTypeNum oracleTypeNum;
+    uint32_t maxArraySize, size;
+    unsigned numElements;
+    ERL_NIF_TERM head, tail;
+    ErlNifBinary bin;
+    dpiData *data;
+    int dpiResult;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (enif_compare(argv[1], ATOM_NULL) != 0)
+    {
+        DPI_NATIVE_TYPE_NUM_FROM_ATOM(argv[1], nativeTypeNum);
+    }
+    if (!enif_get_uint(env, argv[2], &maxArraySize) || maxArraySize == 0)
+        BADARG_EXCEPTION(2, "uint maxArraySize");
+    if (!enif_get_uint(env, argv[3], &size))
+        BADARG_EXCEPTION(3, "uint size");
+    if (!enif_get_list_length(env, argv[4], &numElements) ||
+        numElements > maxArraySize)
+        BADARG_EXCEPTION(4, "list values");
+
+    if (!nativeTypeNum)
+        nativeTypeNum = conn_inferArrayType(env, argv[4]);
+    switch (nativeTypeNum)
+    {
+    case 0: // only nulls, the type doesn't matter
+        nativeTypeNum = DPI_NATIVE_TYPE_BYTES;
+        // fall through
+    case DPI_NATIVE_TYPE_BYTES:
+        oracleTypeNum = DPI_ORACLE_TYPE_VARCHAR;
+        // a size of 0 fits the longest value, otherwise all values must fit
+        if (size == 0)
         {
-            dataRes->next = varRes->head;
-            varRes->head = dataRes;
+            for (tail = argv[4]; enif_get_list_cell(env, tail, &head, &tail);)
+                if (enif_inspect_binary(env, head, &bin) && bin.size > size)
+                    size = bin.size;
+            if (size == 0)
+                size = 1;
         }
-        dataRes->dpiDataPtr = data + i;
-        dataRes->type = nativeTypeNum;
-        ERL_NIF_TERM dataResTerm = enif_make_resource(env, dataRes);
-        dataList = enif_make_list_cell(env, dataResTerm, dataList);
+        else
+            for (tail = argv[4]; enif_get_list_cell(env, tail, &head, &tail);)
+                if (enif_inspect_binary(env, head, &bin) && bin.size > size)
+                    BADARG_EXCEPTION(4, "list values of at most size bytes");
+        break;
+    case DPI_NATIVE_TYPE_INT64:
+    case DPI_NATIVE_TYPE_DOUBLE:
+        oracleTypeNum = DPI_ORACLE_TYPE_NUMBER;
+        size = 0;
+        break;
+    default:
+        RAISE_STR_EXCEPTION("unsupported array nativeTypeNum");
+    }
+
+    uint64_t memBytes = conn_varBytes(maxArraySize, size, 0);
+    if (!oranif_memCharge(env, ORANIF_MEM_VAR, &connRes->memBytes, memBytes, 0))
+        RAISE_STR_EXCEPTION(ORANIF_MEM_LIMIT_ERROR);
+
+    dpiVar_res *varRes;
+    ALLOC_RESOURCE(varRes, dpiVar);
+    varRes->connRes = NULL;
+    varRes->stmtUses = 0;
+
+    dpiResult = dpiConn_newVar(
+        connRes->conn, oracleTypeNum, nativeTypeNum, maxArraySize, size, 1, 1,
+        NULL, &varRes->var, &data);
+    if (DPI_FAILURE == dpiResult)
+        oranif_memRelease(env, ORANIF_MEM_VAR, &connRes->memBytes, memBytes);
+    RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
+        connRes->context, dpiResult, varRes, dpiVar);
+
+    varRes->context = connRes->context;
+    varRes->nativeTypeNum = nativeTypeNum;
+    varRes->slab = NULL;
+    varRes->data = data;
+    varRes->maxArraySize = maxArraySize;
+    varRes->conn = NULL;
+    varRes->memBytes = conn_varRecharge(
+        env, connRes, varRes->var, maxArraySize, 0, memBytes);
+    varRes->connRes = connRes;
+    enif_keep_resource(connRes);
+
+    if (!conn_fillArray(env, varRes, argv[4], &dpiResult))
+    {
+        dpiVar_release(varRes->var);
+        dpiVar_res_uncharge(env, varRes);
+        RELEASE_RESOURCE(varRes, dpiVar);
+        BADARG_EXCEPTION(4, "list values of nativeTypeNum");
     }
-    ERL_NIF_TERM ret = enif_make_new_map(env);
-    ret = enif_make_new_map(env);
-    enif_make_map_put(env, ret, enif_make_atom(env, "var"), varResTerm, &ret);
-    enif_make_map_put(env, ret, enif_make_atom(env, "data"), dataList, &ret);
+    if (DPI_SUCCESS == dpiResult)
+        dpiResult = dpiVar_setNumElementsInArray(varRes->var, numElements);
+    if (DPI_FAILURE == dpiResult)
+    {
+        dpiErrorInfo err;
+        dpiContext_getError(connRes->context, &err);
+        dpiVar_release(varRes->var);
+        dpiVar_res_uncharge(env, varRes);
+        RELEASE_RESOURCE(varRes, dpiVar);
+        RAISE_EXCEPTION(dpiErrorInfoMap(env, err));
+    }
+
+    ERL_NIF_TERM varResTerm = enif_make_resource(env, varRes);
 
     RETURNED_TRACE;
-    return ret;
+    return varResTerm;
 }
 
 DPI_NIF_FUN(conn_commit)
@@ -232,6 +888,7 @@ DPI_NIF_FUN(conn_commit)
     if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
         BADARG_EXCEPTION(0, "resource connection");
 
+    dpiConn_res_touch(connRes);
     RAISE_EXCEPTION_ON_DPI_ERROR(
         connRes->context, dpiConn_commit(connRes->conn));
 
@@ -248,6 +905,7 @@ DPI_NIF_FUN(conn_rollback)
     if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
         BADARG_EXCEPTION(0, "resource connection");
 
+    dpiConn_res_touch(connRes);
     RAISE_EXCEPTION_ON_DPI_ERROR(
         connRes->context, dpiConn_rollback(connRes->conn));
 
@@ -264,6 +922,7 @@ DPI_NIF_FUN(conn_ping)
     if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
         BADARG_EXCEPTION(0, "resource connection");
 
+    dpiConn_res_touch(connRes);
     RAISE_EXCEPTION_ON_DPI_ERROR(
         connRes->context, dpiConn_ping(connRes->conn));
 
@@ -302,6 +961,12 @@ DPI_NIF_FUN(conn_close)
             mode |= m;
         } while (enif_get_list_cell(env, tail, &head, &tail));
 
+    dpiConn_res_stopHealthCheck(connRes);
+
+    enif_mutex_lock(connRes->varPool->lock);
+    conn_varPoolClear(env, connRes);
+    enif_mutex_unlock(connRes->varPool->lock);
+
     RAISE_EXCEPTION_ON_DPI_ERROR(
         connRes->context,
         dpiConn_close(
@@ -327,39 +992,24 @@ DPI_NIF_FUN(conn_getServerVersion)
     dpiVersionInfo version;
     char *releaseString;
     uint32_t releaseStringLength;
-    dpiConn_getServerVersion(connRes->conn, (const char **)&releaseString,
-                             &releaseStringLength, &version);
-    ERL_NIF_TERM map = enif_make_new_map(env);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "versionNum"),
-        enif_make_int(env, version.versionNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "releaseNum"),
-        enif_make_int(env, version.releaseNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "updateNum"),
-        enif_make_int(env, version.updateNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "portReleaseNum"),
-        enif_make_int(env, version.portReleaseNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "portUpdateNum"),
-        enif_make_int(env, version.portUpdateNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "fullVersionNum"),
-        enif_make_int(env, version.fullVersionNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "releaseString"),
-        enif_make_string_len(env, releaseString, releaseStringLength,
-                             ERL_NIF_LATIN1),
-        &map);
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        connRes->context,
+        dpiConn_getServerVersion(
+            connRes->conn, (const char **)&releaseString,
+            &releaseStringLength, &version));
+    ERL_NIF_TERM keys[] = {
+        ATOM_fullVersionNum, ATOM_portReleaseNum, ATOM_portUpdateNum,
+        ATOM_releaseNum, ATOM_releaseString, ATOM_updateNum, ATOM_versionNum};
+    ERL_NIF_TERM values[] = {
+        enif_make_int(env, version.fullVersionNum),
+        enif_make_int(env, version.portReleaseNum),
+        enif_make_int(env, version.portUpdateNum),
+        enif_make_int(env, version.releaseNum),
+        enif_make_string_len(
+            env, releaseString, releaseStringLength, ERL_NIF_LATIN1),
+        enif_make_int(env, version.updateNum),
+        enif_make_int(env, version.versionNum)};
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
 
     /* #{versionNum => integer, releaseNum => integer, updateNum => integer,
          portReleaseNum => integer, portUpdateNum => integer,
@@ -368,7 +1018,29 @@ DPI_NIF_FUN(conn_getServerVersion)
     return map;
 }
 
-DPI_NIF_FUN(conn_setClientIdentifier)
+/*******************************************************************************
+ * Session attributes
+ * ODPI-C only stores client identifier, module, action, client info and
+ * database operation on the session handle, OCI sends them along with the
+ * next round trip, so the setters don't block. The connection remembers the
+ * last value of every attribute and doesn't hand an unchanged one to ODPI-C
+ * again, which would send it once more with the next round trip. PL/SQL may
+ * change the attributes as well (DBMS_APPLICATION_INFO, DBMS_SESSION), so
+ * every PL/SQL execute on the connection forgets the remembered values
+ ******************************************************************************/
+
+static void conn_attrsFree(dpiConnAttrs *attrs)
+{
+    for (int a = 0; a < CONN_ATTRS; a++)
+        if (attrs->attrs[a].value)
+            enif_free(attrs->attrs[a].value);
+    enif_mutex_destroy(attrs->lock);
+    enif_free(attrs);
+}
+
+static ERL_NIF_TERM conn_setSessionAttr(
+    ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[], int attr,
+    int (*setter)(dpiConn *, const char *, uint32_t))
 {
     CHECK_ARGCOUNT(2);
 
@@ -380,10 +1052,986 @@ DPI_NIF_FUN(conn_setClientIdentifier)
     if (!enif_inspect_binary(env, argv[1], &value))
         BADARG_EXCEPTION(1, "string/binary value");
 
-    RAISE_EXCEPTION_ON_DPI_ERROR(
-        connRes->context,
-        dpiConn_setClientIdentifier(
-            connRes->conn, (const char *)value.data, value.size));
+    dpiConnAttrs *attrs = connRes->attrs;
+    dpiConnAttr *cached = &attrs->attrs[attr];
+    enif_mutex_lock(attrs->lock);
+    // value.data may be NULL for an empty binary
+    if (cached->value && cached->length == value.size &&
+        (value.size == 0 ||
+         memcmp(cached->value, value.data, value.size) == 0))
+    {
+        attrs->skipped++;
+        enif_mutex_unlock(attrs->lock);
+        RETURNED_TRACE;
+        return ATOM_OK;
+    }
+    if (DPI_FAILURE ==
+        setter(connRes->conn, (const char *)value.data, value.size))
+    {
+        enif_mutex_unlock(attrs->lock);
+        dpiErrorInfo err;
+        dpiContext_getError(connRes->context, &err);
+        RAISE_EXCEPTION(dpiErrorInfoMap(env, err));
+    }
+    if (cached->value)
+        enif_free(cached->value);
+    // an empty value is cached as well, enif_alloc(0) may return NULL
+    cached->value = enif_alloc(value.size + 1);
+    if (value.size > 0)
+        memcpy(cached->value, value.data, value.size);
+    cached->length = value.size;
+    attrs->sent++;
+    enif_mutex_unlock(attrs->lock);
 
+    RETURNED_TRACE;
     return ATOM_OK;
 }
+
+/*
+ * called after every execute on the connection, forgets the attributes only
+ * if stmt is PL/SQL, plain SQL can't change them, connRes may be NULL
+ */
+void dpiConn_res_forgetAttrs(dpiConn_res *connRes, dpiStmt *stmt)
+{
+    dpiStmtInfo info;
+
+    if (!connRes || !stmt ||
+        (DPI_SUCCESS == dpiStmt_getInfo(stmt, &info) && !info.isPLSQL))
+        return;
+
+    dpiConnAttrs *attrs = connRes->attrs;
+    enif_mutex_lock(attrs->lock);
+    for (int a = 0; a < CONN_ATTRS; a++)
+        if (attrs->attrs[a].value)
+        {
+            enif_free(attrs->attrs[a].value);
+            attrs->attrs[a].value = NULL;
+            attrs->attrs[a].length = 0;
+        }
+    enif_mutex_unlock(attrs->lock);
+}
+
+DPI_NIF_FUN(conn_setClientIdentifier)
+{
+    return conn_setSessionAttr(
+        env, argc, argv, CONN_ATTR_CLIENT_IDENTIFIER,
+        dpiConn_setClientIdentifier);
+}
+
+DPI_NIF_FUN(conn_setModule)
+{
+    return conn_setSessionAttr(
+        env, argc, argv, CONN_ATTR_MODULE, dpiConn_setModule);
+}
+
+DPI_NIF_FUN(conn_setAction)
+{
+    return conn_setSessionAttr(
+        env, argc, argv, CONN_ATTR_ACTION, dpiConn_setAction);
+}
+
+DPI_NIF_FUN(conn_setClientInfo)
+{
+    return conn_setSessionAttr(
+        env, argc, argv, CONN_ATTR_CLIENT_INFO, dpiConn_setClientInfo);
+}
+
+DPI_NIF_FUN(conn_setDbOp)
+{
+    return conn_setSessionAttr(
+        env, argc, argv, CONN_ATTR_DB_OP, dpiConn_setDbOp);
+}
+
+DPI_NIF_FUN(conn_sessionAttrStats)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiConn_res *connRes;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+
+    dpiConnAttrs *attrs = connRes->attrs;
+    ERL_NIF_TERM keys[] = {ATOM_sent, ATOM_skipped};
+    ERL_NIF_TERM values[2];
+    enif_mutex_lock(attrs->lock);
+    values[0] = enif_make_uint64(env, attrs->sent);
+    values[1] = enif_make_uint64(env, attrs->skipped);
+    enif_mutex_unlock(attrs->lock);
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
+
+    // #{sent => integer, skipped => integer}
+    RETURNED_TRACE;
+    return map;
+}
+
+/*******************************************************************************
+ * Health check
+ * a native thread pings the connection every interval and records whether
+ * it is alive, so that a pool can skip dead sessions without a round trip.
+ * A connection which made a round trip within the interval isn't pinged.
+ * The thread keeps the connection resource until it is stopped
+ ******************************************************************************/
+
+// granularity at which a sleeping checker notices that it was stopped
+#define HEALTH_SLEEP_SLICE 100
+
+// records a round trip of the connection, which makes a ping unnecessary
+void dpiConn_res_touch(dpiConn_res *connRes)
+{
+    if (!connRes)
+        return;
+
+    enif_mutex_lock(connRes->lock);
+    connRes->lastUse = enif_monotonic_time(ERL_NIF_MSEC);
+    enif_mutex_unlock(connRes->lock);
+}
+
+static void *conn_healthThread(void *arg)
+{
+    dpiConn_res *connRes = (dpiConn_res *)arg;
+    dpiConnHealth *health = connRes->health;
+    uint32_t slept = 0, slice, interval;
+    ErlNifTime idle;
+    int stop, result;
+
+    for (;;)
+    {
+        enif_mutex_lock(connRes->lock);
+        stop = health->stop;
+        interval = health->interval;
+        idle = enif_monotonic_time(ERL_NIF_MSEC) - connRes->lastUse;
+        enif_mutex_unlock(connRes->lock);
+        if (stop)
+            break;
+
+        if (slept < interval)
+        {
+            slice = interval - slept < HEALTH_SLEEP_SLICE
+                        ? interval - slept
+                        : HEALTH_SLEEP_SLICE;
+            oranif_sleep(slice);
+            slept += slice;
+            continue;
+        }
+        slept = 0;
+        if (idle < interval)
+            continue;
+
+        result = dpiConn_ping(connRes->conn);
+
+        enif_mutex_lock(connRes->lock);
+        health->checks++;
+        health->lastCheck = enif_monotonic_time(ERL_NIF_MSEC);
+        if (DPI_FAILURE == result)
+        {
+            dpiErrorInfo err;
+            dpiContext_getError(connRes->context, &err);
+            enif_clear_env(health->errorEnv);
+            health->error = dpiErrorInfoMap(health->errorEnv, err);
+            health->state = CONN_HEALTH_DEAD;
+        }
+        else
+            health->state = CONN_HEALTH_ALIVE;
+        enif_mutex_unlock(connRes->lock);
+    }
+
+    enif_mutex_lock(connRes->lock);
+    connRes->health = NULL;
+    enif_cond_broadcast(connRes->cond);
+    enif_mutex_unlock(connRes->lock);
+
+    enif_free_env(health->errorEnv);
+    enif_free(health);
+    oranif_threadExit();
+    enif_release_resource(connRes);
+
+    return NULL;
+}
+
+// stops the health checker (if any) and waits until it is done
+void dpiConn_res_stopHealthCheck(dpiConn_res *connRes)
+{
+    enif_mutex_lock(connRes->lock);
+    if (connRes->health)
+        connRes->health->stop = 1;
+    while (connRes->health)
+        enif_cond_wait(connRes->cond, connRes->lock);
+    enif_mutex_unlock(connRes->lock);
+}
+
+DPI_NIF_FUN(conn_startHealthCheck)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiConn_res *connRes;
+    uint32_t interval;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_get_uint(env, argv[1], &interval) || interval == 0)
+        BADARG_EXCEPTION(1, "uint interval");
+
+    enif_mutex_lock(connRes->lock);
+    if (connRes->health && connRes->health->stop)
+    {
+        enif_mutex_unlock(connRes->lock);
+        RAISE_STR_EXCEPTION("health check is stopping");
+    }
+    if (connRes->health)
+    {
+        // only the interval changes, the state is kept
+        connRes->health->interval = interval;
+        enif_mutex_unlock(connRes->lock);
+
+        RETURNED_TRACE;
+        return ATOM_OK;
+    }
+
+    dpiConnHealth *health = enif_alloc(sizeof(dpiConnHealth));
+    health->interval = interval;
+    health->stop = 0;
+    health->state = CONN_HEALTH_UNCHECKED;
+    health->checks = 0;
+    health->lastCheck = 0;
+    health->errorEnv = enif_alloc_env();
+    health->error = ATOM_NULL;
+    connRes->health = health;
+
+    enif_keep_resource(connRes);
+    if (!oranif_threadCreate("oranif_health", conn_healthThread, connRes))
+    {
+        connRes->health = NULL;
+        enif_mutex_unlock(connRes->lock);
+        enif_release_resource(connRes);
+        enif_free_env(health->errorEnv);
+        enif_free(health);
+        RAISE_STR_EXCEPTION("failed to create health check thread");
+    }
+    enif_mutex_unlock(connRes->lock);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(conn_stopHealthCheck)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiConn_res *connRes;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+
+    dpiConn_res_stopHealthCheck(connRes);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(conn_getHealth)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiConn_res *connRes;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+
+    ERL_NIF_TERM keys[] = {ATOM_checks, ATOM_error, ATOM_lastCheck, ATOM_state};
+    ERL_NIF_TERM state, values[4];
+    enif_mutex_lock(connRes->lock);
+    dpiConnHealth *health = connRes->health;
+    if (!health)
+    {
+        enif_mutex_unlock(connRes->lock);
+        RAISE_STR_EXCEPTION("health check not running");
+    }
+    switch (health->state)
+    {
+    case CONN_HEALTH_ALIVE:
+        state = enif_make_atom(env, "alive");
+        break;
+    case CONN_HEALTH_DEAD:
+        state = enif_make_atom(env, "dead");
+        break;
+    default:
+        state = enif_make_atom(env, "unchecked");
+    }
+    values[0] = enif_make_uint64(env, health->checks);
+    values[1] = health->state == CONN_HEALTH_DEAD
+                    ? enif_make_copy(env, health->error)
+                    : ATOM_NULL;
+    values[2] = enif_make_int64(env, health->lastCheck);
+    values[3] = state;
+    enif_mutex_unlock(connRes->lock);
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
+
+    // #{state => atom, checks => integer, lastCheck => integer,
+    //   error => map | null}
+    RETURNED_TRACE;
+    return map;
+}
+
+DPI_NIF_FUN(conn_setStmtCacheSize)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiConn_res *connRes;
+    uint32_t cacheSize;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_get_uint(env, argv[1], &cacheSize))
+        BADARG_EXCEPTION(1, "uint cacheSize");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        connRes->context, dpiConn_setStmtCacheSize(connRes->conn, cacheSize));
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(conn_getStmtCacheSize)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiConn_res *connRes;
+    uint32_t cacheSize;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        connRes->context, dpiConn_getStmtCacheSize(connRes->conn, &cacheSize));
+
+    RETURNED_TRACE;
+    return enif_make_uint(env, cacheSize);
+}
+
+/*******************************************************************************
+ * Client side query result cache
+ * results are kept per connection for a caller supplied TTL and looked up by
+ * {Sql, Binds}, complementary to the server result cache (RESULT_CACHE hint)
+ ******************************************************************************/
+
+static void conn_cacheFreeEntry(dpiConnCache *cache, dpiConnCacheEntry **link)
+{
+    dpiConnCacheEntry *entry = *link;
+
+    *link = entry->next;
+    enif_free_env(entry->env);
+    enif_free(entry);
+    cache->count--;
+}
+
+static void conn_cacheClear(dpiConnCache *cache)
+{
+    while (cache->entries)
+        conn_cacheFreeEntry(cache, &cache->entries);
+}
+
+// returns the link pointing to the entry for key or to the list end
+static dpiConnCacheEntry **conn_cacheFind(
+    dpiConnCache *cache, ErlNifUInt64 hash, ERL_NIF_TERM key)
+{
+    dpiConnCacheEntry **link = &cache->entries;
+
+    while (*link &&
+           ((*link)->hash != hash || !enif_is_identical((*link)->key, key)))
+        link = &(*link)->next;
+
+    return link;
+}
+
+/*
+ * runs sql with positional binds and fetches up to CONN_CACHE_MAX_ROWS rows
+ * into env, moreRows tells whether there are more, returns STMT_DECODERS_OK
+ * on success, otherwise STMT_DECODERS_* of the failure
+ */
+static int conn_runQuery(
+    ErlNifEnv *env, dpiConn_res *connRes, ErlNifBinary *sql,
+    dpiData *binds, dpiNativeTypeNum *bindTypes, unsigned numBinds,
+    ERL_NIF_TERM *rows, int *moreRows)
+{
+    dpiStmt_res stmtRes;
+    dpiStmtInfo info;
+    uint32_t numCols;
+    int ret = STMT_DECODERS_DPI_ERROR;
+
+    dpiStmt_res_init(&stmtRes, connRes->context);
+    if (DPI_FAILURE ==
+        dpiConn_prepareStmt(
+            connRes->conn, 0, (const char *)sql->data, sql->size, NULL, 0,
+            &stmtRes.stmt))
+        return ret;
+
+    // DML or PL/SQL is rejected before it can run any side effect
+    if (DPI_FAILURE == dpiStmt_getInfo(stmtRes.stmt, &info))
+        goto cleanup;
+    if (!info.isQuery)
+    {
+        ret = STMT_DECODERS_NOT_QUERY;
+        goto cleanup;
+    }
+
+    for (unsigned i = 0; i < numBinds; i++)
+        if (DPI_FAILURE ==
+            dpiStmt_bindValueByPos(
+                stmtRes.stmt, i + 1, bindTypes[i], &binds[i]))
+            goto cleanup;
+
+    // a query, which leaves the session attributes alone
+    if (DPI_FAILURE == dpiStmt_execute(stmtRes.stmt, 0, &numCols))
+        goto cleanup;
+
+    ret = dpiStmt_res_checkDecoders(&stmtRes);
+    if (ret == STMT_DECODERS_OK &&
+        DPI_FAILURE ==
+            dpiStmt_res_fetchRows(
+                env, &stmtRes, CONN_CACHE_MAX_ROWS, rows, moreRows))
+        ret = STMT_DECODERS_DPI_ERROR;
+
+cleanup:
+    dpiStmt_res_freeDecoders(&stmtRes);
+    dpiStmt_release(stmtRes.stmt);
+
+    return ret;
+}
+
+DPI_NIF_FUN(conn_cachedQuery)
+{
+    CHECK_ARGCOUNT(4);
+
+    dpiConn_res *connRes;
+    ErlNifBinary sql;
+    unsigned numBinds;
+    uint32_t ttl;
+    int moreRows = 0;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_inspect_binary(env, argv[1], &sql))
+        BADARG_EXCEPTION(1, "binary/string sql");
+    if (!enif_get_list_length(env, argv[2], &numBinds))
+        BADARG_EXCEPTION(2, "list binds");
+    if (!enif_get_uint(env, argv[3], &ttl))
+        BADARG_EXCEPTION(3, "uint ttl");
+
+    dpiConnCache *cache = connRes->cache;
+    ERL_NIF_TERM key = enif_make_tuple2(env, argv[1], argv[2]);
+    ErlNifUInt64 hash = enif_hash(ERL_NIF_INTERNAL_HASH, key, 0);
+    ErlNifTime now = enif_monotonic_time(ERL_NIF_MSEC);
+    ERL_NIF_TERM rows, keys[] = {ATOM_cached, ATOM_rows}, values[2];
+
+    enif_mutex_lock(cache->lock);
+    dpiConnCacheEntry **link = conn_cacheFind(cache, hash, key);
+    if (*link && (*link)->expires > now)
+    {
+        cache->hits++;
+        rows = enif_make_copy(env, (*link)->rows);
+        enif_mutex_unlock(cache->lock);
+
+        values[0] = ATOM_TRUE;
+        values[1] = rows;
+
+        RETURNED_TRACE;
+        return MAKE_MAP(env, keys, values);
+    }
+    if (*link)
+        conn_cacheFreeEntry(cache, link);
+    cache->misses++;
+    enif_mutex_unlock(cache->lock);
+
+    dpiData *binds = enif_alloc(sizeof(dpiData) * (numBinds + 1));
+    dpiNativeTypeNum *bindTypes =
+        enif_alloc(sizeof(dpiNativeTypeNum) * (numBinds + 1));
+    ERL_NIF_TERM head, tail = argv[2];
+    for (unsigned i = 0; enif_get_list_cell(env, tail, &head, &tail); i++)
+        if (!dpiData_fromTerm(env, head, &binds[i], &bindTypes[i]))
+        {
+            enif_free(binds);
+            enif_free(bindTypes);
+            BADARG_EXCEPTION(2, "list binds of integer/float/binary/null");
+        }
+
+    int ret = conn_runQuery(
+        env, connRes, &sql, binds, bindTypes, numBinds, &rows, &moreRows);
+    enif_free(binds);
+    enif_free(bindTypes);
+    ORANIF_INJECT_LATENCY(env);
+    switch (ret)
+    {
+    case STMT_DECODERS_OK:
+        break;
+    case STMT_DECODERS_NOT_QUERY:
+        RAISE_STR_EXCEPTION("statement is not a query");
+    case STMT_DECODERS_UNSUPPORTED:
+        RAISE_STR_EXCEPTION("query has unsupported columns");
+    default:
+    {
+        dpiErrorInfo err;
+        dpiContext_getError(connRes->context, &err);
+        RAISE_EXCEPTION(dpiErrorInfoMap(env, err));
+    }
+    }
+    if (moreRows)
+        RAISE_STR_EXCEPTION("query result exceeds the cache row limit");
+
+    if (ttl > 0)
+    {
+        dpiConnCacheEntry *entry = enif_alloc(sizeof(dpiConnCacheEntry));
+        entry->hash = hash;
+        entry->env = enif_alloc_env();
+        entry->key = enif_make_copy(entry->env, key);
+        entry->rows = enif_make_copy(entry->env, rows);
+        entry->expires = enif_monotonic_time(ERL_NIF_MSEC) + ttl;
+
+        enif_mutex_lock(cache->lock);
+        // a concurrent miss may have filled the same key meanwhile
+        link = conn_cacheFind(cache, hash, key);
+        if (*link)
+            conn_cacheFreeEntry(cache, link);
+        if (cache->count >= CONN_CACHE_MAX_ENTRIES)
+        {
+            link = &cache->entries;
+            while ((*link)->next)
+                link = &(*link)->next;
+            conn_cacheFreeEntry(cache, link);
+        }
+        entry->next = cache->entries;
+        cache->entries = entry;
+        cache->count++;
+        enif_mutex_unlock(cache->lock);
+    }
+
+    values[0] = ATOM_FALSE;
+    values[1] = rows;
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
+
+    // #{rows => [[term]], cached => boolean}
+    RETURNED_TRACE;
+    return map;
+}
+
+DPI_NIF_FUN(conn_cacheInvalidate)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiConn_res *connRes;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+
+    enif_mutex_lock(connRes->cache->lock);
+    conn_cacheClear(connRes->cache);
+    enif_mutex_unlock(connRes->cache->lock);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(conn_cacheStats)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiConn_res *connRes;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+
+    dpiConnCache *cache = connRes->cache;
+    ERL_NIF_TERM keys[] = {ATOM_entries, ATOM_hits, ATOM_misses};
+    ERL_NIF_TERM values[3];
+    enif_mutex_lock(cache->lock);
+    values[0] = enif_make_uint(env, cache->count);
+    values[1] = enif_make_uint64(env, cache->hits);
+    values[2] = enif_make_uint64(env, cache->misses);
+    enif_mutex_unlock(cache->lock);
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
+
+    // #{hits => integer, misses => integer, entries => integer}
+    RETURNED_TRACE;
+    return map;
+}
+
+/*******************************************************************************
+ * Transaction batches
+ * a list of {Sql | Stmt, Binds} is executed in order with positional binds in
+ * a single call, the last statement with DPI_MODE_EXEC_COMMIT_ON_SUCCESS so
+ * that the commit travels with its execute, unless it is a query whose rows
+ * are checked before an explicit commit, the first failure rolls the
+ * transaction back
+ ******************************************************************************/
+
+// one statement of a batch, checked before anything is executed
+typedef struct
+{
+    ErlNifBinary sql;
+    dpiStmt_res *stmtRes; // NULL if the statement is prepared from sql
+    ERL_NIF_TERM binds;
+} dpiConnTxItem;
+
+// outcome of one statement of a batch
+typedef enum
+{
+    CONN_TX_OK,
+    CONN_TX_DPI_ERROR,   // the error info of the context tells
+    CONN_TX_UNSUPPORTED, // a query column can't be decoded
+    CONN_TX_TOO_MANY_ROWS
+} dpiConnTxStatus;
+
+/*
+ * executes one statement of a batch, result is the row list of a query or
+ * the row count otherwise, the last one commits the transaction
+ */
+static dpiConnTxStatus conn_runTxItem(
+    ErlNifEnv *env, dpiConn_res *connRes, dpiConnTxItem *item, int last,
+    ERL_NIF_TERM *result)
+{
+    dpiStmt_res tmpRes, *stmtRes = item->stmtRes;
+    ERL_NIF_TERM head, tail = item->binds;
+    dpiData bind;
+    dpiNativeTypeNum bindType;
+    dpiStmtInfo info;
+    dpiExecMode mode = DPI_MODE_EXEC_DEFAULT;
+    uint32_t numCols, pos = 1;
+    uint64_t rowCount;
+    int moreRows;
+    dpiConnTxStatus ret = CONN_TX_DPI_ERROR;
+
+    if (stmtRes)
+        dpiStmt_res_discardPrefetch(stmtRes);
+    else
+    {
+        stmtRes = &tmpRes;
+        dpiStmt_res_init(stmtRes, connRes->context);
+        if (DPI_FAILURE ==
+            dpiConn_prepareStmt(
+                connRes->conn, 0, (const char *)item->sql.data,
+                item->sql.size, NULL, 0, &stmtRes->stmt))
+            return ret;
+    }
+
+    // the binds were checked by conn_transaction, ODPI-C copies the values
+    for (; enif_get_list_cell(env, tail, &head, &tail); pos++)
+    {
+        dpiData_fromTerm(env, head, &bind, &bindType);
+        if (DPI_FAILURE ==
+            dpiStmt_bindValueByPos(stmtRes->stmt, pos, bindType, &bind))
+            goto cleanup;
+    }
+
+    // a query can still fail on its rows, it commits once they are fetched
+    if (last)
+    {
+        if (DPI_FAILURE == dpiStmt_getInfo(stmtRes->stmt, &info))
+            goto cleanup;
+        if (!info.isQuery)
+            mode = DPI_MODE_EXEC_COMMIT_ON_SUCCESS;
+    }
+
+    int dpiResult = dpiStmt_execute(stmtRes->stmt, mode, &numCols);
+    dpiConn_res_forgetAttrs(connRes, stmtRes->stmt);
+    if (DPI_FAILURE == dpiResult)
+        goto cleanup;
+
+    if (numCols > 0)
+    {
+        // the decoders of a caller's statement (defines, charset mode) are
+        // kept, the statement text and so its columns are the same
+        if (stmtRes->decoders && stmtRes->numCols != numCols)
+            dpiStmt_res_freeDecoders(stmtRes);
+        switch (dpiStmt_res_checkDecoders(stmtRes))
+        {
+        case STMT_DECODERS_OK:
+            if (DPI_SUCCESS ==
+                dpiStmt_res_fetchRows(
+                    env, stmtRes, CONN_TX_MAX_ROWS, result, &moreRows))
+                ret = moreRows ? CONN_TX_TOO_MANY_ROWS : CONN_TX_OK;
+            break;
+        case STMT_DECODERS_UNSUPPORTED:
+            ret = CONN_TX_UNSUPPORTED;
+            break;
+        default:
+            ret = CONN_TX_DPI_ERROR;
+        }
+        if (ret == CONN_TX_OK && last &&
+            DPI_FAILURE == dpiConn_commit(connRes->conn))
+            ret = CONN_TX_DPI_ERROR;
+    }
+    else if (DPI_SUCCESS == dpiStmt_getRowCount(stmtRes->stmt, &rowCount))
+    {
+        *result = enif_make_uint64(env, rowCount);
+        ret = CONN_TX_OK;
+    }
+
+cleanup:
+    if (stmtRes == &tmpRes)
+    {
+        dpiStmt_res_freeDecoders(stmtRes);
+        dpiStmt_release(stmtRes->stmt);
+    }
+
+    return ret;
+}
+
+DPI_NIF_FUN(conn_transaction)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiConn_res *connRes;
+    unsigned numItems, numBinds;
+    const ERL_NIF_TERM *tuple;
+    int arity;
+    ERL_NIF_TERM head, tail, bindHead, bindTail;
+    dpiData bind;
+    dpiNativeTypeNum bindType;
+    const char *error = NULL;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_get_list_length(env, argv[1], &numItems) || numItems == 0)
+        BADARG_EXCEPTION(1, "list of {sql or statement, binds}");
+
+    dpiConnTxItem *items = enif_alloc(numItems * sizeof(dpiConnTxItem));
+    tail = argv[1];
+    for (unsigned i = 0;
+         !error && enif_get_list_cell(env, tail, &head, &tail); i++)
+    {
+        dpiConnTxItem *item = &items[i];
+        item->stmtRes = NULL;
+        if (!enif_get_tuple(env, head, &arity, &tuple) || arity != 2 ||
+            !enif_get_list_length(env, tuple[1], &numBinds) ||
+            (!enif_get_resource(
+                 env, tuple[0], dpiStmt_type, (void **)&item->stmtRes) &&
+             !enif_inspect_binary(env, tuple[0], &item->sql)))
+        {
+            enif_free(items);
+            BADARG_EXCEPTION(1, "list of {sql or statement, binds}");
+        }
+        item->binds = tuple[1];
+        bindTail = tuple[1];
+        while (enif_get_list_cell(env, bindTail, &bindHead, &bindTail))
+            if (!dpiData_fromTerm(env, bindHead, &bind, &bindType))
+            {
+                enif_free(items);
+                BADARG_EXCEPTION(1, "list binds of integer/float/binary/null");
+            }
+        if (!item->stmtRes)
+            continue;
+        if (item->stmtRes->connRes != connRes)
+            error = "statement belongs to another connection";
+        else if (!dpiStmt_res_isOwner(env, item->stmtRes))
+            error = "statement is owned by another process";
+        else if (dpiStmt_res_isStreaming(item->stmtRes))
+            error = "statement is streaming";
+    }
+    if (error)
+    {
+        enif_free(items);
+        RAISE_STR_EXCEPTION(error);
+    }
+
+    ERL_NIF_TERM *results = enif_alloc(numItems * sizeof(ERL_NIF_TERM));
+    dpiConnTxStatus ret = CONN_TX_OK;
+    unsigned i = 0;
+    for (; ret == CONN_TX_OK && i < numItems; i++)
+        ret = conn_runTxItem(
+            env, connRes, &items[i], i == numItems - 1, &results[i]);
+    enif_free(items);
+    ORANIF_INJECT_LATENCY(env);
+
+    if (ret != CONN_TX_OK)
+    {
+        ERL_NIF_TERM errorMap = ATOM_NULL;
+        char message[80];
+        if (ret == CONN_TX_DPI_ERROR)
+        {
+            // converted first, the rollback overwrites the error info
+            dpiErrorInfo err;
+            dpiContext_getError(connRes->context, &err);
+            errorMap = dpiErrorInfoMap(env, err);
+            enif_make_map_put(
+                env, errorMap, ATOM_statement, enif_make_uint(env, i - 1),
+                &errorMap);
+        }
+        dpiConn_rollback(connRes->conn);
+        enif_free(results);
+        switch (ret)
+        {
+        case CONN_TX_UNSUPPORTED:
+            snprintf(
+                message, sizeof(message),
+                "query of statement %u has unsupported columns", i - 1);
+            RAISE_STR_EXCEPTION(message);
+        case CONN_TX_TOO_MANY_ROWS:
+            snprintf(
+                message, sizeof(message),
+                "query of statement %u exceeds the row limit", i - 1);
+            RAISE_STR_EXCEPTION(message);
+        default:
+            RAISE_EXCEPTION(errorMap);
+        }
+    }
+
+    ERL_NIF_TERM list = enif_make_list_from_array(env, results, numItems);
+    enif_free(results);
+
+    // [integer | [[term]]], row count or rows of every statement
+    RETURNED_TRACE;
+    return list;
+}
+
+DPI_NIF_FUN(conn_subscribe)
+{
+    CHECK_ARGCOUNT(3);
+
+    dpiConn_res *connRes;
+    ErlNifPid owner;
+    char nameStr[128];
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_is_map(env, argv[1]))
+        BADARG_EXCEPTION(1, "map params");
+    if (!enif_get_local_pid(env, argv[2], &owner))
+        BADARG_EXCEPTION(2, "pid owner");
+
+    dpiSubscrCreateParams params;
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        connRes->context,
+        dpiContext_initSubscrCreateParams(connRes->context, &params));
+    params.subscrNamespace = DPI_SUBSCR_NAMESPACE_DBCHANGE;
+    params.protocol = DPI_SUBSCR_PROTO_CALLBACK;
+    params.callback = dpiSubscr_callback;
+
+    ERL_NIF_TERM mapval, head, tail;
+    if (enif_get_map_value(env, argv[1], enif_make_atom(env, "qos"), &mapval))
+    {
+        dpiSubscrQOS qos = 0;
+        if (!enif_is_list(env, mapval))
+            BADARG_EXCEPTION(1, "atom list params.qos");
+        for (tail = mapval; enif_get_list_cell(env, tail, &head, &tail);)
+        {
+            DPI_SUBSCR_QOS_FROM_ATOM(head, qos);
+            params.qos |= qos;
+        }
+    }
+    if (enif_get_map_value(
+            env, argv[1], enif_make_atom(env, "operations"), &mapval))
+    {
+        dpiOpCode op = 0;
+        if (!enif_is_list(env, mapval))
+            BADARG_EXCEPTION(1, "atom list params.operations");
+        params.operations = 0;
+        for (tail = mapval; enif_get_list_cell(env, tail, &head, &tail);)
+        {
+            DPI_OPCODE_FROM_ATOM(head, op);
+            params.operations |= op;
+        }
+    }
+    if (enif_get_map_value(
+            env, argv[1], enif_make_atom(env, "timeout"), &mapval) &&
+        !enif_get_uint(env, mapval, &params.timeout))
+        BADARG_EXCEPTION(1, "uint params.timeout");
+    if (enif_get_map_value(
+            env, argv[1], enif_make_atom(env, "portNumber"), &mapval) &&
+        !enif_get_uint(env, mapval, &params.portNumber))
+        BADARG_EXCEPTION(1, "uint params.portNumber");
+    if (enif_get_map_value(env, argv[1], enif_make_atom(env, "name"), &mapval))
+    {
+        if (!enif_get_string(
+                env, mapval, nameStr, sizeof(nameStr), ERL_NIF_LATIN1))
+            BADARG_EXCEPTION(1, "string params.name");
+        params.name = nameStr;
+        params.nameLength = strlen(nameStr);
+    }
+
+    dpiSubscr_res *subscrRes;
+    ALLOC_RESOURCE(subscrRes, dpiSubscr);
+    subscrRes->subscr = NULL;
+    subscrRes->context = connRes->context;
+    subscrRes->connRes = connRes;
+    subscrRes->lock = enif_mutex_create("oranif_subscr");
+    subscrRes->owner = owner;
+    subscrRes->msgEnv = enif_alloc_env();
+    subscrRes->active = 1;
+    params.callbackContext = subscrRes;
+
+    RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
+        connRes->context,
+        dpiConn_subscribe(connRes->conn, &params, &subscrRes->subscr),
+        subscrRes, dpiSubscr);
+
+    // the connection must outlive the subscription
+    enif_keep_resource(connRes);
+
+    ERL_NIF_TERM subscrResTerm = enif_make_resource(env, subscrRes);
+
+    RETURNED_TRACE;
+    return subscrResTerm;
+}
+
+DPI_NIF_FUN(conn_unsubscribe)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiConn_res *connRes;
+    dpiSubscr_res *subscrRes;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_get_resource(env, argv[1], dpiSubscr_type, (void **)&subscrRes))
+        BADARG_EXCEPTION(1, "resource subscription");
+    if (subscrRes->connRes != connRes)
+        RAISE_STR_EXCEPTION("subscription belongs to another connection");
+    if (!subscrRes->active)
+        RAISE_STR_EXCEPTION("subscription is closed");
+
+    // no callbacks follow a successful unsubscribe
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        connRes->context,
+        dpiConn_unsubscribe(connRes->conn, subscrRes->subscr));
+
+    enif_mutex_lock(subscrRes->lock);
+    subscrRes->active = 0;
+    enif_mutex_unlock(subscrRes->lock);
+
+    dpiSubscr_release(subscrRes->subscr);
+    subscrRes->subscr = NULL;
+    enif_release_resource(connRes);
+    RELEASE_RESOURCE(subscrRes, dpiSubscr);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(conn_getObjectType)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiConn_res *connRes;
+    ErlNifBinary name;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_inspect_binary(env, argv[1], &name))
+        BADARG_EXCEPTION(1, "binary/string name");
+
+    dpiObjectType_res *objTypeRes;
+    ALLOC_RESOURCE(objTypeRes, dpiObjectType);
+
+    RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
+        connRes->context,
+        dpiConn_getObjectType(
+            connRes->conn, (const char *)name.data, name.size,
+            &objTypeRes->objType),
+        objTypeRes, dpiObjectType);
+    objTypeRes->context = connRes->context;
+
+    ERL_NIF_TERM objTypeResTerm = enif_make_resource(env, objTypeRes);
+
+    RETURNED_TRACE;
+    return objTypeResTerm;
+}
@@ -3,35 +3,202 @@
 
 #include "dpi_nif.h"
 #include "dpi.h"
+#include "dpiVar_nif.h"
+
+#define CONN_HEALTH_UNCHECKED 0
+#define CONN_HEALTH_ALIVE 1
+#define CONN_HEALTH_DEAD 2
+
+/*
+ * background health checker pinging a connection every interval, guarded by
+ * the lock of the connection
+ */
+typedef struct
+{
+    uint32_t interval; // milliseconds
+    int stop;
+    int state; // CONN_HEALTH_*
+    uint64_t checks;
+    ErlNifTime lastCheck; // monotonic milliseconds, 0 if never checked
+    ErlNifEnv *errorEnv;
+    ERL_NIF_TERM error; // error map of the last failed ping
+} dpiConnHealth;
+
+// upper bound of cached results per connection, the oldest entry is evicted
+#define CONN_CACHE_MAX_ENTRIES 256
+// upper bound of rows of a cached result, larger results raise
+#define CONN_CACHE_MAX_ROWS 10000
+// upper bound of rows of a query in conn_transaction, larger results raise
+#define CONN_TX_MAX_ROWS CONN_CACHE_MAX_ROWS
+
+typedef struct dpiConnCacheEntry
+{
+    struct dpiConnCacheEntry *next;
+    ErlNifUInt64 hash;
+    ErlNifEnv *env;
+    ERL_NIF_TERM key;  // {Sql, Binds}
+    ERL_NIF_TERM rows;
+    ErlNifTime expires; // monotonic milliseconds
+} dpiConnCacheEntry;
+
+// client side query result cache, newest entries first
+typedef struct
+{
+    ErlNifMutex *lock;
+    dpiConnCacheEntry *entries;
+    uint32_t count;
+    uint64_t hits;
+    uint64_t misses;
+} dpiConnCache;
+
+// upper bound of idle variables kept per connection
+#define CONN_VAR_POOL_MAX_ENTRIES 64
+
+// idle variable with its buffers and element handles
+typedef struct dpiConnVarPoolEntry
+{
+    struct dpiConnVarPoolEntry *next;
+    dpiVarKey key;
+    dpiVar *var;
+    dpiData *data;
+    dpiDataPtr_res *slab;
+    uint64_t memBytes; // still charged to the connection
+} dpiConnVarPoolEntry;
+
+// variables returned by conn_recycleVar, handed out again by conn_newVar
+typedef struct
+{
+    ErlNifMutex *lock;
+    dpiConnVarPoolEntry *entries;
+    uint32_t count;
+    uint64_t hits;
+    uint64_t misses;
+} dpiConnVarPool;
+
+// session attributes cached by the connection, see conn_setSessionAttr
+#define CONN_ATTR_CLIENT_IDENTIFIER 0
+#define CONN_ATTR_MODULE 1
+#define CONN_ATTR_ACTION 2
+#define CONN_ATTR_CLIENT_INFO 3
+#define CONN_ATTR_DB_OP 4
+#define CONN_ATTRS 5
+
+// last value handed to ODPI-C, value is NULL if never set
+typedef struct
+{
+    char *value;
+    uint32_t length;
+} dpiConnAttr;
+
+typedef struct
+{
+    ErlNifMutex *lock;
+    dpiConnAttr attrs[CONN_ATTRS];
+    uint64_t sent;
+    uint64_t skipped;
+} dpiConnAttrs;
 
 typedef struct
 {
     dpiConn *conn;
     dpiContext *context;
+    ErlNifMutex *lock; // guards health and lastUse
+    ErlNifCond *cond;  // signalled when the health checker is done
+    dpiConnHealth *health; // the running checker keeps the resource
+    ErlNifTime lastUse; // monotonic milliseconds of the last round trip
+    dpiConnCache *cache;
+    dpiConnVarPool *varPool;
+    dpiConnAttrs *attrs;
+    uint64_t memBytes; // native memory of its variables, see conn_memoryUsage
 } dpiConn_res;
 
 extern ErlNifResourceType *dpiConn_type;
 extern void dpiConn_res_dtor(ErlNifEnv *env, void *resource);
+extern void dpiConn_res_stopHealthCheck(dpiConn_res *connRes);
+extern void dpiConn_res_touch(dpiConn_res *connRes);
+extern void dpiConn_res_forgetAttrs(dpiConn_res *connRes, dpiStmt *stmt);
 
 extern DPI_NIF_FUN(conn_close);
 extern DPI_NIF_FUN(conn_commit);
 extern DPI_NIF_FUN(conn_create);
 extern DPI_NIF_FUN(conn_getServerVersion);
 extern DPI_NIF_FUN(conn_newVar);
+extern DPI_NIF_FUN(conn_newArrayVar);
+extern DPI_NIF_FUN(conn_recycleVar);
+extern DPI_NIF_FUN(conn_varPoolStats);
+extern DPI_NIF_FUN(conn_memoryUsage);
 extern DPI_NIF_FUN(conn_ping);
 extern DPI_NIF_FUN(conn_prepareStmt);
 extern DPI_NIF_FUN(conn_rollback);
 extern DPI_NIF_FUN(conn_setClientIdentifier);
+extern DPI_NIF_FUN(conn_setModule);
+extern DPI_NIF_FUN(conn_setAction);
+extern DPI_NIF_FUN(conn_setClientInfo);
+extern DPI_NIF_FUN(conn_setDbOp);
+extern DPI_NIF_FUN(conn_sessionAttrStats);
+extern DPI_NIF_FUN(conn_startHealthCheck);
+extern DPI_NIF_FUN(conn_stopHealthCheck);
+extern DPI_NIF_FUN(conn_getHealth);
+extern DPI_NIF_FUN(conn_setStmtCacheSize);
+extern DPI_NIF_FUN(conn_getStmtCacheSize);
+extern DPI_NIF_FUN(conn_cachedQuery);
+extern DPI_NIF_FUN(conn_cacheInvalidate);
+extern DPI_NIF_FUN(conn_cacheStats);
+extern DPI_NIF_FUN(conn_transaction);
+extern DPI_NIF_FUN(conn_subscribe);
+extern DPI_NIF_FUN(conn_unsubscribe);
+extern DPI_NIF_FUN(conn_getObjectType);
+
+#define DPICONN_NIFS                          \
+    IOB_NIF(conn_close, 3),                   \
+        IOB_NIF(conn_commit, 1),              \
+        IOB_NIF(conn_create, 6),              \
+        IOB_NIF(conn_getServerVersion, 1),    \
+        DEF_NIF(conn_newVar, 8),              \
+        IOB_NIF(conn_newArrayVar, 5),         \
+        DEF_NIF(conn_recycleVar, 2),          \
+        DEF_NIF(conn_varPoolStats, 1),        \
+        DEF_NIF(conn_memoryUsage, 1),         \
+        IOB_NIF(conn_ping, 1),                \
+        IOB_NIF(conn_prepareStmt, 4),         \
+        IOB_NIF(conn_rollback, 1),            \
+        DEF_NIF(conn_setClientIdentifier, 2), \
+        DEF_NIF(conn_setModule, 2),           \
+        DEF_NIF(conn_setAction, 2),           \
+        DEF_NIF(conn_setClientInfo, 2),       \
+        DEF_NIF(conn_setDbOp, 2),             \
+        DEF_NIF(conn_sessionAttrStats, 1),    \
+        DEF_NIF(conn_startHealthCheck, 2),    \
+        IOB_NIF(conn_stopHealthCheck, 1),     \
+        DEF_NIF(conn_getHealth, 1),           \
+        DEF_NIF(conn_setStmtCacheSize, 2),    \
+        DEF_NIF(conn_getStmtCacheSize, 1),    \
+        IOB_NIF(conn_cachedQuery, 4),         \
+        DEF_NIF(conn_cacheInvalidate, 1),     \
+        DEF_NIF(conn_cacheStats, 1),          \
+        IOB_NIF(conn_transaction, 2),         \
+        IOB_NIF(conn_subscribe, 3),           \
+        IOB_NIF(conn_unsubscribe, 2),         \
+        IOB_NIF(conn_getObjectType, 2)
+
+#define DPI_CREATE_MODE_FROM_ATOM(_atom, _assign)         \
+    A2M(DPI_MODE_CREATE_DEFAULT, _atom, _assign);         \
+    else A2M(DPI_MODE_CREATE_THREADED, _atom, _assign);   \
+    else A2M(DPI_MODE_CREATE_EVENTS, _atom, _assign);     \
+    else BADARG_EXCEPTION(4, "DPI_MODE_CREATE atom")
+
+#define DPI_AUTH_MODE_FROM_ATOM(_atom, _assign)        \
+    A2M(DPI_MODE_AUTH_DEFAULT, _atom, _assign);        \
+    else A2M(DPI_MODE_AUTH_SYSDBA, _atom, _assign);    \
+    else A2M(DPI_MODE_AUTH_SYSOPER, _atom, _assign);   \
+    else A2M(DPI_MODE_AUTH_PRELIM, _atom, _assign);    \
+    else A2M(DPI_MODE_AUTH_SYSASM, _atom, _assign);    \
+    else BADARG_EXCEPTION(5, "DPI_MODE_AUTH atom")
 
-#define DPICONN_NIFS                       \
-    DEF_NIF(conn_close, 3),                \
-        DEF_NIF(conn_commit, 1),           \
-        IOB_NIF(conn_create, 6),           \
-        DEF_NIF(conn_getServerVersion, 1), \
-        DEF_NIF(conn_newVar, 8),           \
-        DEF_NIF(conn_ping, 1),             \
-        IOB_NIF(conn_prepareStmt, 4),      \
-        DEF_NIF(conn_rollback, 1),         \
-        DEF_NIF(conn_setClientIdentifier, 2)
+#define DPI_PURITY_FROM_ATOM(_atom, _assign)     \
+    A2M(DPI_PURITY_DEFAULT, _atom, _assign);     \
+    else A2M(DPI_PURITY_NEW, _atom, _assign);    \
+    else A2M(DPI_PURITY_SELF, _atom, _assign);   \
+    else BADARG_EXCEPTION(5, "DPI_PURITY atom")
 
 #endif // _conn_NIF_H_
@@ -79,31 +79,17 @@ DPI_NIF_FUN(context_getClientVersion)
         contextRes->context,
         dpiContext_getClientVersion(contextRes->context, &version));
 
-    ERL_NIF_TERM map = enif_make_new_map(env);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "versionNum"),
-        enif_make_int(env, version.versionNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "releaseNum"),
-        enif_make_int(env, version.releaseNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "updateNum"),
-        enif_make_int(env, version.updateNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "portReleaseNum"),
-        enif_make_int(env, version.portReleaseNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "portUpdateNum"),
-        enif_make_int(env, version.portUpdateNum), &map);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "fullVersionNum"),
-        enif_make_int(env, version.fullVersionNum), &map);
+    ERL_NIF_TERM keys[] = {
+        ATOM_fullVersionNum, ATOM_portReleaseNum, ATOM_portUpdateNum,
+        ATOM_releaseNum, ATOM_updateNum, ATOM_versionNum};
+    ERL_NIF_TERM values[] = {
+        enif_make_int(env, version.fullVersionNum),
+        enif_make_int(env, version.portReleaseNum),
+        enif_make_int(env, version.portUpdateNum),
+        enif_make_int(env, version.releaseNum),
+        enif_make_int(env, version.updateNum),
+        enif_make_int(env, version.versionNum)};
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
 
     /* #{versionNum => integer, releaseNum => integer, updateNum => integer,
          portReleaseNum => integer, portUpdateNum => integer,
@@ -1,5 +1,7 @@
 #include "dpiData_nif.h"
 #include "dpiStmt_nif.h"
+#include "dpiObject_nif.h"
+#include "dpiVar_nif.h"
 
 #ifndef __WIN32__
 #include <string.h>
@@ -19,13 +21,47 @@ void dpiData_res_dtor(ErlNifEnv *env, void *resource)
         enif_free_env(data->env);
         data->env = NULL;
     }
+    oranif_memRelease(env, ORANIF_MEM_DATA, NULL, data->memBytes);
+    data->memBytes = 0;
 
     RETURNED_TRACE;
 }
 
+/*
+ * resolves a data pointer resource or a {Var, Index} element handle of a
+ * variable created by conn_newVar
+ */
+int dpiDataPtr_get(
+    ErlNifEnv *env, ERL_NIF_TERM term, dpiDataPtr_res **dataPtr)
+{
+    const ERL_NIF_TERM *tuple;
+    dpiVar_res *varRes;
+    unsigned index;
+    int arity;
+
+    if (enif_get_resource(env, term, dpiDataPtr_type, (void **)dataPtr))
+        return 1;
+    if (!enif_get_tuple(env, term, &arity, &tuple) || arity != 2 ||
+        !enif_get_resource(env, tuple[0], dpiVar_type, (void **)&varRes) ||
+        !enif_get_uint(env, tuple[1], &index) || !varRes->slab ||
+        index >= varRes->maxArraySize)
+        return 0;
+    *dataPtr = &varRes->slab[index];
+
+    return 1;
+}
+
 void dpiDataPtr_res_dtor(ErlNifEnv *env, void *resource)
 {
     CALL_TRACE;
+
+    dpiDataPtr_res *dataPtr = (dpiDataPtr_res *)resource;
+    if (dataPtr->connRes)
+    {
+        enif_release_resource(dataPtr->connRes);
+        dataPtr->connRes = NULL;
+    }
+
     RETURNED_TRACE;
 }
 
@@ -37,6 +73,7 @@ DPI_NIF_FUN(data_ctor)
     ALLOC_RESOURCE(data, dpiData);
 
     data->dpiData.isNull = 1; // starts out being null
+    data->memBytes = 0;
 
     // erlang process independent environment to persist data between NIF calls
     data->env = enif_alloc_env();
@@ -57,7 +94,7 @@ DPI_NIF_FUN(data_setTimestamp)
     int year, month, day, hour, minute, second, fsecond, tzHourOffset,
         tzMinuteOffset;
 
-    if (enif_get_resource(env, argv[0], dpiDataPtr_type, (void **)&dataPtr))
+    if (dpiDataPtr_get(env, argv[0], &dataPtr))
         data = dataPtr->dpiDataPtr;
     else if (enif_get_resource(env, argv[0], dpiData_type, (void **)&dataRes))
         data = &dataRes->dpiData;
@@ -101,7 +138,7 @@ DPI_NIF_FUN(data_setIntervalDS)
 
     int days, hours, minutes, seconds, fseconds;
 
-    if (enif_get_resource(env, argv[0], dpiDataPtr_type, (void **)&dataPtr))
+    if (dpiDataPtr_get(env, argv[0], &dataPtr))
         data = dataPtr->dpiDataPtr;
     else if (enif_get_resource(env, argv[0], dpiData_type, (void **)&dataRes))
         data = &dataRes->dpiData;
@@ -136,7 +173,7 @@ DPI_NIF_FUN(data_setIntervalYM)
 
     int years, months;
 
-    if (enif_get_resource(env, argv[0], dpiDataPtr_type, (void **)&dataPtr))
+    if (dpiDataPtr_get(env, argv[0], &dataPtr))
         data = dataPtr->dpiDataPtr;
     else if (enif_get_resource(env, argv[0], dpiData_type, (void **)&dataRes))
         data = &dataRes->dpiData;
@@ -164,7 +201,7 @@ DPI_NIF_FUN(data_setInt64)
 
     int64_t amount;
 
-    if (enif_get_resource(env, argv[0], dpiDataPtr_type, (void **)&dataPtr))
+    if (dpiDataPtr_get(env, argv[0], &dataPtr))
         data = dataPtr->dpiDataPtr;
     else if (enif_get_resource(env, argv[0], dpiData_type, (void **)&dataRes))
         data = &dataRes->dpiData;
@@ -192,12 +229,30 @@ DPI_NIF_FUN(data_setBytes)
     else
         BADARG_EXCEPTION(0, "resource data/ptr");
 
-    // binary is copied to process independent env for NIF calls persistance
-    ERL_NIF_TERM binData = enif_make_copy(dataRes->env, argv[1]);
     ErlNifBinary ptr;
-    if (!enif_inspect_binary(dataRes->env, binData, &ptr))
+    if (!enif_inspect_binary(env, argv[1], &ptr))
         BADARG_EXCEPTION(1, "binary data");
 
+    /*
+     * env keeps the binary alive until it is replaced or the resource is
+     * gone, a shared refc binary is pinned as well, so every size counts
+     */
+    uint64_t oldBytes = dataRes->memBytes;
+    oranif_memRelease(env, ORANIF_MEM_DATA, &dataRes->memBytes, oldBytes);
+    if (!oranif_memCharge(
+            env, ORANIF_MEM_DATA, &dataRes->memBytes, ptr.size, 0))
+    {
+        // the earlier binary is still set
+        oranif_memCharge(
+            env, ORANIF_MEM_DATA, &dataRes->memBytes, oldBytes, 1);
+        RAISE_STR_EXCEPTION(ORANIF_MEM_LIMIT_ERROR);
+    }
+    enif_clear_env(dataRes->env);
+
+    // binary is copied to process independent env for NIF calls persistance
+    ERL_NIF_TERM binData = enif_make_copy(dataRes->env, argv[1]);
+    enif_inspect_binary(dataRes->env, binData, &ptr);
+
     dpiData_setBytes(data, (char *)ptr.data, ptr.size);
 
     RETURNED_TRACE;
@@ -212,7 +267,7 @@ DPI_NIF_FUN(data_setIsNull)
     dpiDataPtr_res *dataPtr;
     dpiData *data;
 
-    if (enif_get_resource(env, argv[0], dpiDataPtr_type, (void **)&dataPtr))
+    if (dpiDataPtr_get(env, argv[0], &dataPtr))
         data = dataPtr->dpiDataPtr;
     else if (enif_get_resource(env, argv[0], dpiData_type, (void **)&dataRes))
         data = &dataRes->dpiData;
@@ -230,13 +285,373 @@ DPI_NIF_FUN(data_setIsNull)
     return ATOM_OK;
 }
 
+/*
+ * fills data from a plain erlang bind value: integer, float, binary or null,
+ * binaries are referenced, not copied, so the term must outlive the call that
+ * uses data, returns 0 for unsupported terms
+ */
+int dpiData_fromTerm(
+    ErlNifEnv *env, ERL_NIF_TERM term, dpiData *data,
+    dpiNativeTypeNum *nativeType)
+{
+    ErlNifSInt64 i64;
+    double dbl;
+    ErlNifBinary bin;
+
+    if (enif_get_int64(env, term, &i64))
+    {
+        dpiData_setInt64(data, i64);
+        *nativeType = DPI_NATIVE_TYPE_INT64;
+    }
+    else if (enif_get_double(env, term, &dbl))
+    {
+        dpiData_setDouble(data, dbl);
+        *nativeType = DPI_NATIVE_TYPE_DOUBLE;
+    }
+    else if (enif_inspect_binary(env, term, &bin))
+    {
+        dpiData_setBytes(data, (char *)bin.data, bin.size);
+        *nativeType = DPI_NATIVE_TYPE_BYTES;
+    }
+    else if (enif_compare(term, ATOM_NULL) == 0)
+    {
+        dpiData_setNull(data);
+        *nativeType = DPI_NATIVE_TYPE_BYTES;
+    }
+    else
+        return 0;
+
+    return 1;
+}
+
+/*******************************************************************************
+ * Type specific decoders
+ * each decoder exists in two flavours, the *_null variant checks isNull first
+ * and is used for all query columns, the plain one where isNull was checked
+ * before
+ ******************************************************************************/
+
+#define DEF_DECODER(_name)                                                  \
+    static int _name(ErlNifEnv *, dpiData *, ERL_NIF_TERM *);               \
+    static int _name##_null(ErlNifEnv *env, dpiData *data, ERL_NIF_TERM *t) \
+    {                                                                       \
+        if (data->isNull)                                                   \
+        {                                                                   \
+            *t = ATOM_NULL;                                                 \
+            return DPI_SUCCESS;                                             \
+        }                                                                   \
+        return _name(env, data, t);                                         \
+    }                                                                       \
+    static int _name(ErlNifEnv *env, dpiData *data, ERL_NIF_TERM *t)
+
+DEF_DECODER(decodeInt64)
+{
+    *t = enif_make_int64(env, data->value.asInt64);
+    return DPI_SUCCESS;
+}
+
+DEF_DECODER(decodeUint64)
+{
+    *t = enif_make_uint64(env, data->value.asUint64);
+    return DPI_SUCCESS;
+}
+
+DEF_DECODER(decodeFloat)
+{
+    *t = enif_make_double(env, data->value.asFloat);
+    return DPI_SUCCESS;
+}
+
+DEF_DECODER(decodeDouble)
+{
+    *t = enif_make_double(env, data->value.asDouble);
+    return DPI_SUCCESS;
+}
+
+DEF_DECODER(decodeBytes)
+{
+    memcpy(
+        enif_make_new_binary(env, data->value.asBytes.length, t),
+        data->value.asBytes.ptr, data->value.asBytes.length);
+    return DPI_SUCCESS;
+}
+
+DEF_DECODER(decodeTimestamp)
+{
+    dpiTimestamp *ts = &data->value.asTimestamp;
+    ERL_NIF_TERM keys[] = {
+        ATOM_day, ATOM_fsecond, ATOM_hour, ATOM_minute, ATOM_month,
+        ATOM_second, ATOM_tzHourOffset, ATOM_tzMinuteOffset, ATOM_year};
+    ERL_NIF_TERM values[] = {
+        enif_make_uint(env, ts->day), enif_make_uint(env, ts->fsecond),
+        enif_make_uint(env, ts->hour), enif_make_uint(env, ts->minute),
+        enif_make_uint(env, ts->month), enif_make_uint(env, ts->second),
+        enif_make_int(env, ts->tzHourOffset),
+        enif_make_int(env, ts->tzMinuteOffset), enif_make_int(env, ts->year)};
+    *t = MAKE_MAP(env, keys, values);
+    return DPI_SUCCESS;
+}
+
+DEF_DECODER(decodeIntervalDS)
+{
+    dpiIntervalDS *ds = &data->value.asIntervalDS;
+    ERL_NIF_TERM keys[] = {
+        ATOM_days, ATOM_fseconds, ATOM_hours, ATOM_minutes, ATOM_seconds};
+    ERL_NIF_TERM values[] = {
+        enif_make_uint(env, ds->days), enif_make_uint(env, ds->fseconds),
+        enif_make_uint(env, ds->hours), enif_make_uint(env, ds->minutes),
+        enif_make_uint(env, ds->seconds)};
+    *t = MAKE_MAP(env, keys, values);
+    return DPI_SUCCESS;
+}
+
+DEF_DECODER(decodeIntervalYM)
+{
+    ERL_NIF_TERM keys[] = {ATOM_months, ATOM_years};
+    ERL_NIF_TERM values[] = {
+        enif_make_uint(env, data->value.asIntervalYM.months),
+        enif_make_uint(env, data->value.asIntervalYM.years)};
+    *t = MAKE_MAP(env, keys, values);
+    return DPI_SUCCESS;
+}
+
+DEF_DECODER(decodeRowid)
+{
+    const char *string;
+    uint32_t stringlen;
+    if (DPI_FAILURE ==
+        dpiRowid_getStringValue(data->value.asRowid, &string, &stringlen))
+        return DPI_FAILURE;
+    memcpy(enif_make_new_binary(env, stringlen, t), string, stringlen);
+    return DPI_SUCCESS;
+}
+
+/*
+ * NUMBER values fetched as bytes are decoded straight from their text form
+ * ([-]digits[.digits][E[+-]digits]) into an integer if the value is
+ * integral, or {Mantissa, Exponent} (Mantissa * 10^Exponent) otherwise,
+ * with trailing zeros of the fraction stripped. Mantissas longer than 18
+ * digits are built as bignums nine digits at a time and handed to the VM in
+ * external term format. Text that can't be parsed is returned as a binary
+ */
+#define DECIMAL_MAX_DIGITS 192
+#define DECIMAL_MAX_LIMBS (DECIMAL_MAX_DIGITS / 9 + 1)
+
+static ERL_NIF_TERM decimal_makeInteger(
+    ErlNifEnv *env, const char *digits, int numDigits, int negative)
+{
+    uint32_t limbs[DECIMAL_MAX_LIMBS], chunk;
+    int numLimbs = 0, i = 0, chunkLen;
+
+    if (numDigits <= 18)
+    {
+        int64_t value = 0;
+        for (; i < numDigits; i++)
+            value = value * 10 + (digits[i] - '0');
+        return enif_make_int64(env, negative ? -value : value);
+    }
+
+    // limbs = limbs * 10^9 + next chunk of (up to) nine digits
+    chunkLen = numDigits % 9 ? numDigits % 9 : 9;
+    while (i < numDigits)
+    {
+        uint64_t carry;
+        for (chunk = 0; chunkLen > 0; chunkLen--, i++)
+            chunk = chunk * 10 + (digits[i] - '0');
+        carry = chunk;
+        for (int l = 0; l < numLimbs; l++)
+        {
+            uint64_t v = (uint64_t)limbs[l] * 1000000000 + carry;
+            limbs[l] = (uint32_t)v;
+            carry = v >> 32;
+        }
+        if (carry)
+            limbs[numLimbs++] = (uint32_t)carry;
+        chunkLen = 9;
+    }
+
+    // SMALL_BIG_EXT: 131, 110, byte count, sign, little endian bytes
+    unsigned char ext[4 + DECIMAL_MAX_LIMBS * 4];
+    int numBytes = numLimbs * 4;
+    for (int l = 0; l < numLimbs; l++)
+    {
+        ext[4 + l * 4] = (unsigned char)limbs[l];
+        ext[5 + l * 4] = (unsigned char)(limbs[l] >> 8);
+        ext[6 + l * 4] = (unsigned char)(limbs[l] >> 16);
+        ext[7 + l * 4] = (unsigned char)(limbs[l] >> 24);
+    }
+    while (numBytes > 0 && ext[3 + numBytes] == 0)
+        numBytes--;
+    ext[0] = 131;
+    ext[1] = 110;
+    ext[2] = (unsigned char)numBytes;
+    ext[3] = negative ? 1 : 0;
+
+    ERL_NIF_TERM term;
+    if (!enif_binary_to_term(env, ext, 4 + numBytes, &term, 0))
+        return enif_make_badarg(env);
+    return term;
+}
+
+DEF_DECODER(decodeDecimal)
+{
+    const char *p = data->value.asBytes.ptr,
+               *end = p + data->value.asBytes.length;
+    char digits[DECIMAL_MAX_DIGITS];
+    int numDigits = 0, negative = 0, exponent = 0, seenDigit = 0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        seenDigit = 1;
+        if (numDigits == 0 && *p == '0')
+            continue;
+        if (numDigits == DECIMAL_MAX_DIGITS)
+            return decodeBytes(env, data, t);
+        digits[numDigits++] = *p;
+    }
+    if (p < end && *p == '.')
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            seenDigit = 1;
+            exponent--;
+            if (numDigits == 0 && *p == '0')
+                continue;
+            if (numDigits == DECIMAL_MAX_DIGITS)
+                return decodeBytes(env, data, t);
+            digits[numDigits++] = *p;
+        }
+    if (p < end && (*p == 'E' || *p == 'e'))
+    {
+        int expNegative = 0, exp = 0;
+        if (++p < end && (*p == '-' || *p == '+'))
+            expNegative = (*p++ == '-');
+        if (p == end)
+            return decodeBytes(env, data, t);
+        for (; p < end && *p >= '0' && *p <= '9' && exp < 10000; p++)
+            exp = exp * 10 + (*p - '0');
+        exponent += expNegative ? -exp : exp;
+    }
+    if (p != end || !seenDigit)
+        return decodeBytes(env, data, t);
+
+    if (numDigits == 0)
+    {
+        *t = enif_make_int(env, 0);
+        return DPI_SUCCESS;
+    }
+    while (exponent < 0 && digits[numDigits - 1] == '0')
+    {
+        numDigits--;
+        exponent++;
+    }
+    if (exponent > 0)
+    {
+        if (numDigits + exponent > DECIMAL_MAX_DIGITS)
+            return decodeBytes(env, data, t);
+        memset(digits + numDigits, '0', exponent);
+        numDigits += exponent;
+        exponent = 0;
+    }
+
+    *t = decimal_makeInteger(env, digits, numDigits, negative);
+    if (exponent < 0)
+        *t = enif_make_tuple2(env, *t, enif_make_int(env, exponent));
+    return DPI_SUCCESS;
+}
+
+dpiDataDecoder dpiData_getDecimalDecoder(int nullOk)
+{
+    return nullOk ? decodeDecimal_null : decodeDecimal;
+}
+
+/*
+ * string decoders of stmt_setCharsetMode, invalid UTF-8 is returned as
+ * {invalid_utf8, Bytes} instead of failing the whole fetch
+ */
+DEF_DECODER(decodeUtf8)
+{
+    if (dpiCharset_isUtf8(
+            (const unsigned char *)data->value.asBytes.ptr,
+            data->value.asBytes.length))
+        return decodeBytes(env, data, t);
+
+    ERL_NIF_TERM bytes;
+    decodeBytes(env, data, &bytes);
+    *t = enif_make_tuple2(env, enif_make_atom(env, "invalid_utf8"), bytes);
+    return DPI_SUCCESS;
+}
+
+static void decodeSingleByte(
+    ErlNifEnv *env, const dpiCharsetTable table, dpiData *data,
+    ERL_NIF_TERM *t)
+{
+    const unsigned char *s = (const unsigned char *)data->value.asBytes.ptr;
+    size_t len = data->value.asBytes.length;
+
+    dpiCharset_sbToUtf8(
+        table, s, len,
+        enif_make_new_binary(
+            env, dpiCharset_sbToUtf8Length(table, s, len), t));
+}
+
+DEF_DECODER(decodeWe8mswin1252)
+{
+    decodeSingleByte(env, dpiCharset_we8mswin1252, data, t);
+    return DPI_SUCCESS;
+}
+
+DEF_DECODER(decodeWe8iso8859p1)
+{
+    decodeSingleByte(env, dpiCharset_we8iso8859p1, data, t);
+    return DPI_SUCCESS;
+}
+
+dpiDataDecoder dpiData_getCharsetDecoder(int charsetMode, int nullOk)
+{
+    switch (charsetMode)
+    {
+    case DPI_CHARSET_UTF8:
+        return nullOk ? decodeUtf8_null : decodeUtf8;
+    case DPI_CHARSET_WE8MSWIN1252:
+        return nullOk ? decodeWe8mswin1252_null : decodeWe8mswin1252;
+    case DPI_CHARSET_WE8ISO8859P1:
+        return nullOk ? decodeWe8iso8859p1_null : decodeWe8iso8859p1;
+    default:
+        return NULL;
+    }
+}
+
+#define CASE_DECODER(_type, _name, _nullOk) \
+    case _type:                             \
+        return (_nullOk) ? _name##_null : _name
+
+dpiDataDecoder dpiData_getDecoder(dpiNativeTypeNum type, int nullOk)
+{
+    switch (type)
+    {
+        CASE_DECODER(DPI_NATIVE_TYPE_INT64, decodeInt64, nullOk);
+        CASE_DECODER(DPI_NATIVE_TYPE_UINT64, decodeUint64, nullOk);
+        CASE_DECODER(DPI_NATIVE_TYPE_FLOAT, decodeFloat, nullOk);
+        CASE_DECODER(DPI_NATIVE_TYPE_DOUBLE, decodeDouble, nullOk);
+        CASE_DECODER(DPI_NATIVE_TYPE_BYTES, decodeBytes, nullOk);
+        CASE_DECODER(DPI_NATIVE_TYPE_TIMESTAMP, decodeTimestamp, nullOk);
+        CASE_DECODER(DPI_NATIVE_TYPE_INTERVAL_DS, decodeIntervalDS, nullOk);
+        CASE_DECODER(DPI_NATIVE_TYPE_INTERVAL_YM, decodeIntervalYM, nullOk);
+        CASE_DECODER(DPI_NATIVE_TYPE_ROWID, decodeRowid, nullOk);
+    default:
+        return NULL;
+    }
+}
+
 DPI_NIF_FUN(data_get)
 {
     CHECK_ARGCOUNT(1);
 
     dpiDataPtr_res *dataRes;
 
-    if (!enif_get_resource(env, argv[0], dpiDataPtr_type, (void **)&dataRes))
+    if (!dpiDataPtr_get(env, argv[0], &dataRes))
         BADARG_EXCEPTION(0, "resource data");
 
     ERL_NIF_TERM dataRet;
@@ -249,125 +664,54 @@ DPI_NIF_FUN(data_get)
         return ATOM_NULL;
     }
 
-    switch (dataRes->type)
-    {
-    case DPI_NATIVE_TYPE_INT64:
-        dataRet = enif_make_int64(env, data->value.asInt64);
-        break;
-    case DPI_NATIVE_TYPE_UINT64:
-        dataRet = enif_make_uint64(env, data->value.asUint64);
-        break;
-    case DPI_NATIVE_TYPE_FLOAT:
-        dataRet = enif_make_double(env, data->value.asFloat);
-        break;
-    case DPI_NATIVE_TYPE_DOUBLE:
-        dataRet = enif_make_double(env, data->value.asDouble);
-        break;
-    case DPI_NATIVE_TYPE_BYTES:
-    {
-        ErlNifBinary bin;
-        enif_alloc_binary(data->value.asBytes.length, &bin);
-        memcpy(bin.data, data->value.asBytes.ptr, data->value.asBytes.length);
-        dataRet = enif_make_binary(env, &bin);
-    }
-    break;
-    case DPI_NATIVE_TYPE_TIMESTAMP:
-        dataRet = enif_make_new_map(env);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "fsecond"),
-            enif_make_uint(env, data->value.asTimestamp.fsecond),
-            &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "second"),
-            enif_make_uint(env, data->value.asTimestamp.second),
-            &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "minute"),
-            enif_make_uint(env, data->value.asTimestamp.minute),
-            &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "hour"),
-            enif_make_uint(env, data->value.asTimestamp.hour),
-            &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "day"),
-            enif_make_uint(env, data->value.asTimestamp.day),
-            &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "month"),
-            enif_make_uint(env, data->value.asTimestamp.month),
-            &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "year"),
-            enif_make_int(env, data->value.asTimestamp.year),
-            &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "tzMinuteOffset"),
-            enif_make_int(env, data->value.asTimestamp.tzMinuteOffset),
-            &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "tzHourOffset"),
-            enif_make_int(env, data->value.asTimestamp.tzHourOffset), &dataRet);
-        break;
-    case DPI_NATIVE_TYPE_INTERVAL_DS:
-        dataRet = enif_make_new_map(env);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "fseconds"),
-            enif_make_uint(env, data->value.asIntervalDS.fseconds), &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "seconds"),
-            enif_make_uint(env, data->value.asIntervalDS.seconds), &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "minutes"),
-            enif_make_uint(env, data->value.asIntervalDS.minutes), &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "hours"),
-            enif_make_uint(env, data->value.asIntervalDS.hours),
-            &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "days"),
-            enif_make_uint(env, data->value.asIntervalDS.days),
-            &dataRet);
-        break;
-    case DPI_NATIVE_TYPE_INTERVAL_YM:
-        dataRet = enif_make_new_map(env);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "months"),
-            enif_make_uint(env, data->value.asIntervalYM.months), &dataRet);
-        enif_make_map_put(
-            env, dataRet, enif_make_atom(env, "years"),
-            enif_make_uint(env, data->value.asIntervalYM.years),
-            &dataRet);
-        break;
-    case DPI_NATIVE_TYPE_STMT:
+    if (dataRes->type == DPI_NATIVE_TYPE_STMT)
     {
         dpiStmt_res *stmtRes = (dpiStmt_res *)dataRes->stmtRes;
         if (!stmtRes)
         {
             // first time
             ALLOC_RESOURCE(stmtRes, dpiStmt);
+            dpiStmt_res_init(stmtRes, dataRes->context);
+            dpiStmt_res_attach(stmtRes, (dpiConn_res *)dataRes->connRes);
             dataRes->stmtRes = stmtRes;
         }
-        stmtRes->stmt = data->value.asStmt;
+        if (stmtRes->stmt != data->value.asStmt)
+        {
+            // a new cursor was opened
+            const char *error =
+                dpiStmt_res_swapCursor(stmtRes, data->value.asStmt);
+            if (error)
+                RAISE_STR_EXCEPTION(error);
+        }
+        stmtRes->context = dataRes->context;
         dataRet = enif_make_resource(env, stmtRes);
+
+        RETURNED_TRACE;
+        return dataRet;
     }
-    break;
-    case DPI_NATIVE_TYPE_ROWID:
+
+    if (dataRes->type == DPI_NATIVE_TYPE_OBJECT)
     {
-        const char *string;
-        uint32_t stringlen;
-        RAISE_EXCEPTION_ON_DPI_ERROR(
-            dataRes->context,
-            dpiRowid_getStringValue(data->value.asRowid, &string, &stringlen));
-        ErlNifBinary bin;
-        enif_alloc_binary(stringlen, &bin);
-        memcpy(bin.data, string, stringlen);
-        dataRet = enif_make_binary(env, &bin);
+        // every call hands out a new reference, released by object_release
+        dpiObject_res *objRes;
+        ALLOC_RESOURCE(objRes, dpiObject);
+        RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
+            dataRes->context, dpiObject_addRef(data->value.asObject),
+            objRes, dpiObject);
+        objRes->obj = data->value.asObject;
+        objRes->context = dataRes->context;
+        dataRet = enif_make_resource(env, objRes);
+
+        RETURNED_TRACE;
+        return dataRet;
     }
-    break;
-    default:
+
+    dpiDataDecoder decode = dpiData_getDecoder(dataRes->type, 0);
+    if (!decode)
         RAISE_STR_EXCEPTION("Unsupported nativeTypeNum");
-    }
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        dataRes->context, decode(env, data, &dataRet));
 
     RETURNED_TRACE;
     return dataRet;
@@ -381,7 +725,7 @@ DPI_NIF_FUN(data_getInt64) // TODO: unit test
     dpiDataPtr_res *dataPtr;
     dpiData *data;
 
-    if (enif_get_resource(env, argv[0], dpiDataPtr_type, (void **)&dataPtr))
+    if (dpiDataPtr_get(env, argv[0], &dataPtr))
         data = dataPtr->dpiDataPtr;
     else if (enif_get_resource(env, argv[0], dpiData_type, (void **)&dataRes))
         data = &dataRes->dpiData;
@@ -407,7 +751,7 @@ DPI_NIF_FUN(data_getBytes) // TODO: unit test
     dpiDataPtr_res *dataPtr;
     dpiData *data;
 
-    if (enif_get_resource(env, argv[0], dpiDataPtr_type, (void **)&dataPtr))
+    if (dpiDataPtr_get(env, argv[0], &dataPtr))
         data = dataPtr->dpiDataPtr;
     else if (enif_get_resource(env, argv[0], dpiData_type, (void **)&dataRes))
         data = &dataRes->dpiData;
@@ -441,19 +785,24 @@ DPI_NIF_FUN(data_release)
     if (enif_get_resource(env, argv[0], dpiData_type, (void **)&res.dataRes))
     {
         // nothing to set to NULL
+        oranif_memRelease(
+            env, ORANIF_MEM_DATA, NULL, res.dataRes->memBytes);
+        res.dataRes->memBytes = 0;
         RELEASE_RESOURCE(res.dataRes, dpiData);
     }
-    else if (enif_get_resource(
-                 env, argv[0], dpiDataPtr_type, (void **)&res.dataPtrRes))
+    else if (dpiDataPtr_get(env, argv[0], &res.dataPtrRes))
     {
         if (res.dataPtrRes->stmtRes)
         {
             RELEASE_RESOURCE(res.dataPtrRes->stmtRes, dpiStmt);
             res.dataPtrRes->stmtRes = NULL;
         }
-        res.dataPtrRes->dpiDataPtr = NULL;
+        // variable elements stay usable until var_release
         if (res.dataPtrRes->isQueryValue == 1)
+        {
+            res.dataPtrRes->dpiDataPtr = NULL;
             RELEASE_RESOURCE(res.dataPtrRes, dpiDataPtr);
+        }
     }
     else
         BADARG_EXCEPTION(0, "resource data");
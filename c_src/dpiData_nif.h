@@ -3,11 +3,13 @@
 
 #include "dpi_nif.h"
 #include "dpi.h"
+#include "dpiCharset.h"
 
 typedef struct
 {
     dpiData dpiData;
     ErlNifEnv *env;
+    uint64_t memBytes; // binaries copied into env
 } dpiData_res;
 
 typedef struct
@@ -15,17 +17,30 @@ typedef struct
     dpiData *dpiDataPtr;
     dpiContext *context;
     dpiNativeTypeNum type;
-    void *next;
     void *stmtRes;
+    void *connRes; // dpiConn_res of a REF CURSOR, kept by ptr resources
     unsigned char isQueryValue;
 } dpiDataPtr_res;
 
+// converts a dpiData value of one native type into an erlang term, returns
+// DPI_FAILURE if the underlying ODPI call failed
+typedef int (*dpiDataDecoder)(ErlNifEnv *, dpiData *, ERL_NIF_TERM *);
+
 extern ErlNifResourceType *dpiData_type;
 extern ErlNifResourceType *dpiDataPtr_type;
 
 extern void dpiData_res_dtor(ErlNifEnv *env, void *resource);
 extern void dpiDataPtr_res_dtor(ErlNifEnv *env, void *resource);
 
+extern int dpiDataPtr_get(
+    ErlNifEnv *env, ERL_NIF_TERM term, dpiDataPtr_res **dataPtr);
+extern dpiDataDecoder dpiData_getDecoder(dpiNativeTypeNum type, int nullOk);
+extern dpiDataDecoder dpiData_getDecimalDecoder(int nullOk);
+extern dpiDataDecoder dpiData_getCharsetDecoder(int charsetMode, int nullOk);
+extern int dpiData_fromTerm(
+    ErlNifEnv *env, ERL_NIF_TERM term, dpiData *data,
+    dpiNativeTypeNum *nativeType);
+
 extern DPI_NIF_FUN(data_getBytes);
 extern DPI_NIF_FUN(data_getInt64);
 extern DPI_NIF_FUN(data_setBytes);
@@ -0,0 +1,301 @@
+#include "dpiObject_nif.h"
+#include "dpiData_nif.h"
+#include "dpiQueryInfo_nif.h"
+
+/*
+ * Object types and objects
+ * collections (nested tables and VARRAYs) of scalar elements are converted
+ * from and to erlang lists as a whole, object_fromList builds a collection
+ * which is then bound to a PL/SQL call through var_setFromObject
+ */
+
+ErlNifResourceType *dpiObjectType_type;
+ErlNifResourceType *dpiObject_type;
+
+void dpiObjectType_res_dtor(ErlNifEnv *env, void *resource)
+{
+    CALL_TRACE;
+    RETURNED_TRACE;
+}
+
+void dpiObject_res_dtor(ErlNifEnv *env, void *resource)
+{
+    CALL_TRACE;
+    RETURNED_TRACE;
+}
+
+DPI_NIF_FUN(objectType_getInfo)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiObjectType_res *objTypeRes;
+    dpiObjectTypeInfo info;
+
+    if (!enif_get_resource(
+            env, argv[0], dpiObjectType_type, (void **)&objTypeRes))
+        BADARG_EXCEPTION(0, "resource objectType");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        objTypeRes->context,
+        dpiObjectType_getInfo(objTypeRes->objType, &info));
+
+    // the element keys come first and are skipped for other types
+    ERL_NIF_TERM keys[] = {
+        ATOM_elementNativeTypeNum, ATOM_elementOracleTypeNum,
+        ATOM_isCollection, ATOM_name, ATOM_numAttributes, ATOM_schema};
+    ERL_NIF_TERM values[] = {
+        ATOM_NULL, ATOM_NULL, info.isCollection ? ATOM_TRUE : ATOM_FALSE,
+        enif_make_string_len(env, info.name, info.nameLength, ERL_NIF_LATIN1),
+        enif_make_uint(env, info.numAttributes),
+        enif_make_string_len(
+            env, info.schema, info.schemaLength, ERL_NIF_LATIN1)};
+    size_t skip = 2;
+    if (info.isCollection)
+    {
+        DPI_NATIVE_TYPE_NUM_TO_ATOM(
+            info.elementTypeInfo.defaultNativeTypeNum, values[0]);
+        DPI_ORACLE_TYPE_NUM_TO_ATOM(
+            info.elementTypeInfo.oracleTypeNum, values[1]);
+        skip = 0;
+    }
+    ERL_NIF_TERM map =
+        oranif_makeMap(env, keys + skip, values + skip, 6 - skip);
+
+    /* #{schema => string, name => string, isCollection => boolean,
+         numAttributes => integer, elementOracleTypeNum => atom,
+         elementNativeTypeNum => atom} */
+    RETURNED_TRACE;
+    return map;
+}
+
+DPI_NIF_FUN(objectType_createObject)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiObjectType_res *objTypeRes;
+
+    if (!enif_get_resource(
+            env, argv[0], dpiObjectType_type, (void **)&objTypeRes))
+        BADARG_EXCEPTION(0, "resource objectType");
+
+    dpiObject_res *objRes;
+    ALLOC_RESOURCE(objRes, dpiObject);
+
+    RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
+        objTypeRes->context,
+        dpiObjectType_createObject(objTypeRes->objType, &objRes->obj),
+        objRes, dpiObject);
+    objRes->context = objTypeRes->context;
+
+    ERL_NIF_TERM objResTerm = enif_make_resource(env, objRes);
+
+    RETURNED_TRACE;
+    return objResTerm;
+}
+
+DPI_NIF_FUN(objectType_release)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiObjectType_res *objTypeRes;
+
+    if (!enif_get_resource(
+            env, argv[0], dpiObjectType_type, (void **)&objTypeRes))
+        BADARG_EXCEPTION(0, "resource objectType");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        objTypeRes->context, dpiObjectType_release(objTypeRes->objType));
+
+    RELEASE_RESOURCE(objTypeRes, dpiObjectType);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+// element type of a collection, 0 if the type isn't a collection
+static int object_elementType(
+    dpiObjectType_res *objTypeRes, dpiNativeTypeNum *nativeType,
+    int *isCollection)
+{
+    dpiObjectTypeInfo info;
+
+    if (DPI_FAILURE == dpiObjectType_getInfo(objTypeRes->objType, &info))
+        return DPI_FAILURE;
+    *isCollection = info.isCollection;
+    *nativeType = info.elementTypeInfo.defaultNativeTypeNum;
+
+    return DPI_SUCCESS;
+}
+
+static int object_append(
+    ErlNifEnv *env, dpiObject *obj, dpiNativeTypeNum elementType,
+    ERL_NIF_TERM list)
+{
+    ERL_NIF_TERM head, tail = list;
+    dpiNativeTypeNum nativeType;
+    dpiData data;
+
+    while (enif_get_list_cell(env, tail, &head, &tail))
+    {
+        dpiData_fromTerm(env, head, &data, &nativeType);
+        // integers are accepted for floating point elements
+        if (!data.isNull && nativeType == DPI_NATIVE_TYPE_INT64 &&
+            elementType == DPI_NATIVE_TYPE_DOUBLE)
+        {
+            dpiData_setDouble(&data, (double)data.value.asInt64);
+            nativeType = DPI_NATIVE_TYPE_DOUBLE;
+        }
+        if (DPI_FAILURE == dpiObject_appendElement(obj, nativeType, &data))
+            return DPI_FAILURE;
+    }
+
+    return DPI_SUCCESS;
+}
+
+DPI_NIF_FUN(object_fromList)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiObjectType_res *objTypeRes;
+    dpiNativeTypeNum elementType;
+    ERL_NIF_TERM head, tail;
+    dpiNativeTypeNum nativeType;
+    dpiData data;
+    int isCollection;
+
+    if (!enif_get_resource(
+            env, argv[0], dpiObjectType_type, (void **)&objTypeRes))
+        BADARG_EXCEPTION(0, "resource objectType");
+    if (!enif_is_list(env, argv[1]))
+        BADARG_EXCEPTION(1, "list elements");
+    for (tail = argv[1]; enif_get_list_cell(env, tail, &head, &tail);)
+        if (!dpiData_fromTerm(env, head, &data, &nativeType))
+            BADARG_EXCEPTION(1, "list elements of integer/float/binary/null");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        objTypeRes->context,
+        object_elementType(objTypeRes, &elementType, &isCollection));
+    if (!isCollection)
+        RAISE_STR_EXCEPTION("object type is not a collection");
+
+    dpiObject_res *objRes;
+    ALLOC_RESOURCE(objRes, dpiObject);
+
+    RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
+        objTypeRes->context,
+        dpiObjectType_createObject(objTypeRes->objType, &objRes->obj),
+        objRes, dpiObject);
+    objRes->context = objTypeRes->context;
+
+    if (DPI_FAILURE == object_append(env, objRes->obj, elementType, argv[1]))
+    {
+        dpiErrorInfo err;
+        dpiContext_getError(objRes->context, &err);
+        dpiObject_release(objRes->obj);
+        RELEASE_RESOURCE(objRes, dpiObject);
+        RAISE_EXCEPTION(dpiErrorInfoMap(env, err));
+    }
+
+    ERL_NIF_TERM objResTerm = enif_make_resource(env, objRes);
+
+    RETURNED_TRACE;
+    return objResTerm;
+}
+
+static int object_elements(
+    ErlNifEnv *env, dpiObject *obj, dpiNativeTypeNum elementType,
+    dpiDataDecoder decode, ERL_NIF_TERM *list)
+{
+    ERL_NIF_TERM value;
+    int32_t index;
+    dpiData data;
+    int exists;
+
+    *list = enif_make_list(env, 0);
+    if (DPI_FAILURE == dpiObject_getFirstIndex(obj, &index, &exists))
+        return DPI_FAILURE;
+    while (exists)
+    {
+        if (DPI_FAILURE ==
+                dpiObject_getElementValueByIndex(
+                    obj, index, elementType, &data) ||
+            DPI_FAILURE == decode(env, &data, &value))
+            return DPI_FAILURE;
+        *list = enif_make_list_cell(env, value, *list);
+        if (DPI_FAILURE ==
+            dpiObject_getNextIndex(obj, index, &index, &exists))
+            return DPI_FAILURE;
+    }
+    enif_make_reverse_list(env, *list, list);
+
+    return DPI_SUCCESS;
+}
+
+DPI_NIF_FUN(object_toList)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiObjectType_res *objTypeRes;
+    dpiObject_res *objRes;
+    dpiNativeTypeNum elementType;
+    ERL_NIF_TERM list;
+    int isCollection;
+
+    if (!enif_get_resource(
+            env, argv[0], dpiObjectType_type, (void **)&objTypeRes))
+        BADARG_EXCEPTION(0, "resource objectType");
+    if (!enif_get_resource(env, argv[1], dpiObject_type, (void **)&objRes))
+        BADARG_EXCEPTION(1, "resource object");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        objTypeRes->context,
+        object_elementType(objTypeRes, &elementType, &isCollection));
+    if (!isCollection)
+        RAISE_STR_EXCEPTION("object type is not a collection");
+    dpiDataDecoder decode = dpiData_getDecoder(elementType, 1);
+    if (!decode)
+        RAISE_STR_EXCEPTION("unsupported collection element type");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        objRes->context,
+        object_elements(env, objRes->obj, elementType, decode, &list));
+
+    // [term]
+    RETURNED_TRACE;
+    return list;
+}
+
+DPI_NIF_FUN(object_getSize)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiObject_res *objRes;
+    int32_t size;
+
+    if (!enif_get_resource(env, argv[0], dpiObject_type, (void **)&objRes))
+        BADARG_EXCEPTION(0, "resource object");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        objRes->context, dpiObject_getSize(objRes->obj, &size));
+
+    RETURNED_TRACE;
+    return enif_make_int(env, size);
+}
+
+DPI_NIF_FUN(object_release)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiObject_res *objRes;
+
+    if (!enif_get_resource(env, argv[0], dpiObject_type, (void **)&objRes))
+        BADARG_EXCEPTION(0, "resource object");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        objRes->context, dpiObject_release(objRes->obj));
+
+    RELEASE_RESOURCE(objRes, dpiObject);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
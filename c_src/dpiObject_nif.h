@@ -0,0 +1,42 @@
+#ifndef _DPIOBJECT_NIF_H_
+#define _DPIOBJECT_NIF_H_
+
+#include "dpi_nif.h"
+#include "dpi.h"
+
+typedef struct
+{
+    dpiObjectType *objType;
+    dpiContext *context;
+} dpiObjectType_res;
+
+typedef struct
+{
+    dpiObject *obj;
+    dpiContext *context;
+} dpiObject_res;
+
+extern ErlNifResourceType *dpiObjectType_type;
+extern ErlNifResourceType *dpiObject_type;
+
+extern void dpiObjectType_res_dtor(ErlNifEnv *env, void *resource);
+extern void dpiObject_res_dtor(ErlNifEnv *env, void *resource);
+
+extern DPI_NIF_FUN(objectType_getInfo);
+extern DPI_NIF_FUN(objectType_createObject);
+extern DPI_NIF_FUN(objectType_release);
+extern DPI_NIF_FUN(object_fromList);
+extern DPI_NIF_FUN(object_toList);
+extern DPI_NIF_FUN(object_getSize);
+extern DPI_NIF_FUN(object_release);
+
+#define DPIOBJECT_NIFS                         \
+    DEF_NIF(objectType_getInfo, 1),            \
+        DEF_NIF(objectType_createObject, 1),   \
+        DEF_NIF(objectType_release, 1),        \
+        DEF_NIF(object_fromList, 2),           \
+        DEF_NIF(object_toList, 2),             \
+        DEF_NIF(object_getSize, 1),            \
+        DEF_NIF(object_release, 1)
+
+#endif // _DPIOBJECT_NIF_H_
@@ -0,0 +1,255 @@
+#include "dpiQueue_nif.h"
+#include "dpiConn_nif.h"
+
+#include <string.h>
+
+/*
+ * Advanced Queuing array operations
+ * ODPI-C 3.0 has no dpiQueue, so a batch of RAW messages is moved by one
+ * anonymous PL/SQL block looping over DBMS_AQ with the payloads bound as a
+ * PL/SQL index-by table, one round trip per batch. JSON or other structured
+ * payloads are carried as encoded bytes. Enqueued messages become visible
+ * with the transaction commit (default enqueue visibility)
+ */
+
+#define QUEUE_ENQ_SQL                                                   \
+    "declare"                                                           \
+    " enqOpts dbms_aq.enqueue_options_t;"                               \
+    " msgProps dbms_aq.message_properties_t;"                           \
+    " msgId raw(16);"                                                   \
+    " begin"                                                            \
+    " for i in 1 .. :numMessages loop"                                  \
+    " dbms_aq.enqueue(:queueName, enqOpts, msgProps, :payloads(i), msgId);" \
+    " end loop;"                                                        \
+    " end;"
+
+// only the first dequeue waits, the rest of the batch is taken if present
+#define QUEUE_DEQ_SQL                                                   \
+    "declare"                                                           \
+    " deqOpts dbms_aq.dequeue_options_t;"                               \
+    " msgProps dbms_aq.message_properties_t;"                           \
+    " msgId raw(16);"                                                   \
+    " payload raw(32767);"                                              \
+    " noMessages exception;"                                            \
+    " pragma exception_init(noMessages, -25228);"                       \
+    " begin"                                                            \
+    " :numMessages := 0;"                                               \
+    " deqOpts.wait := :wait;"                                           \
+    " for i in 1 .. :maxMessages loop"                                  \
+    " dbms_aq.dequeue(:queueName, deqOpts, msgProps, payload, msgId);"  \
+    " :payloads(i) := payload;"                                         \
+    " :numMessages := i;"                                               \
+    " deqOpts.wait := dbms_aq.no_wait;"                                 \
+    " end loop;"                                                        \
+    " exception when noMessages then null;"                             \
+    " end;"
+
+#define QUEUE_BIND_NAME(_name) _name, sizeof(_name) - 1
+
+typedef struct
+{
+    dpiStmt *stmt;
+    dpiVar *payloads;
+    dpiData *payloadData;
+    dpiVar *numMessages;
+    dpiData *numMessagesData;
+} dpiQueueCall;
+
+static void queue_release(dpiQueueCall *call)
+{
+    if (call->payloads)
+        dpiVar_release(call->payloads);
+    if (call->numMessages)
+        dpiVar_release(call->numMessages);
+    if (call->stmt)
+        dpiStmt_release(call->stmt);
+}
+
+// prepares sql and binds the queue name, payload array and message count
+static int queue_prepare(
+    dpiConn_res *connRes, dpiQueueCall *call, const char *sql,
+    ErlNifBinary *queueName, uint32_t maxMessages, uint32_t maxSize)
+{
+    dpiData value;
+
+    memset(call, 0, sizeof(dpiQueueCall));
+    if (DPI_FAILURE ==
+            dpiConn_prepareStmt(
+                connRes->conn, 0, sql, strlen(sql), NULL, 0, &call->stmt) ||
+        DPI_FAILURE ==
+            dpiConn_newVar(
+                connRes->conn, DPI_ORACLE_TYPE_RAW, DPI_NATIVE_TYPE_BYTES,
+                maxMessages, maxSize, 1, 1, NULL, &call->payloads,
+                &call->payloadData) ||
+        DPI_FAILURE ==
+            dpiConn_newVar(
+                connRes->conn, DPI_ORACLE_TYPE_NATIVE_INT,
+                DPI_NATIVE_TYPE_INT64, 1, 0, 0, 0, NULL, &call->numMessages,
+                &call->numMessagesData))
+        return DPI_FAILURE;
+
+    dpiData_setBytes(&value, (char *)queueName->data, queueName->size);
+    if (DPI_FAILURE ==
+            dpiStmt_bindValueByName(
+                call->stmt, QUEUE_BIND_NAME("queueName"),
+                DPI_NATIVE_TYPE_BYTES, &value) ||
+        DPI_FAILURE ==
+            dpiStmt_bindByName(
+                call->stmt, QUEUE_BIND_NAME("payloads"), call->payloads) ||
+        DPI_FAILURE ==
+            dpiStmt_bindByName(
+                call->stmt, QUEUE_BIND_NAME("numMessages"),
+                call->numMessages))
+        return DPI_FAILURE;
+
+    return DPI_SUCCESS;
+}
+
+static int queue_enqueue(
+    ErlNifEnv *env, dpiConn_res *connRes, ErlNifBinary *queueName,
+    ERL_NIF_TERM payloads, uint32_t numMessages, uint32_t maxSize)
+{
+    dpiQueueCall call;
+    ERL_NIF_TERM head, tail = payloads;
+    ErlNifBinary payload;
+    uint32_t numCols;
+    int ret = DPI_FAILURE;
+
+    if (DPI_FAILURE ==
+        queue_prepare(
+            connRes, &call, QUEUE_ENQ_SQL, queueName, numMessages, maxSize))
+        goto cleanup;
+
+    for (uint32_t i = 0; enif_get_list_cell(env, tail, &head, &tail); i++)
+    {
+        enif_inspect_binary(env, head, &payload);
+        if (DPI_FAILURE ==
+            dpiVar_setFromBytes(
+                call.payloads, i, (const char *)payload.data, payload.size))
+            goto cleanup;
+    }
+    dpiData_setInt64(call.numMessagesData, numMessages);
+
+    if (DPI_SUCCESS ==
+            dpiVar_setNumElementsInArray(call.payloads, numMessages) &&
+        DPI_SUCCESS == dpiStmt_execute(call.stmt, 0, &numCols))
+        ret = DPI_SUCCESS;
+
+cleanup:
+    queue_release(&call);
+    return ret;
+}
+
+DPI_NIF_FUN(queue_enqMany)
+{
+    CHECK_ARGCOUNT(3);
+
+    dpiConn_res *connRes;
+    ErlNifBinary queueName, payload;
+    ERL_NIF_TERM head, tail;
+    unsigned numMessages;
+    uint32_t maxSize = 1;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_inspect_binary(env, argv[1], &queueName))
+        BADARG_EXCEPTION(1, "binary/string queueName");
+    if (!enif_get_list_length(env, argv[2], &numMessages) || numMessages == 0)
+        BADARG_EXCEPTION(2, "list payloads");
+    for (tail = argv[2]; enif_get_list_cell(env, tail, &head, &tail);)
+    {
+        if (!enif_inspect_binary(env, head, &payload) ||
+            payload.size > QUEUE_MAX_PAYLOAD)
+            BADARG_EXCEPTION(2, "list of binary payloads");
+        if (payload.size > maxSize)
+            maxSize = payload.size;
+    }
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        connRes->context,
+        queue_enqueue(
+            env, connRes, &queueName, argv[2], numMessages, maxSize));
+
+    RETURNED_TRACE;
+    return enif_make_uint(env, numMessages);
+}
+
+static int queue_dequeue(
+    ErlNifEnv *env, dpiConn_res *connRes, ErlNifBinary *queueName,
+    uint32_t maxMessages, uint32_t maxSize, int32_t wait,
+    ERL_NIF_TERM *messages)
+{
+    dpiQueueCall call;
+    dpiData value;
+    dpiBytes *bytes;
+    ERL_NIF_TERM bin;
+    uint32_t numCols;
+    int ret = DPI_FAILURE;
+
+    if (DPI_FAILURE ==
+        queue_prepare(
+            connRes, &call, QUEUE_DEQ_SQL, queueName, maxMessages, maxSize))
+        goto cleanup;
+
+    dpiData_setInt64(&value, wait);
+    if (DPI_FAILURE ==
+        dpiStmt_bindValueByName(
+            call.stmt, QUEUE_BIND_NAME("wait"), DPI_NATIVE_TYPE_INT64, &value))
+        goto cleanup;
+    dpiData_setInt64(&value, maxMessages);
+    if (DPI_FAILURE ==
+            dpiStmt_bindValueByName(
+                call.stmt, QUEUE_BIND_NAME("maxMessages"),
+                DPI_NATIVE_TYPE_INT64, &value) ||
+        DPI_FAILURE == dpiStmt_execute(call.stmt, 0, &numCols))
+        goto cleanup;
+
+    *messages = enif_make_list(env, 0);
+    for (int64_t i = call.numMessagesData->value.asInt64; i > 0; i--)
+    {
+        bytes = dpiData_getBytes(&call.payloadData[i - 1]);
+        memcpy(
+            enif_make_new_binary(env, bytes->length, &bin), bytes->ptr,
+            bytes->length);
+        *messages = enif_make_list_cell(env, bin, *messages);
+    }
+    ret = DPI_SUCCESS;
+
+cleanup:
+    queue_release(&call);
+    return ret;
+}
+
+DPI_NIF_FUN(queue_deqMany)
+{
+    CHECK_ARGCOUNT(5);
+
+    dpiConn_res *connRes;
+    ErlNifBinary queueName;
+    uint32_t maxMessages, maxSize;
+    int32_t wait;
+    ERL_NIF_TERM messages;
+
+    if (!enif_get_resource(env, argv[0], dpiConn_type, (void **)&connRes))
+        BADARG_EXCEPTION(0, "resource connection");
+    if (!enif_inspect_binary(env, argv[1], &queueName))
+        BADARG_EXCEPTION(1, "binary/string queueName");
+    if (!enif_get_uint(env, argv[2], &maxMessages) || maxMessages == 0)
+        BADARG_EXCEPTION(2, "uint maxMessages");
+    if (!enif_get_uint(env, argv[3], &maxSize) || maxSize == 0 ||
+        maxSize > QUEUE_MAX_PAYLOAD)
+        BADARG_EXCEPTION(3, "uint maxSize");
+    // seconds, -1 waits forever (DBMS_AQ.FOREVER)
+    if (!enif_get_int(env, argv[4], &wait) || wait < -1)
+        BADARG_EXCEPTION(4, "int wait");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        connRes->context,
+        queue_dequeue(
+            env, connRes, &queueName, maxMessages, maxSize, wait,
+            &messages));
+
+    // [binary]
+    RETURNED_TRACE;
+    return messages;
+}
@@ -0,0 +1,17 @@
+#ifndef _DPIQUEUE_NIF_H_
+#define _DPIQUEUE_NIF_H_
+
+#include "dpi_nif.h"
+#include "dpi.h"
+
+// largest RAW payload a PL/SQL variable holds
+#define QUEUE_MAX_PAYLOAD 32767
+
+extern DPI_NIF_FUN(queue_enqMany);
+extern DPI_NIF_FUN(queue_deqMany);
+
+#define DPIQUEUE_NIFS                  \
+    IOB_NIF(queue_enqMany, 3),         \
+        IOB_NIF(queue_deqMany, 5)
+
+#endif // _DPIQUEUE_NIF_H_
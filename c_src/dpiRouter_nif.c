@@ -0,0 +1,412 @@
+#include "dpiRouter_nif.h"
+#include "dpiScan_nif.h"
+
+#include <stdlib.h>
+
+/*
+ * Client side shard router
+ * a router holds a list of shards, each a list of connections which are
+ * handed out round robin, and maps a shard key (integer or binary) to a
+ * shard through its table:
+ *   {hash, VNodes}  consistent hash ring with VNodes points per shard, adding
+ *                   a shard at the end of the list only moves keys to it
+ *   {range, Bounds} integer keys, shard N takes the keys below the Nth of the
+ *                   numShards - 1 ascending bounds, the last shard the rest
+ * Shards are numbered from 0 in the order they were given. router_scatter
+ * runs one query on every shard as a partitioned scan (see dpiScan_nif.c)
+ * with one partition per shard, so the row batches of all shards are merged
+ * into the stream of the owner
+ */
+
+ErlNifResourceType *dpiRouter_type;
+
+// no NIF uses the router any more, releases the connections and tables
+void dpiRouter_res_dtor(ErlNifEnv *env, void *resource)
+{
+    CALL_TRACE;
+
+    dpiRouter_res *routerRes = (dpiRouter_res *)resource;
+    for (uint32_t s = 0; s < routerRes->numShards; s++)
+    {
+        dpiRouterShard *shard = &routerRes->shards[s];
+        for (uint32_t c = 0; c < shard->numConns; c++)
+            enif_release_resource(shard->conns[c]);
+        enif_free(shard->conns);
+    }
+    enif_free(routerRes->shards);
+    if (routerRes->ring)
+        enif_free(routerRes->ring);
+    if (routerRes->bounds)
+        enif_free(routerRes->bounds);
+    enif_mutex_destroy(routerRes->lock);
+
+    RETURNED_TRACE;
+}
+
+// locks the router, returns 0 without the lock if it is released
+static int router_lock(dpiRouter_res *routerRes)
+{
+    enif_mutex_lock(routerRes->lock);
+    if (!routerRes->released)
+        return 1;
+    enif_mutex_unlock(routerRes->lock);
+
+    return 0;
+}
+
+// FNV-1a with a final avalanche, so that close keys spread over the ring
+static uint64_t router_hash(const unsigned char *bytes, size_t length)
+{
+    uint64_t h = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    return h;
+}
+
+// hashes the little endian bytes, the same on every platform
+static uint64_t router_hashInt(uint64_t value)
+{
+    unsigned char bytes[8];
+
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (unsigned char)(value >> (8 * i));
+
+    return router_hash(bytes, sizeof(bytes));
+}
+
+static int router_comparePoints(const void *a, const void *b)
+{
+    const dpiRouterPoint *pa = a, *pb = b;
+
+    if (pa->hash != pb->hash)
+        return pa->hash < pb->hash ? -1 : 1;
+    return pa->shard < pb->shard ? -1 : pa->shard > pb->shard;
+}
+
+/*
+ * maps a key term to its shard, returns 0 if the key isn't of a type the
+ * table can route
+ */
+static int router_shardOf(ErlNifEnv *env, dpiRouter_res *routerRes,
+                          ERL_NIF_TERM key, uint32_t *shard)
+{
+    ErlNifSInt64 intKey;
+    ErlNifBinary binKey;
+    uint64_t hash;
+
+    if (routerRes->table == ROUTER_TABLE_RANGE)
+    {
+        if (!enif_get_int64(env, key, &intKey))
+            return 0;
+        uint32_t s = 0;
+        while (s < routerRes->numShards - 1 && intKey >= routerRes->bounds[s])
+            s++;
+        *shard = s;
+        return 1;
+    }
+
+    if (enif_get_int64(env, key, &intKey))
+        hash = router_hashInt((uint64_t)intKey);
+    else if (enif_inspect_binary(env, key, &binKey))
+        hash = router_hash(binKey.data, binKey.size);
+    else
+        return 0;
+
+    // first point at or after the hash, wrapping around the ring
+    uint32_t lo = 0, hi = routerRes->numPoints;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (routerRes->ring[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *shard = routerRes->ring[lo == routerRes->numPoints ? 0 : lo].shard;
+    return 1;
+}
+
+// next connection of the shard, called with the lock held
+static dpiConn_res *router_pickConn(dpiRouter_res *routerRes, uint32_t s)
+{
+    dpiRouterShard *shard = &routerRes->shards[s];
+    dpiConn_res *connRes = shard->conns[shard->next];
+
+    shard->next = (shard->next + 1) % shard->numConns;
+
+    return connRes;
+}
+
+// parses {hash, VNodes} or {range, Bounds} into the router
+static int router_getTable(ErlNifEnv *env, ERL_NIF_TERM term,
+                           dpiRouter_res *routerRes)
+{
+    const ERL_NIF_TERM *tuple;
+    int arity;
+    unsigned vnodes, numBounds;
+    ERL_NIF_TERM head, tail;
+
+    if (!enif_get_tuple(env, term, &arity, &tuple) || arity != 2)
+        return 0;
+
+    if (enif_is_identical(tuple[0], enif_make_atom(env, "hash")))
+    {
+        if (!enif_get_uint(env, tuple[1], &vnodes) || vnodes == 0 ||
+            vnodes > ROUTER_MAX_VNODES)
+            return 0;
+        routerRes->table = ROUTER_TABLE_HASH;
+        routerRes->numPoints = routerRes->numShards * vnodes;
+        routerRes->ring =
+            enif_alloc(routerRes->numPoints * sizeof(dpiRouterPoint));
+        for (uint32_t s = 0; s < routerRes->numShards; s++)
+            for (uint32_t v = 0; v < vnodes; v++)
+            {
+                // a point only depends on its shard and vnode number
+                dpiRouterPoint *point = &routerRes->ring[s * vnodes + v];
+                point->hash = router_hashInt(((uint64_t)s << 32) | v);
+                point->shard = s;
+            }
+        qsort(
+            routerRes->ring, routerRes->numPoints, sizeof(dpiRouterPoint),
+            router_comparePoints);
+        return 1;
+    }
+
+    if (enif_is_identical(tuple[0], enif_make_atom(env, "range")))
+    {
+        if (!enif_get_list_length(env, tuple[1], &numBounds) ||
+            numBounds != routerRes->numShards - 1)
+            return 0;
+        routerRes->table = ROUTER_TABLE_RANGE;
+        routerRes->bounds = enif_alloc((numBounds + 1) * sizeof(int64_t));
+        tail = tuple[1];
+        for (uint32_t b = 0; enif_get_list_cell(env, tail, &head, &tail); b++)
+        {
+            ErlNifSInt64 bound;
+            if (!enif_get_int64(env, head, &bound) ||
+                (b > 0 && bound <= routerRes->bounds[b - 1]))
+                return 0;
+            routerRes->bounds[b] = bound;
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+DPI_NIF_FUN(router_create)
+{
+    CHECK_ARGCOUNT(2);
+
+    unsigned numShards, numConns;
+    ERL_NIF_TERM shardList, shardHead, connList, connHead;
+
+    if (!enif_get_list_length(env, argv[0], &numShards) || numShards == 0)
+        BADARG_EXCEPTION(0, "list of lists of resource connection");
+
+    dpiRouterShard *shards = enif_alloc(numShards * sizeof(dpiRouterShard));
+    uint32_t s = 0;
+    shardList = argv[0];
+    for (; enif_get_list_cell(env, shardList, &shardHead, &shardList); s++)
+    {
+        dpiRouterShard *shard = &shards[s];
+        if (!enif_get_list_length(env, shardHead, &numConns) ||
+            numConns == 0)
+            break;
+        shard->conns = enif_alloc(numConns * sizeof(dpiConn_res *));
+        shard->numConns = numConns;
+        shard->next = 0;
+        connList = shardHead;
+        uint32_t c = 0;
+        for (; enif_get_list_cell(env, connList, &connHead, &connList); c++)
+            if (!enif_get_resource(
+                    env, connHead, dpiConn_type, (void **)&shard->conns[c]))
+                break;
+        if (c < numConns)
+        {
+            enif_free(shard->conns);
+            break;
+        }
+    }
+    if (s < numShards)
+    {
+        for (uint32_t f = 0; f < s; f++)
+            enif_free(shards[f].conns);
+        enif_free(shards);
+        BADARG_EXCEPTION(0, "list of lists of resource connection");
+    }
+
+    dpiRouter_res *routerRes;
+    ALLOC_RESOURCE(routerRes, dpiRouter);
+    routerRes->lock = enif_mutex_create("oranif_router");
+    routerRes->released = 0;
+    routerRes->shards = shards;
+    routerRes->numShards = numShards;
+    routerRes->ring = NULL;
+    routerRes->numPoints = 0;
+    routerRes->bounds = NULL;
+    // the connections stay valid while the router is alive
+    for (s = 0; s < numShards; s++)
+        for (uint32_t c = 0; c < shards[s].numConns; c++)
+            enif_keep_resource(shards[s].conns[c]);
+
+    if (!router_getTable(env, argv[1], routerRes))
+    {
+        RELEASE_RESOURCE(routerRes, dpiRouter);
+        BADARG_EXCEPTION(1, "tuple {hash, VNodes} or {range, Bounds} table");
+    }
+
+    ERL_NIF_TERM routerResTerm = enif_make_resource(env, routerRes);
+
+    RETURNED_TRACE;
+    return routerResTerm;
+}
+
+DPI_NIF_FUN(router_route)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiRouter_res *routerRes;
+    uint32_t shard;
+
+    if (!enif_get_resource(env, argv[0], dpiRouter_type, (void **)&routerRes))
+        BADARG_EXCEPTION(0, "resource router");
+    if (!router_lock(routerRes))
+        RAISE_STR_EXCEPTION("router is released");
+    int found = router_shardOf(env, routerRes, argv[1], &shard);
+    enif_mutex_unlock(routerRes->lock);
+    if (!found)
+        BADARG_EXCEPTION(1, "shard key");
+
+    RETURNED_TRACE;
+    return enif_make_uint(env, shard);
+}
+
+DPI_NIF_FUN(router_getConn)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiRouter_res *routerRes;
+    uint32_t shard;
+
+    if (!enif_get_resource(env, argv[0], dpiRouter_type, (void **)&routerRes))
+        BADARG_EXCEPTION(0, "resource router");
+    if (!router_lock(routerRes))
+        RAISE_STR_EXCEPTION("router is released");
+    if (!router_shardOf(env, routerRes, argv[1], &shard))
+    {
+        enif_mutex_unlock(routerRes->lock);
+        BADARG_EXCEPTION(1, "shard key");
+    }
+    ERL_NIF_TERM connResTerm =
+        enif_make_resource(env, router_pickConn(routerRes, shard));
+    enif_mutex_unlock(routerRes->lock);
+
+    RETURNED_TRACE;
+    return connResTerm;
+}
+
+DPI_NIF_FUN(router_prepareStmt)
+{
+    CHECK_ARGCOUNT(5);
+
+    dpiRouter_res *routerRes;
+    uint32_t shard;
+    ErlNifBinary bin;
+
+    if (!enif_get_resource(env, argv[0], dpiRouter_type, (void **)&routerRes))
+        BADARG_EXCEPTION(0, "resource router");
+    if (enif_compare(argv[2], ATOM_TRUE) != 0 &&
+        enif_compare(argv[2], ATOM_FALSE) != 0)
+        BADARG_EXCEPTION(2, "bool/atom scrollable");
+    if (!enif_inspect_binary(env, argv[3], &bin))
+        BADARG_EXCEPTION(3, "binary/string sql");
+    if (!enif_inspect_binary(env, argv[4], &bin))
+        BADARG_EXCEPTION(4, "binary/string tag");
+    if (!router_lock(routerRes))
+        RAISE_STR_EXCEPTION("router is released");
+    if (!router_shardOf(env, routerRes, argv[1], &shard))
+    {
+        enif_mutex_unlock(routerRes->lock);
+        BADARG_EXCEPTION(1, "shard key");
+    }
+
+    // the statement keeps the connection of the shard alive
+    ERL_NIF_TERM args[] = {
+        enif_make_resource(env, router_pickConn(routerRes, shard)), argv[2],
+        argv[3], argv[4]};
+    enif_mutex_unlock(routerRes->lock);
+
+    RETURNED_TRACE;
+    return conn_prepareStmt(env, 4, args);
+}
+
+DPI_NIF_FUN(router_scatter)
+{
+    CHECK_ARGCOUNT(5);
+
+    dpiRouter_res *routerRes;
+    ErlNifBinary sql;
+    ErlNifPid owner;
+    uint32_t batchRows, credits;
+
+    if (!enif_get_resource(env, argv[0], dpiRouter_type, (void **)&routerRes))
+        BADARG_EXCEPTION(0, "resource router");
+    if (!enif_inspect_binary(env, argv[1], &sql))
+        BADARG_EXCEPTION(1, "string sql");
+    if (!enif_get_local_pid(env, argv[2], &owner))
+        BADARG_EXCEPTION(2, "local pid owner");
+    if (!enif_get_uint(env, argv[3], &batchRows) || batchRows == 0)
+        BADARG_EXCEPTION(3, "uint batchRows");
+    if (!enif_get_uint(env, argv[4], &credits))
+        BADARG_EXCEPTION(4, "uint credits");
+
+    // one connection per shard, partition N of the scan runs on shard N
+    if (!router_lock(routerRes))
+        RAISE_STR_EXCEPTION("router is released");
+    ERL_NIF_TERM conns = enif_make_list(env, 0);
+    for (uint32_t s = routerRes->numShards; s > 0; s--)
+        conns = enif_make_list_cell(
+            env, enif_make_resource(env, router_pickConn(routerRes, s - 1)),
+            conns);
+    enif_mutex_unlock(routerRes->lock);
+
+    ERL_NIF_TERM args[] = {
+        conns, argv[1], enif_make_uint(env, routerRes->numShards), argv[2],
+        argv[3], argv[4]};
+
+    // #{scan => reference, ref => reference}
+    RETURNED_TRACE;
+    return scan_start(env, 6, args);
+}
+
+DPI_NIF_FUN(router_release)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiRouter_res *routerRes;
+
+    if (!enif_get_resource(env, argv[0], dpiRouter_type, (void **)&routerRes))
+        BADARG_EXCEPTION(0, "resource router");
+
+    // releasing twice is a no-op, the dtor frees the shards
+    if (router_lock(routerRes))
+    {
+        routerRes->released = 1;
+        enif_mutex_unlock(routerRes->lock);
+        RELEASE_RESOURCE(routerRes, dpiRouter);
+    }
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
@@ -0,0 +1,59 @@
+#ifndef _DPIROUTER_NIF_H_
+#define _DPIROUTER_NIF_H_
+
+#include "dpi_nif.h"
+#include "dpi.h"
+#include "dpiConn_nif.h"
+
+#define ROUTER_TABLE_HASH 0
+#define ROUTER_TABLE_RANGE 1
+
+#define ROUTER_MAX_VNODES 4096
+
+// connections of one shard, handed out round robin
+typedef struct
+{
+    dpiConn_res **conns;
+    uint32_t numConns;
+    uint32_t next;
+} dpiRouterShard;
+
+// a virtual node of a shard on the consistent hash ring
+typedef struct
+{
+    uint64_t hash;
+    uint32_t shard;
+} dpiRouterPoint;
+
+typedef struct
+{
+    ErlNifMutex *lock; // guards released and next of the shards
+    int released; // by router_release, the tables stay until the dtor
+    dpiRouterShard *shards;
+    uint32_t numShards;
+    int table;
+    dpiRouterPoint *ring; // sorted by hash
+    uint32_t numPoints;
+    int64_t *bounds; // numShards - 1 ascending exclusive upper bounds
+} dpiRouter_res;
+
+extern ErlNifResourceType *dpiRouter_type;
+
+extern void dpiRouter_res_dtor(ErlNifEnv *env, void *resource);
+
+extern DPI_NIF_FUN(router_create);
+extern DPI_NIF_FUN(router_route);
+extern DPI_NIF_FUN(router_getConn);
+extern DPI_NIF_FUN(router_prepareStmt);
+extern DPI_NIF_FUN(router_scatter);
+extern DPI_NIF_FUN(router_release);
+
+#define DPIROUTER_NIFS                      \
+    DEF_NIF(router_create, 2),              \
+        DEF_NIF(router_route, 2),           \
+        DEF_NIF(router_getConn, 2),         \
+        IOB_NIF(router_prepareStmt, 5),     \
+        IOB_NIF(router_scatter, 5),         \
+        DEF_NIF(router_release, 1)
+
+#endif // _DPIROUTER_NIF_H_
@@ -0,0 +1,430 @@
+#include "dpiScan_nif.h"
+#include "dpiStmt_nif.h"
+
+#include <string.h>
+
+/*
+ * Parallel partitioned scan
+ * the query template is run once per partition with :partition bound to the
+ * partition index (0 based) and :partitions to the partition count, which
+ * the query turns into a ROWID/hash range (for example
+ * "where mod(ora_hash(rowid), :partitions) = :partition"). Partitions are
+ * spread round robin over the connections, one native thread per
+ * connection, and their rows are sent as {dpi_scan, Ref, Partition, Rows},
+ * followed by {dpi_scan_done, Ref, Partition} or
+ * {dpi_scan_error, Ref, Partition, ErrorMap}. With a single owner the
+ * partitions are merged into one stream, with a list of owners partition N
+ * goes to the Nth owner. Every batch consumes one credit of the scan, the
+ * workers wait for scan_ack once the credits are used up. The scan monitors
+ * its owners and ends for all workers once one of them is down, also while
+ * they wait for credits
+ */
+
+ErlNifResourceType *dpiScan_type;
+
+void dpiScan_res_dtor(ErlNifEnv *env, void *resource)
+{
+    CALL_TRACE;
+
+    // the workers keep the resource, so all of them have ended here
+    dpiScan_res *scanRes = (dpiScan_res *)resource;
+    enif_free(scanRes->workers);
+    enif_free(scanRes->owners);
+    enif_free(scanRes->sql);
+    enif_free_env(scanRes->refEnv);
+    enif_cond_destroy(scanRes->cond);
+    enif_mutex_destroy(scanRes->lock);
+
+    RETURNED_TRACE;
+}
+
+// binds the partition placeholders which are used by the query
+static int scan_bindPartition(dpiStmt *stmt, uint32_t partition,
+                              uint32_t partitions)
+{
+    uint32_t numBinds, *nameLengths;
+    const char **names;
+    dpiData value;
+    int ret = DPI_SUCCESS;
+
+    if (DPI_FAILURE == dpiStmt_getBindCount(stmt, &numBinds))
+        return DPI_FAILURE;
+    if (numBinds == 0)
+        return DPI_SUCCESS;
+
+    names = enif_alloc(numBinds * sizeof(const char *));
+    nameLengths = enif_alloc(numBinds * sizeof(uint32_t));
+    if (DPI_FAILURE ==
+        dpiStmt_getBindNames(stmt, &numBinds, names, nameLengths))
+        ret = DPI_FAILURE;
+
+    value.isNull = 0;
+    for (uint32_t i = 0; ret == DPI_SUCCESS && i < numBinds; i++)
+    {
+        if (nameLengths[i] == 9 &&
+            strncmp(names[i], "PARTITION", 9) == 0)
+            value.value.asInt64 = partition;
+        else if (nameLengths[i] == 10 &&
+                 strncmp(names[i], "PARTITIONS", 10) == 0)
+            value.value.asInt64 = partitions;
+        else
+            continue;
+        ret = dpiStmt_bindValueByName(
+            stmt, names[i], nameLengths[i], DPI_NATIVE_TYPE_INT64, &value);
+    }
+
+    enif_free(names);
+    enif_free(nameLengths);
+    return ret;
+}
+
+// waits for a credit, returns 0 if the scan was stopped
+static int scan_takeCredit(dpiScan_res *scanRes)
+{
+    int ok;
+
+    enif_mutex_lock(scanRes->lock);
+    while (scanRes->credits == 0 && !scanRes->stop)
+        enif_cond_wait(scanRes->cond, scanRes->lock);
+    ok = !scanRes->stop;
+    if (ok)
+        scanRes->credits--;
+    enif_mutex_unlock(scanRes->lock);
+
+    return ok;
+}
+
+// signals the workers to end, the lock is held
+static void scan_signalStop(dpiScan_res *scanRes)
+{
+    scanRes->stop = 1;
+    enif_cond_broadcast(scanRes->cond);
+}
+
+// an owner is down, nobody will ack, so the waiting workers end as well
+void dpiScan_res_down(
+    ErlNifEnv *env, void *resource, ErlNifPid *pid, ErlNifMonitor *mon)
+{
+    CALL_TRACE;
+
+    dpiScan_res *scanRes = (dpiScan_res *)resource;
+    enif_mutex_lock(scanRes->lock);
+    scan_signalStop(scanRes);
+    enif_mutex_unlock(scanRes->lock);
+
+    RETURNED_TRACE;
+}
+
+// a failed send means that the owner is gone, which stops the scan
+static void scan_send(dpiScanWorker *worker, uint32_t partition,
+                      ERL_NIF_TERM msg)
+{
+    dpiScan_res *scanRes = worker->scanRes;
+
+    if (!enif_send(
+            NULL,
+            &scanRes->owners[scanRes->numOwners == 1 ? 0 : partition],
+            worker->msgEnv, msg))
+    {
+        enif_mutex_lock(scanRes->lock);
+        scan_signalStop(scanRes);
+        enif_mutex_unlock(scanRes->lock);
+    }
+    enif_clear_env(worker->msgEnv);
+}
+
+/*
+ * scans one partition, returns 0 if the scan was stopped, errors are sent
+ * to the owner and the worker goes on with its next partition
+ */
+static int scan_partition(dpiScanWorker *worker, uint32_t partition)
+{
+    dpiScan_res *scanRes = worker->scanRes;
+    ErlNifEnv *msgEnv = worker->msgEnv;
+    dpiStmt_res stmtRes;
+    ERL_NIF_TERM rows;
+    int moreRows = 1, result = DPI_SUCCESS, running = 1;
+    uint32_t numCols;
+
+    dpiStmt_res_init(&stmtRes, worker->connRes->context);
+    if (DPI_FAILURE ==
+            dpiConn_prepareStmt(
+                worker->connRes->conn, 0, scanRes->sql, scanRes->sqlLength,
+                NULL, 0, &stmtRes.stmt) ||
+        DPI_FAILURE ==
+            scan_bindPartition(stmtRes.stmt, partition, scanRes->partitions) ||
+        DPI_FAILURE ==
+            dpiStmt_setFetchArraySize(stmtRes.stmt, scanRes->batchRows) ||
+        DPI_FAILURE == dpiStmt_execute(stmtRes.stmt, 0, &numCols))
+        result = DPI_FAILURE;
+    dpiConn_res_forgetAttrs(worker->connRes, stmtRes.stmt);
+
+    if (result == DPI_SUCCESS)
+        switch (dpiStmt_res_checkDecoders(&stmtRes))
+        {
+        case STMT_DECODERS_OK:
+            break;
+        case STMT_DECODERS_DPI_ERROR:
+            result = DPI_FAILURE;
+            break;
+        default:
+            scan_send(
+                worker, partition,
+                enif_make_tuple4(
+                    msgEnv, enif_make_atom(msgEnv, "dpi_scan_error"),
+                    enif_make_copy(msgEnv, scanRes->ref),
+                    enif_make_uint(msgEnv, partition),
+                    enif_make_string(
+                        msgEnv, "query has unsupported columns",
+                        ERL_NIF_LATIN1)));
+            moreRows = 0;
+        }
+
+    while (result == DPI_SUCCESS && moreRows)
+    {
+        if (!(running = scan_takeCredit(scanRes)))
+            break;
+        result = dpiStmt_res_fetchRows(
+            msgEnv, &stmtRes, scanRes->batchRows, &rows, &moreRows);
+        if (result == DPI_SUCCESS && !enif_is_empty_list(msgEnv, rows))
+            scan_send(
+                worker, partition,
+                enif_make_tuple4(
+                    msgEnv, enif_make_atom(msgEnv, "dpi_scan"),
+                    enif_make_copy(msgEnv, scanRes->ref),
+                    enif_make_uint(msgEnv, partition), rows));
+    }
+
+    if (result == DPI_FAILURE)
+    {
+        dpiErrorInfo err;
+        dpiContext_getError(stmtRes.context, &err);
+        enif_clear_env(msgEnv);
+        scan_send(
+            worker, partition,
+            enif_make_tuple4(
+                msgEnv, enif_make_atom(msgEnv, "dpi_scan_error"),
+                enif_make_copy(msgEnv, scanRes->ref),
+                enif_make_uint(msgEnv, partition),
+                dpiErrorInfoMap(msgEnv, err)));
+    }
+    else if (running && !moreRows)
+        scan_send(
+            worker, partition,
+            enif_make_tuple3(
+                msgEnv, enif_make_atom(msgEnv, "dpi_scan_done"),
+                enif_make_copy(msgEnv, scanRes->ref),
+                enif_make_uint(msgEnv, partition)));
+
+    dpiStmt_res_freeDecoders(&stmtRes);
+    if (stmtRes.stmt)
+        dpiStmt_release(stmtRes.stmt);
+
+    return running;
+}
+
+static void *scan_workerThread(void *arg)
+{
+    dpiScanWorker *worker = (dpiScanWorker *)arg;
+    dpiScan_res *scanRes = worker->scanRes;
+
+    for (uint32_t p = worker->first; p < scanRes->partitions;
+         p += scanRes->numWorkers)
+        if (!scan_partition(worker, p))
+            break;
+
+    enif_free_env(worker->msgEnv);
+    enif_release_resource(worker->connRes);
+
+    enif_mutex_lock(scanRes->lock);
+    scanRes->running--;
+    enif_cond_broadcast(scanRes->cond);
+    enif_mutex_unlock(scanRes->lock);
+
+    oranif_threadExit();
+    enif_release_resource(scanRes);
+
+    return NULL;
+}
+
+/*
+ * stops the workers and waits until they have ended, returns 0 if the scan
+ * was already stopped by another call
+ */
+static int scan_stopWorkers(dpiScan_res *scanRes)
+{
+    int first;
+
+    enif_mutex_lock(scanRes->lock);
+    first = !scanRes->stopped;
+    scanRes->stopped = 1;
+    scan_signalStop(scanRes);
+    while (scanRes->running > 0)
+        enif_cond_wait(scanRes->cond, scanRes->lock);
+    enif_mutex_unlock(scanRes->lock);
+
+    return first;
+}
+
+DPI_NIF_FUN(scan_start)
+{
+    CHECK_ARGCOUNT(6);
+
+    unsigned numConns, numOwners = 1;
+    uint32_t partitions, batchRows, credits;
+    ErlNifBinary sql;
+    ErlNifPid owner;
+    ERL_NIF_TERM head, tail;
+
+    if (!enif_get_list_length(env, argv[0], &numConns) || numConns == 0)
+        BADARG_EXCEPTION(0, "list of resource connection");
+    if (!enif_inspect_binary(env, argv[1], &sql))
+        BADARG_EXCEPTION(1, "string sql");
+    if (!enif_get_uint(env, argv[2], &partitions) || partitions == 0)
+        BADARG_EXCEPTION(2, "uint partitions");
+    if (!enif_get_local_pid(env, argv[3], &owner) &&
+        (!enif_get_list_length(env, argv[3], &numOwners) ||
+         numOwners != partitions))
+        BADARG_EXCEPTION(3, "local pid or list of local pid owners");
+    if (!enif_get_uint(env, argv[4], &batchRows) || batchRows == 0)
+        BADARG_EXCEPTION(4, "uint batchRows");
+    if (!enif_get_uint(env, argv[5], &credits))
+        BADARG_EXCEPTION(5, "uint credits");
+
+    ErlNifPid *owners = enif_alloc(numOwners * sizeof(ErlNifPid));
+    if (enif_is_list(env, argv[3]))
+    {
+        tail = argv[3];
+        for (unsigned o = 0; enif_get_list_cell(env, tail, &head, &tail); o++)
+            if (!enif_get_local_pid(env, head, &owners[o]))
+            {
+                enif_free(owners);
+                BADARG_EXCEPTION(3, "local pid or list of local pid owners");
+            }
+    }
+    else
+        owners[0] = owner;
+
+    uint32_t numWorkers = numConns < partitions ? numConns : partitions;
+    dpiScanWorker *workers = enif_alloc(numWorkers * sizeof(dpiScanWorker));
+    tail = argv[0];
+    for (uint32_t w = 0; w < numWorkers; w++)
+    {
+        enif_get_list_cell(env, tail, &head, &tail);
+        if (!enif_get_resource(
+                env, head, dpiConn_type, (void **)&workers[w].connRes))
+        {
+            enif_free(workers);
+            enif_free(owners);
+            BADARG_EXCEPTION(0, "list of resource connection");
+        }
+    }
+
+    dpiScan_res *scanRes;
+    ALLOC_RESOURCE(scanRes, dpiScan);
+    scanRes->lock = enif_mutex_create("oranif_scan");
+    scanRes->cond = enif_cond_create("oranif_scan");
+    scanRes->refEnv = enif_alloc_env();
+    scanRes->ref = enif_make_ref(scanRes->refEnv);
+    scanRes->owners = owners;
+    scanRes->numOwners = numOwners;
+    scanRes->sql = enif_alloc(sql.size);
+    memcpy(scanRes->sql, sql.data, sql.size);
+    scanRes->sqlLength = sql.size;
+    scanRes->partitions = partitions;
+    scanRes->batchRows = batchRows;
+    scanRes->credits = credits;
+    scanRes->stop = 0;
+    scanRes->stopped = 0;
+    scanRes->running = 0;
+    scanRes->numWorkers = numWorkers;
+    scanRes->workers = workers;
+
+    // an owner which is already gone stops the scan before it starts
+    for (uint32_t o = 0; o < numOwners; o++)
+        if (enif_monitor_process(env, scanRes, &owners[o], NULL))
+            scanRes->stop = 1;
+
+    int failed = 0;
+    for (uint32_t w = 0; w < numWorkers && !failed; w++)
+    {
+        dpiScanWorker *worker = &workers[w];
+        // the connections stay valid while the worker is running
+        enif_keep_resource(worker->connRes);
+        enif_keep_resource(scanRes);
+        worker->scanRes = scanRes;
+        worker->first = w;
+        worker->msgEnv = enif_alloc_env();
+        enif_mutex_lock(scanRes->lock);
+        scanRes->running++;
+        enif_mutex_unlock(scanRes->lock);
+        if (!oranif_threadCreate("oranif_scan", scan_workerThread, worker))
+        {
+            enif_mutex_lock(scanRes->lock);
+            scanRes->running--;
+            enif_mutex_unlock(scanRes->lock);
+            enif_free_env(worker->msgEnv);
+            enif_release_resource(worker->connRes);
+            enif_release_resource(scanRes);
+            failed = 1;
+        }
+    }
+    if (failed)
+    {
+        scan_stopWorkers(scanRes);
+        RELEASE_RESOURCE(scanRes, dpiScan);
+        RAISE_STR_EXCEPTION("failed to create scan thread");
+    }
+
+    ERL_NIF_TERM keys[] = {ATOM_ref, ATOM_scan};
+    ERL_NIF_TERM values[] = {
+        enif_make_copy(env, scanRes->ref), enif_make_resource(env, scanRes)};
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
+
+    // #{scan => reference, ref => reference}
+    RETURNED_TRACE;
+    return map;
+}
+
+DPI_NIF_FUN(scan_ack)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiScan_res *scanRes;
+    uint32_t credits;
+
+    if (!enif_get_resource(env, argv[0], dpiScan_type, (void **)&scanRes))
+        BADARG_EXCEPTION(0, "resource scan");
+    if (!enif_get_uint(env, argv[1], &credits))
+        BADARG_EXCEPTION(1, "uint credits");
+
+    enif_mutex_lock(scanRes->lock);
+    if (scanRes->stop)
+    {
+        enif_mutex_unlock(scanRes->lock);
+        RAISE_STR_EXCEPTION("scan is stopped");
+    }
+    scanRes->credits += credits;
+    enif_cond_broadcast(scanRes->cond);
+    enif_mutex_unlock(scanRes->lock);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(scan_stop)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiScan_res *scanRes;
+
+    if (!enif_get_resource(env, argv[0], dpiScan_type, (void **)&scanRes))
+        BADARG_EXCEPTION(0, "resource scan");
+
+    // stopping twice only waits for the workers again
+    if (scan_stopWorkers(scanRes))
+        RELEASE_RESOURCE(scanRes, dpiScan);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
@@ -0,0 +1,58 @@
+#ifndef _DPISCAN_NIF_H_
+#define _DPISCAN_NIF_H_
+
+#include "dpi_nif.h"
+#include "dpi.h"
+#include "dpiConn_nif.h"
+
+struct dpiScan_res;
+
+// one native thread scanning the partitions assigned to one connection
+typedef struct
+{
+    struct dpiScan_res *scanRes;
+    dpiConn_res *connRes;
+    uint32_t first; // first partition, then every numWorkers-th one
+    ErlNifEnv *msgEnv;
+} dpiScanWorker;
+
+/*
+ * every running worker keeps the resource, so that lock, cond and the rest
+ * of the state are only freed by the destructor
+ */
+typedef struct dpiScan_res
+{
+    ErlNifMutex *lock; // guards credits, stop, stopped and running
+    ErlNifCond *cond;
+    ErlNifEnv *refEnv;
+    ERL_NIF_TERM ref;
+    ErlNifPid *owners; // one owner, or one per partition
+    uint32_t numOwners;
+    char *sql;
+    uint32_t sqlLength;
+    uint32_t partitions;
+    uint32_t batchRows;
+    uint32_t credits;
+    int stop;     // the workers end, set by scan_stop or if an owner is down
+    int stopped;  // scan_stop dropped the reference of scan_start
+    uint32_t running; // workers which haven't ended yet
+    uint32_t numWorkers;
+    dpiScanWorker *workers;
+} dpiScan_res;
+
+extern ErlNifResourceType *dpiScan_type;
+
+extern void dpiScan_res_dtor(ErlNifEnv *env, void *resource);
+extern void dpiScan_res_down(
+    ErlNifEnv *env, void *resource, ErlNifPid *pid, ErlNifMonitor *mon);
+
+extern DPI_NIF_FUN(scan_start);
+extern DPI_NIF_FUN(scan_ack);
+extern DPI_NIF_FUN(scan_stop);
+
+#define DPISCAN_NIFS              \
+    IOB_NIF(scan_start, 6),       \
+        DEF_NIF(scan_ack, 2),     \
+        IOB_NIF(scan_stop, 1)
+
+#endif // _DPISCAN_NIF_H_
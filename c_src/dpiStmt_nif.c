@@ -3,15 +3,286 @@
 #include "dpiConn_nif.h"
 #include "dpiData_nif.h"
 #include "dpiQueryInfo_nif.h"
+#include "dpiObject_nif.h"
 
 ErlNifResourceType *dpiStmt_type;
 
+#ifndef enif_compare_pids // before OTP 22
+#define enif_compare_pids(_a, _b) enif_compare((_a)->pid, (_b)->pid)
+#endif
+
+static void stmt_freeStream(dpiStream *stream);
+static void stmt_freePrefetch(dpiPrefetch *prefetch);
+static void stmt_releaseVars(dpiStmt_res *stmtRes);
+
 void dpiStmt_res_dtor(ErlNifEnv *env, void *resource)
 {
     CALL_TRACE;
+
+    dpiStmt_res *stmtRes = (dpiStmt_res *)resource;
+    // threads keep the resource, so none is running here and none is joined
+    if (stmtRes->stream)
+        stmt_freeStream(stmtRes->stream);
+    if (stmtRes->prefetch)
+        stmt_freePrefetch(stmtRes->prefetch);
+    dpiStmt_res_freeDecoders(stmtRes);
+    stmt_releaseVars(stmtRes);
+    if (stmtRes->connRes)
+    {
+        enif_release_resource(stmtRes->connRes);
+        stmtRes->connRes = NULL;
+    }
+    if (stmtRes->lock)
+    {
+        enif_cond_destroy(stmtRes->cond);
+        enif_mutex_destroy(stmtRes->lock);
+        stmtRes->lock = NULL;
+    }
+
     RETURNED_TRACE;
 }
 
+void dpiStmt_res_init(dpiStmt_res *stmtRes, dpiContext *context)
+{
+    stmtRes->stmt = NULL;
+    stmtRes->context = context;
+    stmtRes->numCols = 0;
+    stmtRes->decoders = NULL;
+    stmtRes->row = NULL;
+    stmtRes->charsetMode = DPI_CHARSET_NONE;
+    stmtRes->lock = NULL;
+    stmtRes->cond = NULL;
+    stmtRes->stream = NULL;
+    stmtRes->prefetch = NULL;
+    stmtRes->connRes = NULL;
+    stmtRes->ownable = 0;
+    stmtRes->ownerState = STMT_OWNER_NONE;
+    stmtRes->vars = NULL;
+    stmtRes->numVars = 0;
+}
+
+/*
+ * for statement resources only, keeps connRes (may be NULL) until the
+ * resource is gone and makes the statement ownable (see stmt_setOwner) and
+ * able to stream or prefetch
+ */
+void dpiStmt_res_attach(dpiStmt_res *stmtRes, dpiConn_res *connRes)
+{
+    stmtRes->connRes = connRes;
+    if (connRes)
+        enif_keep_resource(connRes);
+    stmtRes->ownable = 1;
+    stmtRes->lock = enif_mutex_create("oranif_stmt");
+    stmtRes->cond = enif_cond_create("oranif_stmt");
+}
+
+/*
+ * keeps a poolable variable bound to or defined on the statement until the
+ * statement is closed, conn_recycleVar refuses variables in use, returns 0
+ * if out of memory
+ */
+static int stmt_useVar(dpiStmt_res *stmtRes, dpiVar_res *varRes)
+{
+    if (!varRes->conn)
+        return 1;
+    for (uint32_t i = 0; i < stmtRes->numVars; i++)
+        if (stmtRes->vars[i] == varRes)
+            return 1;
+
+    void **vars = enif_realloc(
+        stmtRes->vars, (stmtRes->numVars + 1) * sizeof(void *));
+    if (!vars)
+        return 0;
+    vars[stmtRes->numVars++] = varRes;
+    stmtRes->vars = vars;
+    enif_keep_resource(varRes);
+    oranif_atomicAdd(&varRes->stmtUses, 1);
+
+    return 1;
+}
+
+static void stmt_releaseVars(dpiStmt_res *stmtRes)
+{
+    for (uint32_t i = 0; i < stmtRes->numVars; i++)
+    {
+        dpiVar_res *varRes = (dpiVar_res *)stmtRes->vars[i];
+        oranif_atomicAdd(&varRes->stmtUses, -1);
+        enif_release_resource(varRes);
+    }
+    if (stmtRes->vars)
+        enif_free(stmtRes->vars);
+    stmtRes->vars = NULL;
+    stmtRes->numVars = 0;
+}
+
+static int stmt_isSelf(ErlNifEnv *env, ErlNifPid *pid)
+{
+    ErlNifPid self;
+
+    return enif_self(env, &self) && enif_compare_pids(&self, pid) == 0;
+}
+
+// called by every statement NIF, so it takes no lock
+int dpiStmt_res_isOwner(ErlNifEnv *env, dpiStmt_res *stmtRes)
+{
+    if (!stmtRes->ownable)
+        return 1;
+    switch (oranif_atomicAdd(&stmtRes->ownerState, 0))
+    {
+    case STMT_OWNER_NONE:
+        return 1;
+    case STMT_OWNER_SET:
+        return stmt_isSelf(env, &stmtRes->owner);
+    default: // another process is taking the statement over
+        return 0;
+    }
+}
+
+void dpiStmt_res_freeDecoders(dpiStmt_res *stmtRes)
+{
+    if (stmtRes->decoders)
+    {
+        enif_free(stmtRes->decoders);
+        enif_free(stmtRes->row);
+        stmtRes->decoders = NULL;
+        stmtRes->row = NULL;
+        stmtRes->numCols = 0;
+    }
+}
+
+// string columns fetched as bytes, decoded according to the charset mode
+static int stmt_isStringColumn(dpiQueryInfo *queryInfo)
+{
+    if (queryInfo->typeInfo.defaultNativeTypeNum != DPI_NATIVE_TYPE_BYTES)
+        return 0;
+    switch (queryInfo->typeInfo.oracleTypeNum)
+    {
+    case DPI_ORACLE_TYPE_VARCHAR:
+    case DPI_ORACLE_TYPE_CHAR:
+    case DPI_ORACLE_TYPE_LONG_VARCHAR:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * (re)builds the row decoder of the statement from the query info of each
+ * column, so that fetching rows doesn't need to look at the type of every
+ * value again, columns of unsupported types get a NULL decoder
+ */
+static int stmt_buildDecoders(dpiStmt_res *stmtRes, uint32_t numCols)
+{
+    dpiQueryInfo queryInfo;
+
+    dpiStmt_res_freeDecoders(stmtRes);
+    stmtRes->numCols = numCols;
+    stmtRes->decoders = enif_alloc(numCols * sizeof(dpiDataDecoder));
+    stmtRes->row = enif_alloc(numCols * sizeof(ERL_NIF_TERM));
+
+    for (uint32_t i = 0; i < numCols; i++)
+    {
+        if (DPI_FAILURE ==
+            dpiStmt_getQueryInfo(stmtRes->stmt, i + 1, &queryInfo))
+        {
+            dpiStmt_res_freeDecoders(stmtRes);
+            return DPI_FAILURE;
+        }
+        // nullOk isn't trusted, columns reached through outer joins and some
+        // views are reported NOT NULL and still return NULL values
+        stmtRes->decoders[i] = NULL;
+        if (stmt_isStringColumn(&queryInfo))
+            stmtRes->decoders[i] =
+                dpiData_getCharsetDecoder(stmtRes->charsetMode, 1);
+        if (!stmtRes->decoders[i])
+            stmtRes->decoders[i] = dpiData_getDecoder(
+                queryInfo.typeInfo.defaultNativeTypeNum, 1);
+    }
+
+    return DPI_SUCCESS;
+}
+
+// replaces the decoder of one column after a define changed its native type
+static void stmt_redefineDecoder(
+    dpiStmt_res *stmtRes, uint32_t pos, dpiNativeTypeNum nativeType)
+{
+    if (stmtRes->decoders && pos > 0 && pos <= stmtRes->numCols)
+        stmtRes->decoders[pos - 1] = dpiData_getDecoder(nativeType, 1);
+}
+
+/*
+ * builds the row decoder if the statement wasn't executed through
+ * stmt_execute (REF CURSORs, implicit results) and checks that all columns
+ * can be decoded
+ */
+int dpiStmt_res_checkDecoders(dpiStmt_res *stmtRes)
+{
+    uint32_t numCols;
+
+    if (!stmtRes->decoders)
+    {
+        if (DPI_FAILURE ==
+            dpiStmt_getNumQueryColumns(stmtRes->stmt, &numCols))
+            return STMT_DECODERS_DPI_ERROR;
+        if (numCols == 0)
+            return STMT_DECODERS_NOT_QUERY;
+        if (DPI_FAILURE == stmt_buildDecoders(stmtRes, numCols))
+            return STMT_DECODERS_DPI_ERROR;
+    }
+    for (uint32_t c = 0; c < stmtRes->numCols; c++)
+        if (!stmtRes->decoders[c])
+            return STMT_DECODERS_UNSUPPORTED;
+
+    return STMT_DECODERS_OK;
+}
+
+/*
+ * fetches up to maxRows rows into a list of row lists built in env, the
+ * row decoder must have been checked by dpiStmt_res_checkDecoders before
+ */
+int dpiStmt_res_fetchRows(
+    ErlNifEnv *env, dpiStmt_res *stmtRes, uint32_t maxRows,
+    ERL_NIF_TERM *rows, int *moreRows)
+{
+    uint32_t bufferRowIndex, rowCount = 0, numCols = stmtRes->numCols;
+    dpiNativeTypeNum nativeTypeNum;
+    dpiData *data;
+    int found = 1;
+
+    *rows = enif_make_list(env, 0);
+    while (rowCount < maxRows)
+    {
+        if (DPI_FAILURE ==
+            dpiStmt_fetch(stmtRes->stmt, &found, &bufferRowIndex))
+            return DPI_FAILURE;
+        if (!found)
+            break;
+
+        for (uint32_t c = 0; c < numCols; c++)
+        {
+            if (DPI_FAILURE ==
+                dpiStmt_getQueryValue(
+                    stmtRes->stmt, c + 1, &nativeTypeNum, &data))
+                return DPI_FAILURE;
+            if (DPI_FAILURE ==
+                stmtRes->decoders[c](env, data, &stmtRes->row[c]))
+                return DPI_FAILURE;
+        }
+        *rows = enif_make_list_cell(
+            env, enif_make_list_from_array(env, stmtRes->row, numCols),
+            *rows);
+        rowCount++;
+    }
+    enif_make_reverse_list(env, *rows, rows);
+    *moreRows = found;
+
+    return DPI_SUCCESS;
+}
+
+static int stmt_fetchPrefetched(
+    ErlNifEnv *env, dpiStmt_res *stmtRes, uint32_t maxRows,
+    ERL_NIF_TERM *rows, int *moreRows);
+
 DPI_NIF_FUN(stmt_execute)
 {
     CHECK_ARGCOUNT(2);
@@ -21,6 +292,8 @@ DPI_NIF_FUN(stmt_execute)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
 
     ERL_NIF_TERM head, tail;
 
@@ -40,9 +313,15 @@ DPI_NIF_FUN(stmt_execute)
             mode |= m;
         } while (enif_get_list_cell(env, tail, &head, &tail));
 
-    RAISE_EXCEPTION_ON_DPI_ERROR(
-        stmtRes->context,
-        dpiStmt_execute(stmtRes->stmt, mode, &numCols));
+    dpiStmt_res_discardPrefetch(stmtRes);
+    dpiConn_res_touch(stmtRes->connRes);
+    int dpiResult = dpiStmt_execute(stmtRes->stmt, mode, &numCols);
+    dpiConn_res_forgetAttrs(stmtRes->connRes, stmtRes->stmt);
+    RAISE_EXCEPTION_ON_DPI_ERROR(stmtRes->context, dpiResult);
+
+    if (numCols > 0)
+        RAISE_EXCEPTION_ON_DPI_ERROR(
+            stmtRes->context, stmt_buildDecoders(stmtRes, numCols));
 
     RETURNED_TRACE;
     return enif_make_uint(env, numCols);
@@ -57,6 +336,8 @@ DPI_NIF_FUN(stmt_executeMany)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
 
     ERL_NIF_TERM head, tail;
 
@@ -79,9 +360,11 @@ DPI_NIF_FUN(stmt_executeMany)
             mode |= m;
         } while (enif_get_list_cell(env, tail, &head, &tail));
 
-    RAISE_EXCEPTION_ON_DPI_ERROR(
-        stmtRes->context,
-        dpiStmt_executeMany(stmtRes->stmt, mode, numIters));
+    dpiStmt_res_discardPrefetch(stmtRes);
+    dpiConn_res_touch(stmtRes->connRes);
+    int dpiResult = dpiStmt_executeMany(stmtRes->stmt, mode, numIters);
+    dpiConn_res_forgetAttrs(stmtRes->connRes, stmtRes->stmt);
+    RAISE_EXCEPTION_ON_DPI_ERROR(stmtRes->context, dpiResult);
 
     RETURNED_TRACE;
     return ATOM_OK;
@@ -97,26 +380,65 @@ DPI_NIF_FUN(stmt_fetch)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    CHECK_STMT_NOT_PREFETCHED(stmtRes);
 
+    dpiConn_res_touch(stmtRes->connRes);
     RAISE_EXCEPTION_ON_DPI_ERROR(
         stmtRes->context,
         dpiStmt_fetch(stmtRes->stmt, &found, &bufferRowIndex));
 
-    ERL_NIF_TERM map = enif_make_new_map(env);
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "found"),
-        enif_make_atom(
-            env, found ? "true" : "false"),
-        &map);
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "bufferRowIndex"),
-        enif_make_uint(env, bufferRowIndex), &map);
+    ERL_NIF_TERM keys[] = {ATOM_bufferRowIndex, ATOM_found};
+    ERL_NIF_TERM values[] = {
+        enif_make_uint(env, bufferRowIndex), found ? ATOM_TRUE : ATOM_FALSE};
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
 
     // #{bufferRowIndex => integer, found => atom}
     RETURNED_TRACE;
     return map;
 }
 
+DPI_NIF_FUN(stmt_fetchRows)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiStmt_res *stmtRes;
+    uint32_t maxRows;
+    int moreRows;
+    ERL_NIF_TERM rows;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    if (!enif_get_uint(env, argv[1], &maxRows))
+        BADARG_EXCEPTION(1, "uint maxRows");
+
+    RAISE_EXCEPTION_ON_DECODERS(stmtRes);
+
+    dpiConn_res_touch(stmtRes->connRes);
+    if (stmtRes->prefetch &&
+        (stmtRes->prefetch->enabled || stmtRes->prefetch->pending))
+    {
+        if (DPI_FAILURE ==
+            stmt_fetchPrefetched(env, stmtRes, maxRows, &rows, &moreRows))
+            RAISE_EXCEPTION(rows);
+    }
+    else
+        RAISE_EXCEPTION_ON_DPI_ERROR(
+            stmtRes->context,
+            dpiStmt_res_fetchRows(env, stmtRes, maxRows, &rows, &moreRows));
+
+    ERL_NIF_TERM keys[] = {ATOM_moreRows, ATOM_rows};
+    ERL_NIF_TERM values[] = {moreRows ? ATOM_TRUE : ATOM_FALSE, rows};
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
+
+    // #{rows => [[term]], moreRows => atom}
+    RETURNED_TRACE;
+    return map;
+}
+
 DPI_NIF_FUN(stmt_getQueryValue)
 {
     CHECK_ARGCOUNT(2);
@@ -127,6 +449,9 @@ DPI_NIF_FUN(stmt_getQueryValue)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    CHECK_STMT_NOT_PREFETCHED(stmtRes);
 
     if (!enif_get_uint(env, argv[1], &pos))
         BADARG_EXCEPTION(1, "uint pos");
@@ -134,8 +459,10 @@ DPI_NIF_FUN(stmt_getQueryValue)
     dpiDataPtr_res *data;
     ALLOC_RESOURCE(data, dpiDataPtr);
 
-    data->next = NULL;
     data->stmtRes = NULL;
+    data->connRes = stmtRes->connRes;
+    if (data->connRes)
+        enif_keep_resource(data->connRes);
     data->isQueryValue = 1;
     data->context = stmtRes->context;
 
@@ -151,13 +478,9 @@ DPI_NIF_FUN(stmt_getQueryValue)
     ERL_NIF_TERM nativeTypeNumAtom;
     DPI_NATIVE_TYPE_NUM_TO_ATOM(nativeTypeNum, nativeTypeNumAtom);
 
-    ERL_NIF_TERM map = enif_make_new_map(env);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "nativeTypeNum"), nativeTypeNumAtom,
-        &map);
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "data"), dpiDataRes, &map);
+    ERL_NIF_TERM keys[] = {ATOM_data, ATOM_nativeTypeNum};
+    ERL_NIF_TERM values[] = {dpiDataRes, nativeTypeNumAtom};
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
 
     // #{ nativeTypeNum => atom, data => term  }
     RETURNED_TRACE;
@@ -173,6 +496,8 @@ DPI_NIF_FUN(stmt_getQueryInfo)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
 
     if (!enif_get_uint(env, argv[1], &pos))
         BADARG_EXCEPTION(1, "uint pos");
@@ -183,56 +508,54 @@ DPI_NIF_FUN(stmt_getQueryInfo)
         dpiStmt_getQueryInfo(stmtRes->stmt, pos, &queryInfo));
 
     dpiDataTypeInfo dti = queryInfo.typeInfo;
-    ERL_NIF_TERM typeInfo = enif_make_new_map(env);
 
     // constructuing a map of
     // https://oracle.github.io/odpi/doc/structs/dpiDataTypeInfo.html
     ERL_NIF_TERM oracleTypeNumAtom;
     DPI_ORACLE_TYPE_NUM_TO_ATOM(dti.oracleTypeNum, oracleTypeNumAtom);
-    enif_make_map_put(env, typeInfo, enif_make_atom(env, "oracleTypeNum"),
-                      oracleTypeNumAtom, &typeInfo);
 
     ERL_NIF_TERM defaultNativeTypeNumAtom;
     DPI_NATIVE_TYPE_NUM_TO_ATOM(
         dti.defaultNativeTypeNum, defaultNativeTypeNumAtom);
 
-    enif_make_map_put(env, typeInfo,
-                      enif_make_atom(env, "defaultNativeTypeNum"),
-                      defaultNativeTypeNumAtom, &typeInfo);
-    enif_make_map_put(env, typeInfo, enif_make_atom(env, "ociTypeCode"),
-                      enif_make_uint(env, dti.ociTypeCode), &typeInfo);
-    enif_make_map_put(env, typeInfo, enif_make_atom(env, "dbSizeInBytes"),
-                      enif_make_uint(env, dti.dbSizeInBytes), &typeInfo);
-    enif_make_map_put(env, typeInfo, enif_make_atom(env, "clientSizeInBytes"),
-                      enif_make_uint(env, dti.clientSizeInBytes), &typeInfo);
-    enif_make_map_put(env, typeInfo, enif_make_atom(env, "sizeInChars"),
-                      enif_make_uint(env, dti.sizeInChars), &typeInfo);
-    enif_make_map_put(env, typeInfo, enif_make_atom(env, "precision"),
-                      enif_make_int(env, dti.precision), &typeInfo);
-    enif_make_map_put(env, typeInfo, enif_make_atom(env, "scale"),
-                      enif_make_int(env, dti.scale), &typeInfo);
-    enif_make_map_put(env, typeInfo, enif_make_atom(env, "fsPrecision"),
-                      enif_make_int(env, dti.fsPrecision), &typeInfo);
-    enif_make_map_put(env, typeInfo, enif_make_atom(env, "objectType"),
-                      enif_make_atom(env, "featureNotImplemented"), &typeInfo);
-
-    ERL_NIF_TERM resultMap = enif_make_new_map(env);
-    enif_make_map_put(env, resultMap, enif_make_atom(env, "typeInfo"),
-                      typeInfo, &resultMap);
-    enif_make_map_put(env, resultMap, enif_make_atom(env, "name"),
-                      enif_make_string_len(env, queryInfo.name,
-                                           queryInfo.nameLength,
-                                           ERL_NIF_LATIN1),
-                      &resultMap);
-    enif_make_map_put(env, resultMap, enif_make_atom(env, "nullOk"),
-                      enif_make_atom(
-                          env, queryInfo.nullOk ? "true" : "false"),
-                      &resultMap);
+    // a new resource per call, released by the caller (objectType_release)
+    ERL_NIF_TERM objectType = ATOM_NULL;
+    if (dti.objectType)
+    {
+        dpiObjectType_res *objTypeRes;
+        RAISE_EXCEPTION_ON_DPI_ERROR(
+            stmtRes->context, dpiObjectType_addRef(dti.objectType));
+        ALLOC_RESOURCE(objTypeRes, dpiObjectType);
+        objTypeRes->objType = dti.objectType;
+        objTypeRes->context = stmtRes->context;
+        objectType = enif_make_resource(env, objTypeRes);
+    }
+
+    ERL_NIF_TERM typeInfoKeys[] = {
+        ATOM_clientSizeInBytes, ATOM_dbSizeInBytes, ATOM_defaultNativeTypeNum,
+        ATOM_fsPrecision, ATOM_objectType, ATOM_ociTypeCode,
+        ATOM_oracleTypeNum, ATOM_precision, ATOM_scale, ATOM_sizeInChars};
+    ERL_NIF_TERM typeInfoValues[] = {
+        enif_make_uint(env, dti.clientSizeInBytes),
+        enif_make_uint(env, dti.dbSizeInBytes), defaultNativeTypeNumAtom,
+        enif_make_int(env, dti.fsPrecision), objectType,
+        enif_make_uint(env, dti.ociTypeCode), oracleTypeNumAtom,
+        enif_make_int(env, dti.precision), enif_make_int(env, dti.scale),
+        enif_make_uint(env, dti.sizeInChars)};
+
+    ERL_NIF_TERM keys[] = {ATOM_name, ATOM_nullOk, ATOM_typeInfo};
+    ERL_NIF_TERM values[] = {
+        enif_make_string_len(
+            env, queryInfo.name, queryInfo.nameLength, ERL_NIF_LATIN1),
+        queryInfo.nullOk ? ATOM_TRUE : ATOM_FALSE,
+        MAKE_MAP(env, typeInfoKeys, typeInfoValues)};
+    ERL_NIF_TERM resultMap = MAKE_MAP(env, keys, values);
 
     /* #{name => "A", nullOk => atom,
          typeInfo => #{clientSizeInBytes => integer, dbSizeInBytes => integer,
                        defaultNativeTypeNum => atom, fsPrecision => integer,
-                       objectType => atom, ociTypeCode => integer,
+                       objectType => reference | null,
+                       ociTypeCode => integer,
                        oracleTypeNum => atom , precision => integer,
                        scale => integer, sizeInChars => integer}
         } */
@@ -249,6 +572,8 @@ DPI_NIF_FUN(stmt_getNumQueryColumns)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
 
     RAISE_EXCEPTION_ON_DPI_ERROR(
         stmtRes->context,
@@ -268,6 +593,8 @@ DPI_NIF_FUN(stmt_bindValueByPos)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
     if (!enif_get_uint(env, argv[1], &pos))
         BADARG_EXCEPTION(1, "uint pos");
     if (!enif_get_resource(env, argv[3], dpiData_type, (void **)&dataRes))
@@ -295,6 +622,8 @@ DPI_NIF_FUN(stmt_bindValueByName)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
     if (!enif_inspect_binary(env, argv[1], &binary))
         BADARG_EXCEPTION(1, "string/list name");
     if (!enif_get_resource(env, argv[3], dpiData_type, (void **)&dataRes))
@@ -323,6 +652,8 @@ DPI_NIF_FUN(stmt_bindByPos)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
     if (!enif_get_uint(env, argv[1], &pos))
         BADARG_EXCEPTION(1, "uint pos");
     if (!enif_get_resource(env, argv[2], dpiVar_type, (void **)&varRes))
@@ -331,6 +662,8 @@ DPI_NIF_FUN(stmt_bindByPos)
     RAISE_EXCEPTION_ON_DPI_ERROR(
         stmtRes->context,
         dpiStmt_bindByPos(stmtRes->stmt, pos, varRes->var));
+    if (!stmt_useVar(stmtRes, varRes))
+        RAISE_EXCEPTION(ATOM_ENOMEM);
 
     RETURNED_TRACE;
     return ATOM_OK;
@@ -346,6 +679,8 @@ DPI_NIF_FUN(stmt_bindByName)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
     if (!enif_inspect_binary(env, argv[1], &binary))
         BADARG_EXCEPTION(1, "string/list name");
     if (!enif_get_resource(env, argv[2], dpiVar_type, (void **)&varRes))
@@ -356,6 +691,8 @@ DPI_NIF_FUN(stmt_bindByName)
         dpiStmt_bindByName(
             stmtRes->stmt, (const char *)binary.data, binary.size,
             varRes->var));
+    if (!stmt_useVar(stmtRes, varRes))
+        RAISE_EXCEPTION(ATOM_ENOMEM);
 
     RETURNED_TRACE;
     return ATOM_OK;
@@ -370,13 +707,19 @@ DPI_NIF_FUN(stmt_close)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
     if (!enif_inspect_binary(env, argv[1], &tag))
         BADARG_EXCEPTION(1, "string tag");
 
+    dpiStmt_res_stopStream(stmtRes);
+    dpiStmt_res_stopPrefetch(stmtRes);
+
     RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
         stmtRes->context,
         dpiStmt_close(stmtRes->stmt, (const char *)tag.data, tag.size),
         stmtRes, dpiStmt);
+    // the variables are unbound now, pooling them is safe again
+    stmt_releaseVars(stmtRes);
 
     RELEASE_RESOURCE(stmtRes, dpiStmt);
 
@@ -393,34 +736,13 @@ DPI_NIF_FUN(stmt_getInfo)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
 
     RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
         stmtRes->context, dpiStmt_getInfo(stmtRes->stmt, &info),
         stmtRes, dpiStmt);
 
-    ERL_NIF_TERM map = enif_make_new_map(env);
-
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "isDDL"),
-        info.isDDL ? ATOM_TRUE : ATOM_FALSE,
-        &map);
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "isDML"),
-        info.isDML ? ATOM_TRUE : ATOM_FALSE,
-        &map);
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "isPLSQL"),
-        info.isPLSQL ? ATOM_TRUE : ATOM_FALSE,
-        &map);
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "isQuery"),
-        info.isQuery ? ATOM_TRUE : ATOM_FALSE,
-        &map);
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "isReturning"),
-        info.isReturning ? ATOM_TRUE : ATOM_FALSE,
-        &map);
-
     ERL_NIF_TERM type;
 
     switch (info.statementType)
@@ -471,8 +793,17 @@ DPI_NIF_FUN(stmt_getInfo)
         type = enif_make_atom(env, "DPI_STMT_TYPE_ROLLBACK");
         break;
     }
-    enif_make_map_put(
-        env, map, enif_make_atom(env, "statementType"), type, &map);
+
+    ERL_NIF_TERM keys[] = {
+        ATOM_isDDL, ATOM_isDML, ATOM_isPLSQL, ATOM_isQuery, ATOM_isReturning,
+        ATOM_statementType};
+    ERL_NIF_TERM values[] = {
+        info.isDDL ? ATOM_TRUE : ATOM_FALSE,
+        info.isDML ? ATOM_TRUE : ATOM_FALSE,
+        info.isPLSQL ? ATOM_TRUE : ATOM_FALSE,
+        info.isQuery ? ATOM_TRUE : ATOM_FALSE,
+        info.isReturning ? ATOM_TRUE : ATOM_FALSE, type};
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
 
     // #{ isDDL => atom, isDML => atom, isPLSQL => atom, isQuery => atom,
     //    isReturning => atom, statementType => atom }
@@ -490,6 +821,9 @@ DPI_NIF_FUN(stmt_define)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    CHECK_STMT_NOT_PREFETCHED(stmtRes);
     if (!enif_get_uint(env, argv[1], &pos))
         BADARG_EXCEPTION(1, "uint pos");
     if (!enif_get_resource(env, argv[2], dpiVar_type, (void **)&varRes))
@@ -498,6 +832,10 @@ DPI_NIF_FUN(stmt_define)
     RAISE_EXCEPTION_ON_DPI_ERROR(
         stmtRes->context,
         dpiStmt_define(stmtRes->stmt, pos, varRes->var));
+    if (!stmt_useVar(stmtRes, varRes))
+        RAISE_EXCEPTION(ATOM_ENOMEM);
+
+    stmt_redefineDecoder(stmtRes, pos, varRes->nativeTypeNum);
 
     RETURNED_TRACE;
     return ATOM_OK;
@@ -515,6 +853,9 @@ DPI_NIF_FUN(stmt_defineValue)
 
     if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
         BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    CHECK_STMT_NOT_PREFETCHED(stmtRes);
 
     if (!enif_get_uint(env, argv[1], &pos))
         BADARG_EXCEPTION(1, "uint pos");
@@ -530,13 +871,804 @@ DPI_NIF_FUN(stmt_defineValue)
     else
         BADARG_EXCEPTION(5, "bool/atom sizeIsBytes");
 
+    // null defines a scalar column
+    dpiObjectType_res *objTypeRes = NULL;
+    if (enif_compare(argv[6], ATOM_NULL) != 0 &&
+        !enif_get_resource(
+            env, argv[6], dpiObjectType_type, (void **)&objTypeRes))
+        BADARG_EXCEPTION(6, "resource objectType or null");
+
     RAISE_EXCEPTION_ON_DPI_ERROR(
         stmtRes->context,
         dpiStmt_defineValue(
             stmtRes->stmt, pos, oraType, nativeType, size, sizeIsBytes,
-            NULL // TODO: support dpiObjectType
-            ));
+            objTypeRes ? objTypeRes->objType : NULL));
+
+    stmt_redefineDecoder(stmtRes, pos, nativeType);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(stmt_defineDecimal)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiStmt_res *stmtRes;
+    uint32_t pos = 0, numCols = 0;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    CHECK_STMT_NOT_PREFETCHED(stmtRes);
+    if (!enif_get_uint(env, argv[1], &pos))
+        BADARG_EXCEPTION(1, "uint pos");
+
+    // the NUMBER column is fetched as text and parsed by the decimal decoder
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        stmtRes->context,
+        dpiStmt_defineValue(
+            stmtRes->stmt, pos, DPI_ORACLE_TYPE_NUMBER, DPI_NATIVE_TYPE_BYTES,
+            0, 0, NULL));
+
+    if (!stmtRes->decoders)
+    {
+        RAISE_EXCEPTION_ON_DPI_ERROR(
+            stmtRes->context,
+            dpiStmt_getNumQueryColumns(stmtRes->stmt, &numCols));
+        RAISE_EXCEPTION_ON_DPI_ERROR(
+            stmtRes->context, stmt_buildDecoders(stmtRes, numCols));
+    }
+    stmtRes->decoders[pos - 1] = dpiData_getDecimalDecoder(1);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(stmt_setCharsetMode)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiStmt_res *stmtRes;
+    int charsetMode = DPI_CHARSET_NONE;
+    dpiQueryInfo queryInfo;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    CHECK_STMT_NOT_PREFETCHED(stmtRes);
+    DPI_CHARSET_MODE_FROM_ATOM(argv[1], charsetMode);
+
+    // string columns of an executed query switch decoder right away, unless
+    // they were redefined with another native type
+    for (uint32_t c = 0; c < stmtRes->numCols; c++)
+    {
+        RAISE_EXCEPTION_ON_DPI_ERROR(
+            stmtRes->context,
+            dpiStmt_getQueryInfo(stmtRes->stmt, c + 1, &queryInfo));
+        if (!stmt_isStringColumn(&queryInfo))
+            continue;
+
+        dpiDataDecoder plain = dpiData_getDecoder(DPI_NATIVE_TYPE_BYTES, 1);
+        if (stmtRes->decoders[c] != plain &&
+            stmtRes->decoders[c] !=
+                dpiData_getCharsetDecoder(stmtRes->charsetMode, 1))
+            continue;
+
+        dpiDataDecoder decoder = dpiData_getCharsetDecoder(charsetMode, 1);
+        stmtRes->decoders[c] = decoder ? decoder : plain;
+    }
+    stmtRes->charsetMode = charsetMode;
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(stmt_scroll)
+{
+    CHECK_ARGCOUNT(4);
+
+    dpiStmt_res *stmtRes = NULL;
+    dpiFetchMode mode = DPI_MODE_FETCH_NEXT;
+    int offset = 0, rowCountOffset = 0;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    CHECK_STMT_NOT_PREFETCHED(stmtRes);
+    DPI_FETCH_MODE_FROM_ATOM(argv[1], mode);
+    if (!enif_get_int(env, argv[2], &offset))
+        BADARG_EXCEPTION(2, "int offset");
+    if (!enif_get_int(env, argv[3], &rowCountOffset))
+        BADARG_EXCEPTION(3, "int rowCountOffset");
+
+    // the next fetch (stmt_fetch or stmt_fetchRows) returns the row at the
+    // scrolled to position
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        stmtRes->context,
+        dpiStmt_scroll(stmtRes->stmt, mode, offset, rowCountOffset));
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(stmt_getRowCount)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiStmt_res *stmtRes = NULL;
+    uint64_t count;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        stmtRes->context, dpiStmt_getRowCount(stmtRes->stmt, &count));
+
+    RETURNED_TRACE;
+    return enif_make_uint64(env, count);
+}
+
+DPI_NIF_FUN(stmt_getImplicitResult)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiStmt_res *stmtRes = NULL;
+    dpiStmt *implicitResult = NULL;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        stmtRes->context,
+        dpiStmt_getImplicitResult(stmtRes->stmt, &implicitResult));
+
+    // no more implicit results
+    if (!implicitResult)
+    {
+        RETURNED_TRACE;
+        return ATOM_NULL;
+    }
+
+    dpiStmt_res *resultRes;
+    ALLOC_RESOURCE(resultRes, dpiStmt);
+    dpiStmt_res_init(resultRes, stmtRes->context);
+    dpiStmt_res_attach(resultRes, stmtRes->connRes);
+    resultRes->stmt = implicitResult;
+
+    ERL_NIF_TERM resultResTerm = enif_make_resource(env, resultRes);
+
+    RETURNED_TRACE;
+    return resultResTerm;
+}
+
+DPI_NIF_FUN(stmt_getFetchArraySize)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiStmt_res *stmtRes = NULL;
+    uint32_t arraySize;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        stmtRes->context,
+        dpiStmt_getFetchArraySize(stmtRes->stmt, &arraySize));
+
+    RETURNED_TRACE;
+    return enif_make_uint(env, arraySize);
+}
+
+DPI_NIF_FUN(stmt_setFetchArraySize)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiStmt_res *stmtRes = NULL;
+    uint32_t arraySize;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    if (!enif_get_uint(env, argv[1], &arraySize))
+        BADARG_EXCEPTION(1, "uint arraySize");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        stmtRes->context,
+        dpiStmt_setFetchArraySize(stmtRes->stmt, arraySize));
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(stmt_getRowCounts)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiStmt_res *stmtRes = NULL;
+    uint32_t numRowCounts;
+    uint64_t *rowCounts;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+
+    // only available after executeMany with DPI_MODE_EXEC_ARRAY_DML_ROWCOUNTS
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        stmtRes->context,
+        dpiStmt_getRowCounts(stmtRes->stmt, &numRowCounts, &rowCounts));
+
+    ERL_NIF_TERM list = enif_make_list(env, 0);
+    for (int i = numRowCounts - 1; i >= 0; i--)
+        list = enif_make_list_cell(
+            env, enif_make_uint64(env, rowCounts[i]), list);
+
+    // [integer]
+    RETURNED_TRACE;
+    return list;
+}
+
+DPI_NIF_FUN(stmt_getBatchErrors)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiStmt_res *stmtRes = NULL;
+    uint32_t numErrors;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+
+    // only available after executeMany with DPI_MODE_EXEC_BATCH_ERRORS
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        stmtRes->context,
+        dpiStmt_getBatchErrorCount(stmtRes->stmt, &numErrors));
+
+    ERL_NIF_TERM list = enif_make_list(env, 0);
+    if (numErrors == 0)
+    {
+        RETURNED_TRACE;
+        return list;
+    }
+
+    dpiErrorInfo *errors = enif_alloc(numErrors * sizeof(dpiErrorInfo));
+    if (DPI_FAILURE ==
+        dpiStmt_getBatchErrors(stmtRes->stmt, numErrors, errors))
+    {
+        enif_free(errors);
+        RAISE_EXCEPTION_ON_DPI_ERROR(stmtRes->context, DPI_FAILURE);
+    }
+
+    // offset of each error is the index of the failed row
+    for (int i = numErrors - 1; i >= 0; i--)
+        list = enif_make_list_cell(
+            env, dpiErrorInfoMap(env, errors[i]), list);
+    enif_free(errors);
+
+    // [#{code => integer(), offset => integer(), message => string(), ...}]
+    RETURNED_TRACE;
+    return list;
+}
+
+/*******************************************************************************
+ * Streaming
+ * a native thread fetches batches of rows and sends them to the owner process
+ * as {dpi_stream, Ref, Rows}, followed by {dpi_stream_done, Ref} or
+ * {dpi_stream_error, Ref, ErrorMap}. Every batch consumes one credit, the
+ * thread ends when it ran out of credits and stmt_streamAck starts the next
+ * one. A running thread keeps the statement resource. The stream ends once
+ * all rows were sent, on error, when the owner is gone or when it is stopped,
+ * until then the other statement NIFs are refused
+ ******************************************************************************/
+
+static void stmt_freeStream(dpiStream *stream)
+{
+    enif_free_env(stream->msgEnv);
+    enif_free_env(stream->refEnv);
+    enif_free(stream);
+}
+
+static void *stmt_streamThread(void *arg)
+{
+    dpiStmt_res *stmtRes = (dpiStmt_res *)arg;
+    dpiStream *stream = stmtRes->stream;
+    ErlNifEnv *msgEnv = stream->msgEnv;
+    ERL_NIF_TERM rows, ref;
+    int moreRows = 1, done = 0;
+
+    enif_mutex_lock(stmtRes->lock);
+    while (!done && !stream->stop && stream->credits > 0)
+    {
+        stream->credits--;
+        enif_mutex_unlock(stmtRes->lock);
+
+        ref = enif_make_copy(msgEnv, stream->ref);
+        if (DPI_FAILURE ==
+            dpiStmt_res_fetchRows(
+                msgEnv, stmtRes, stream->batchRows, &rows, &moreRows))
+        {
+            dpiErrorInfo err;
+            dpiContext_getError(stmtRes->context, &err);
+            enif_send(
+                NULL, &stream->owner, msgEnv,
+                enif_make_tuple3(
+                    msgEnv, enif_make_atom(msgEnv, "dpi_stream_error"), ref,
+                    dpiErrorInfoMap(msgEnv, err)));
+            enif_clear_env(msgEnv);
+            done = 1;
+        }
+        else
+        {
+            // a failed send means that the owner is gone
+            if (!enif_is_empty_list(msgEnv, rows) &&
+                !enif_send(
+                    NULL, &stream->owner, msgEnv,
+                    enif_make_tuple3(
+                        msgEnv, enif_make_atom(msgEnv, "dpi_stream"), ref,
+                        rows)))
+                done = 1;
+            enif_clear_env(msgEnv);
+
+            if (!done && !moreRows)
+            {
+                ref = enif_make_copy(msgEnv, stream->ref);
+                enif_send(
+                    NULL, &stream->owner, msgEnv,
+                    enif_make_tuple2(
+                        msgEnv, enif_make_atom(msgEnv, "dpi_stream_done"),
+                        ref));
+                enif_clear_env(msgEnv);
+                done = 1;
+            }
+        }
+
+        enif_mutex_lock(stmtRes->lock);
+    }
+    stream->running = 0;
+    if (done || stream->stop)
+        stmtRes->stream = NULL;
+    else
+        stream = NULL; // kept for the credits of stmt_streamAck
+    enif_cond_broadcast(stmtRes->cond);
+    enif_mutex_unlock(stmtRes->lock);
+
+    if (stream)
+        stmt_freeStream(stream);
+    oranif_threadExit();
+    enif_release_resource(stmtRes);
+
+    return NULL;
+}
+
+// starts a thread fetching while there are credits, stmtRes->lock is held
+static int stmt_runStream(dpiStmt_res *stmtRes)
+{
+    stmtRes->stream->running = 1;
+    enif_keep_resource(stmtRes);
+    if (oranif_threadCreate("oranif_stream", stmt_streamThread, stmtRes))
+        return 1;
+
+    stmtRes->stream->running = 0;
+    enif_release_resource(stmtRes);
+    return 0;
+}
+
+int dpiStmt_res_isStreaming(dpiStmt_res *stmtRes)
+{
+    int streaming;
+
+    if (!stmtRes->lock)
+        return 0;
+    enif_mutex_lock(stmtRes->lock);
+    streaming = stmtRes->stream != NULL;
+    enif_mutex_unlock(stmtRes->lock);
+
+    return streaming;
+}
+
+// stops the stream of the statement (if any), waits for a running thread
+void dpiStmt_res_stopStream(dpiStmt_res *stmtRes)
+{
+    dpiStream *stream = NULL;
+
+    if (!stmtRes->lock)
+        return;
+    enif_mutex_lock(stmtRes->lock);
+    if (stmtRes->stream && stmtRes->stream->running)
+    {
+        stmtRes->stream->stop = 1;
+        while (stmtRes->stream)
+            enif_cond_wait(stmtRes->cond, stmtRes->lock);
+    }
+    stream = stmtRes->stream;
+    stmtRes->stream = NULL;
+    enif_mutex_unlock(stmtRes->lock);
+
+    if (stream)
+        stmt_freeStream(stream);
+}
+
+DPI_NIF_FUN(stmt_stream)
+{
+    CHECK_ARGCOUNT(4);
+
+    dpiStmt_res *stmtRes = NULL;
+    ErlNifPid owner;
+    uint32_t batchRows, credits;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_PREFETCHED(stmtRes);
+    if (!enif_get_local_pid(env, argv[1], &owner))
+        BADARG_EXCEPTION(1, "local pid owner");
+    if (!enif_get_uint(env, argv[2], &batchRows) || batchRows == 0)
+        BADARG_EXCEPTION(2, "uint batchRows");
+    if (!enif_get_uint(env, argv[3], &credits))
+        BADARG_EXCEPTION(3, "uint credits");
+    if (!stmtRes->lock)
+        RAISE_STR_EXCEPTION("statement can't stream");
+
+    // a previous stream is stopped, the new one continues with the next row
+    dpiStmt_res_stopStream(stmtRes);
+    RAISE_EXCEPTION_ON_DECODERS(stmtRes);
+
+    dpiStream *stream = enif_alloc(sizeof(dpiStream));
+    stream->owner = owner;
+    stream->batchRows = batchRows;
+    stream->credits = credits;
+    stream->running = 0;
+    stream->stop = 0;
+    stream->msgEnv = enif_alloc_env();
+    stream->refEnv = enif_alloc_env();
+    stream->ref = enif_make_ref(stream->refEnv);
+    // copied before the thread may end the stream
+    ERL_NIF_TERM ref = enif_make_copy(env, stream->ref);
+
+    enif_mutex_lock(stmtRes->lock);
+    stmtRes->stream = stream;
+    if (credits > 0 && !stmt_runStream(stmtRes))
+    {
+        stmtRes->stream = NULL;
+        enif_mutex_unlock(stmtRes->lock);
+        stmt_freeStream(stream);
+        RAISE_STR_EXCEPTION("failed to create stream thread");
+    }
+    enif_mutex_unlock(stmtRes->lock);
+
+    RETURNED_TRACE;
+    return ref;
+}
+
+DPI_NIF_FUN(stmt_streamAck)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiStmt_res *stmtRes = NULL;
+    uint32_t credits;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    if (!enif_get_uint(env, argv[1], &credits))
+        BADARG_EXCEPTION(1, "uint credits");
+    if (!stmtRes->lock)
+        RAISE_STR_EXCEPTION("statement is not streaming");
+
+    enif_mutex_lock(stmtRes->lock);
+    dpiStream *stream = stmtRes->stream;
+    if (!stream)
+    {
+        enif_mutex_unlock(stmtRes->lock);
+        RAISE_STR_EXCEPTION("statement is not streaming");
+    }
+    // a running thread goes on with the added credits
+    stream->credits += credits;
+    if (!stream->running && stream->credits > 0 && !stmt_runStream(stmtRes))
+    {
+        enif_mutex_unlock(stmtRes->lock);
+        RAISE_STR_EXCEPTION("failed to create stream thread");
+    }
+    enif_mutex_unlock(stmtRes->lock);
 
     RETURNED_TRACE;
     return ATOM_OK;
 }
+
+DPI_NIF_FUN(stmt_streamStop)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiStmt_res *stmtRes = NULL;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+
+    dpiStmt_res_stopStream(stmtRes);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+/*******************************************************************************
+ * Prefetch
+ * with prefetch enabled, stmt_fetchRows hands the request for the next batch
+ * to a native thread before returning, so that the round trip for batch K+1
+ * overlaps with the caller processing batch K. The next stmt_fetchRows only
+ * waits if that batch isn't complete yet. Batches keep the size of the call
+ * which requested them. A prefetched batch is only dropped by executing the
+ * statement again or closing it, disabling prefetch leaves it to the next
+ * stmt_fetchRows. NIFs which move or decode the cursor otherwise raise while
+ * a batch is pending, so prefetching is meant for forward scans. A thread
+ * runs per requested batch and keeps the statement resource
+ ******************************************************************************/
+
+static void stmt_freePrefetch(dpiPrefetch *prefetch)
+{
+    enif_free_env(prefetch->env);
+    enif_free(prefetch);
+}
+
+static void *stmt_prefetchThread(void *arg)
+{
+    dpiStmt_res *stmtRes = (dpiStmt_res *)arg;
+    dpiPrefetch *prefetch = stmtRes->prefetch;
+
+    // the batch is left alone by the NIFs while busy is set
+    enif_clear_env(prefetch->env);
+    prefetch->result = dpiStmt_res_fetchRows(
+        prefetch->env, stmtRes, prefetch->maxRows, &prefetch->rows,
+        &prefetch->moreRows);
+    if (DPI_FAILURE == prefetch->result)
+    {
+        // the error info is thread local, so it is converted here
+        dpiErrorInfo err;
+        dpiContext_getError(stmtRes->context, &err);
+        prefetch->rows = dpiErrorInfoMap(prefetch->env, err);
+    }
+
+    enif_mutex_lock(stmtRes->lock);
+    prefetch->busy = 0;
+    enif_cond_broadcast(stmtRes->cond);
+    enif_mutex_unlock(stmtRes->lock);
+
+    oranif_threadExit();
+    enif_release_resource(stmtRes);
+
+    return NULL;
+}
+
+int dpiStmt_res_hasPrefetched(dpiStmt_res *stmtRes)
+{
+    int pending;
+
+    if (!stmtRes->prefetch)
+        return 0;
+    enif_mutex_lock(stmtRes->lock);
+    pending = stmtRes->prefetch->pending;
+    enif_mutex_unlock(stmtRes->lock);
+
+    return pending;
+}
+
+// waits for the batch being fetched by a thread (if any)
+static void stmt_waitPrefetch(dpiStmt_res *stmtRes)
+{
+    enif_mutex_lock(stmtRes->lock);
+    while (stmtRes->prefetch->busy)
+        enif_cond_wait(stmtRes->cond, stmtRes->lock);
+    enif_mutex_unlock(stmtRes->lock);
+}
+
+// drops a prefetched batch, it is stale once the statement is executed again
+void dpiStmt_res_discardPrefetch(dpiStmt_res *stmtRes)
+{
+    if (!stmtRes->prefetch)
+        return;
+
+    stmt_waitPrefetch(stmtRes);
+    stmtRes->prefetch->pending = 0;
+}
+
+/*
+ * switches a REF CURSOR statement to a newly opened cursor without waiting,
+ * returns the error if a thread still fetches from the previous one
+ */
+const char *dpiStmt_res_swapCursor(dpiStmt_res *stmtRes, dpiStmt *stmt)
+{
+    const char *error = NULL;
+
+    enif_mutex_lock(stmtRes->lock);
+    if (stmtRes->stream)
+        error = "statement is streaming";
+    else if (stmtRes->prefetch && stmtRes->prefetch->busy)
+        error = "prefetch in progress";
+    else if (stmtRes->prefetch)
+        stmtRes->prefetch->pending = 0;
+    enif_mutex_unlock(stmtRes->lock);
+    if (error)
+        return error;
+
+    // the row decoder is rebuilt by the first stmt_fetchRows
+    dpiStmt_res_freeDecoders(stmtRes);
+    stmtRes->stmt = stmt;
+    return NULL;
+}
+
+/*
+ * returns the prefetched batch (or fetches one if none was requested) and
+ * requests the next one while enabled, on failure rows is the error map
+ */
+static int stmt_fetchPrefetched(
+    ErlNifEnv *env, dpiStmt_res *stmtRes, uint32_t maxRows,
+    ERL_NIF_TERM *rows, int *moreRows)
+{
+    dpiPrefetch *prefetch = stmtRes->prefetch;
+
+    if (prefetch->pending)
+    {
+        stmt_waitPrefetch(stmtRes);
+        prefetch->pending = 0;
+        *rows = enif_make_copy(env, prefetch->rows);
+        *moreRows = prefetch->moreRows;
+        if (DPI_FAILURE == prefetch->result)
+            return DPI_FAILURE;
+    }
+    else if (DPI_FAILURE ==
+             dpiStmt_res_fetchRows(env, stmtRes, maxRows, rows, moreRows))
+    {
+        dpiErrorInfo err;
+        dpiContext_getError(stmtRes->context, &err);
+        *rows = dpiErrorInfoMap(env, err);
+        return DPI_FAILURE;
+    }
+
+    if (prefetch->enabled && *moreRows && maxRows > 0)
+    {
+        prefetch->maxRows = maxRows;
+        prefetch->pending = 1;
+        prefetch->busy = 1;
+        enif_keep_resource(stmtRes);
+        if (!oranif_threadCreate(
+                "oranif_prefetch", stmt_prefetchThread, stmtRes))
+        {
+            // the next call fetches the batch itself
+            prefetch->pending = 0;
+            prefetch->busy = 0;
+            enif_release_resource(stmtRes);
+        }
+    }
+
+    return DPI_SUCCESS;
+}
+
+// drops the prefetch state of the statement (if any) before it is closed
+void dpiStmt_res_stopPrefetch(dpiStmt_res *stmtRes)
+{
+    dpiPrefetch *prefetch = stmtRes->prefetch;
+    if (!prefetch)
+        return;
+
+    stmt_waitPrefetch(stmtRes);
+    stmtRes->prefetch = NULL;
+    stmt_freePrefetch(prefetch);
+}
+
+DPI_NIF_FUN(stmt_setPrefetch)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiStmt_res *stmtRes = NULL;
+    int enable = 0;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    CHECK_STMT_OWNER(stmtRes);
+    CHECK_STMT_NOT_STREAMING(stmtRes);
+    if (enif_compare(argv[1], ATOM_TRUE) == 0)
+        enable = 1;
+    else if (enif_compare(argv[1], ATOM_FALSE) == 0)
+        enable = 0;
+    else
+        BADARG_EXCEPTION(1, "bool/atom enable");
+
+    // a batch already prefetched is still returned by stmt_fetchRows
+    if (stmtRes->prefetch)
+    {
+        stmtRes->prefetch->enabled = enable;
+
+        RETURNED_TRACE;
+        return ATOM_OK;
+    }
+    if (!enable)
+    {
+        RETURNED_TRACE;
+        return ATOM_OK;
+    }
+    if (!stmtRes->lock)
+        RAISE_STR_EXCEPTION("statement can't prefetch");
+
+    dpiPrefetch *prefetch = enif_alloc(sizeof(dpiPrefetch));
+    prefetch->env = enif_alloc_env();
+    prefetch->enabled = 1;
+    prefetch->pending = 0;
+    prefetch->busy = 0;
+    stmtRes->prefetch = prefetch;
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(stmt_setOwner)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiStmt_res *stmtRes = NULL;
+    ErlNifPid owner;
+    int owned = 1;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+    if (enif_compare(argv[1], ATOM_NULL) == 0)
+        owned = 0;
+    else if (!enif_get_local_pid(env, argv[1], &owner))
+        BADARG_EXCEPTION(1, "pid or atom null owner");
+    if (!stmtRes->ownable)
+        RAISE_STR_EXCEPTION("statement can't be owned");
+
+    // one process at a time changes the owner, a concurrent one fails
+    int32_t state = oranif_atomicAdd(&stmtRes->ownerState, 0);
+    if (state == STMT_OWNER_CHANGING ||
+        !oranif_atomicCas(&stmtRes->ownerState, state, STMT_OWNER_CHANGING))
+        RAISE_STR_EXCEPTION("statement is owned by another process");
+    // only the owner hands the statement over, unless it has died
+    if (state == STMT_OWNER_SET && !stmt_isSelf(env, &stmtRes->owner)
+#if ERL_NIF_MAJOR_VERSION > 2 || \
+    (ERL_NIF_MAJOR_VERSION == 2 && ERL_NIF_MINOR_VERSION >= 12)
+        && enif_is_process_alive(env, &stmtRes->owner)
+#endif
+    )
+    {
+        oranif_atomicCas(&stmtRes->ownerState, STMT_OWNER_CHANGING, state);
+        RAISE_STR_EXCEPTION("statement is owned by another process");
+    }
+    if (owned)
+        stmtRes->owner = owner;
+    oranif_atomicCas(
+        &stmtRes->ownerState, STMT_OWNER_CHANGING,
+        owned ? STMT_OWNER_SET : STMT_OWNER_NONE);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+DPI_NIF_FUN(stmt_getOwner)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiStmt_res *stmtRes = NULL;
+    ERL_NIF_TERM owner = ATOM_NULL;
+
+    if (!enif_get_resource(env, argv[0], dpiStmt_type, (void **)&stmtRes))
+        BADARG_EXCEPTION(0, "resource statement");
+
+    if (oranif_atomicAdd(&stmtRes->ownerState, 0) == STMT_OWNER_SET)
+        owner = enif_make_pid(env, &stmtRes->owner);
+
+    // pid | null
+    RETURNED_TRACE;
+    return owner;
+}
@@ -3,16 +3,105 @@
 
 #include "dpi_nif.h"
 #include "dpi.h"
+#include "dpiData_nif.h"
+#include "dpiConn_nif.h"
+
+/*
+ * state of a statement streaming its rows to an Erlang process, a thread
+ * runs while there are credits, guarded by the lock of the statement
+ */
+typedef struct
+{
+    ErlNifPid owner;
+    ErlNifEnv *msgEnv;
+    ErlNifEnv *refEnv;
+    ERL_NIF_TERM ref;
+    uint32_t batchRows;
+    uint32_t credits;
+    int running; // a thread is fetching, it keeps the statement resource
+    int stop;
+} dpiStream;
+
+/*
+ * state of a statement fetching the next batch of rows in the background,
+ * a thread runs per requested batch, guarded by the lock of the statement
+ */
+typedef struct
+{
+    ErlNifEnv *env;
+    ERL_NIF_TERM rows;  // rows or error map of the fetched batch
+    int result;         // DPI_SUCCESS or DPI_FAILURE of the fetched batch
+    int moreRows;
+    uint32_t maxRows;
+    int enabled;        // stmt_fetchRows requests the next batch
+    int pending;        // a batch was requested and not yet taken
+    int busy;           // a thread is fetching, it keeps the statement resource
+} dpiPrefetch;
 
 typedef struct
 {
     dpiStmt *stmt;
     dpiContext *context;
+    // row decoder, one decoder per query column, built after execute
+    uint32_t numCols;
+    dpiDataDecoder *decoders;
+    ERL_NIF_TERM *row;
+    int charsetMode; // DPI_CHARSET_*, applied to VARCHAR/CHAR/LONG columns
+    ErlNifMutex *lock; // guards stream and prefetch, NULL unless a resource
+    ErlNifCond *cond;  // signalled when a stream or prefetch thread is done
+    dpiStream *stream;
+    dpiPrefetch *prefetch;
+    dpiConn_res *connRes; // kept while the statement resource exists
+    int ownable; // statement resources only, see stmt_setOwner
+    volatile int32_t ownerState; // STMT_OWNER_*, read without a lock
+    ErlNifPid owner; // only owner may use the statement if set
+    void **vars; // poolable dpiVar_res bound or defined, kept until close
+    uint32_t numVars;
 } dpiStmt_res;
 
+// ownerState of a statement, changing while stmt_setOwner stores the owner
+#define STMT_OWNER_NONE 0
+#define STMT_OWNER_SET 1
+#define STMT_OWNER_CHANGING 2
+
+// raises unless the calling process may use the statement
+#define CHECK_STMT_OWNER(_stmtRes)         \
+    if (!dpiStmt_res_isOwner(env, _stmtRes)) \
+    RAISE_STR_EXCEPTION("statement is owned by another process")
+
+// raises while a stream fetches the rows of the statement
+#define CHECK_STMT_NOT_STREAMING(_stmtRes)  \
+    if (dpiStmt_res_isStreaming(_stmtRes)) \
+    RAISE_STR_EXCEPTION("statement is streaming")
+
+// raises while a prefetched batch is not yet taken by stmt_fetchRows
+#define CHECK_STMT_NOT_PREFETCHED(_stmtRes)  \
+    if (dpiStmt_res_hasPrefetched(_stmtRes)) \
+    RAISE_STR_EXCEPTION("prefetch in progress")
+
+// results of dpiStmt_res_checkDecoders
+#define STMT_DECODERS_OK 0
+#define STMT_DECODERS_DPI_ERROR 1
+#define STMT_DECODERS_NOT_QUERY 2
+#define STMT_DECODERS_UNSUPPORTED 3
+
 extern ErlNifResourceType *dpiStmt_type;
 
 extern void dpiStmt_res_dtor(ErlNifEnv *env, void *resource);
+extern void dpiStmt_res_init(dpiStmt_res *stmtRes, dpiContext *context);
+extern void dpiStmt_res_attach(dpiStmt_res *stmtRes, dpiConn_res *connRes);
+extern int dpiStmt_res_isOwner(ErlNifEnv *env, dpiStmt_res *stmtRes);
+extern int dpiStmt_res_isStreaming(dpiStmt_res *stmtRes);
+extern int dpiStmt_res_hasPrefetched(dpiStmt_res *stmtRes);
+extern void dpiStmt_res_freeDecoders(dpiStmt_res *stmtRes);
+extern int dpiStmt_res_checkDecoders(dpiStmt_res *stmtRes);
+extern int dpiStmt_res_fetchRows(
+    ErlNifEnv *env, dpiStmt_res *stmtRes, uint32_t maxRows,
+    ERL_NIF_TERM *rows, int *moreRows);
+extern void dpiStmt_res_stopStream(dpiStmt_res *stmtRes);
+extern void dpiStmt_res_stopPrefetch(dpiStmt_res *stmtRes);
+extern void dpiStmt_res_discardPrefetch(dpiStmt_res *stmtRes);
+extern const char *dpiStmt_res_swapCursor(dpiStmt_res *stmtRes, dpiStmt *stmt);
 
 extern DPI_NIF_FUN(stmt_bindByName);
 extern DPI_NIF_FUN(stmt_bindByPos);
@@ -20,14 +109,30 @@ extern DPI_NIF_FUN(stmt_bindValueByName);
 extern DPI_NIF_FUN(stmt_bindValueByPos);
 extern DPI_NIF_FUN(stmt_define);
 extern DPI_NIF_FUN(stmt_defineValue);
+extern DPI_NIF_FUN(stmt_defineDecimal);
 extern DPI_NIF_FUN(stmt_execute);
 extern DPI_NIF_FUN(stmt_executeMany);
 extern DPI_NIF_FUN(stmt_fetch);
+extern DPI_NIF_FUN(stmt_fetchRows);
 extern DPI_NIF_FUN(stmt_getQueryInfo);
 extern DPI_NIF_FUN(stmt_getQueryValue);
 extern DPI_NIF_FUN(stmt_getNumQueryColumns);
 extern DPI_NIF_FUN(stmt_close);
 extern DPI_NIF_FUN(stmt_getInfo);
+extern DPI_NIF_FUN(stmt_scroll);
+extern DPI_NIF_FUN(stmt_getRowCount);
+extern DPI_NIF_FUN(stmt_getImplicitResult);
+extern DPI_NIF_FUN(stmt_getFetchArraySize);
+extern DPI_NIF_FUN(stmt_setFetchArraySize);
+extern DPI_NIF_FUN(stmt_getRowCounts);
+extern DPI_NIF_FUN(stmt_getBatchErrors);
+extern DPI_NIF_FUN(stmt_stream);
+extern DPI_NIF_FUN(stmt_streamAck);
+extern DPI_NIF_FUN(stmt_streamStop);
+extern DPI_NIF_FUN(stmt_setPrefetch);
+extern DPI_NIF_FUN(stmt_setCharsetMode);
+extern DPI_NIF_FUN(stmt_setOwner);
+extern DPI_NIF_FUN(stmt_getOwner);
 
 #define DPISTMT_NIFS                         \
     IOB_NIF(stmt_bindByName, 3),             \
@@ -36,14 +141,30 @@ extern DPI_NIF_FUN(stmt_getInfo);
         IOB_NIF(stmt_bindValueByPos, 4),     \
         IOB_NIF(stmt_define, 3),             \
         IOB_NIF(stmt_defineValue, 7),        \
+        IOB_NIF(stmt_defineDecimal, 2),      \
         IOB_NIF(stmt_execute, 2),            \
         IOB_NIF(stmt_executeMany, 3),        \
         IOB_NIF(stmt_fetch, 1),              \
+        IOB_NIF(stmt_fetchRows, 2),          \
         IOB_NIF(stmt_getQueryInfo, 2),       \
         IOB_NIF(stmt_getQueryValue, 2),      \
         IOB_NIF(stmt_getNumQueryColumns, 1), \
-        DEF_NIF(stmt_close, 2),              \
-        IOB_NIF(stmt_getInfo, 1)
+        IOB_NIF(stmt_close, 2),              \
+        IOB_NIF(stmt_getInfo, 1),            \
+        IOB_NIF(stmt_scroll, 4),             \
+        IOB_NIF(stmt_getRowCount, 1),        \
+        IOB_NIF(stmt_getImplicitResult, 1),  \
+        DEF_NIF(stmt_getFetchArraySize, 1),  \
+        DEF_NIF(stmt_setFetchArraySize, 2),  \
+        DEF_NIF(stmt_getRowCounts, 1),       \
+        DEF_NIF(stmt_getBatchErrors, 1),     \
+        IOB_NIF(stmt_stream, 4),             \
+        DEF_NIF(stmt_streamAck, 2),          \
+        IOB_NIF(stmt_streamStop, 1),         \
+        IOB_NIF(stmt_setPrefetch, 2),        \
+        IOB_NIF(stmt_setCharsetMode, 2),     \
+        DEF_NIF(stmt_setOwner, 2),           \
+        DEF_NIF(stmt_getOwner, 1)
 
 #define DPI_EXEC_MODE_FROM_ATOM(_atom, _assign)                  \
     A2M(DPI_MODE_EXEC_DEFAULT, _atom, _assign);                  \
@@ -54,6 +175,37 @@ extern DPI_NIF_FUN(stmt_getInfo);
     else A2M(DPI_MODE_EXEC_ARRAY_DML_ROWCOUNTS, _atom, _assign); \
     else BADARG_EXCEPTION(1, "DPI_MODE atom")
 
+#define DPI_FETCH_MODE_FROM_ATOM(_atom, _assign)          \
+    A2M(DPI_MODE_FETCH_NEXT, _atom, _assign);             \
+    else A2M(DPI_MODE_FETCH_FIRST, _atom, _assign);       \
+    else A2M(DPI_MODE_FETCH_LAST, _atom, _assign);        \
+    else A2M(DPI_MODE_FETCH_PRIOR, _atom, _assign);       \
+    else A2M(DPI_MODE_FETCH_ABSOLUTE, _atom, _assign);    \
+    else A2M(DPI_MODE_FETCH_RELATIVE, _atom, _assign);    \
+    else BADARG_EXCEPTION(1, "DPI_MODE_FETCH atom")
+
+#define RAISE_EXCEPTION_ON_DECODERS(_stmtRes)                   \
+    switch (dpiStmt_res_checkDecoders(_stmtRes))                \
+    {                                                           \
+    case STMT_DECODERS_DPI_ERROR:                               \
+        RAISE_EXCEPTION_ON_DPI_ERROR(                           \
+            (_stmtRes)->context, DPI_FAILURE);                  \
+        break;                                                  \
+    case STMT_DECODERS_NOT_QUERY:                               \
+        RAISE_STR_EXCEPTION("statement is not a query");        \
+        break;                                                  \
+    case STMT_DECODERS_UNSUPPORTED:                             \
+        RAISE_STR_EXCEPTION("Unsupported nativeTypeNum");       \
+        break;                                                  \
+    }
+
+#define DPI_CHARSET_MODE_FROM_ATOM(_atom, _assign)          \
+    A2M(DPI_CHARSET_NONE, _atom, _assign);                  \
+    else A2M(DPI_CHARSET_UTF8, _atom, _assign);             \
+    else A2M(DPI_CHARSET_WE8MSWIN1252, _atom, _assign);     \
+    else A2M(DPI_CHARSET_WE8ISO8859P1, _atom, _assign);     \
+    else BADARG_EXCEPTION(1, "DPI_CHARSET atom")
+
 #define DPI_CLOSE_MODE_FROM_ATOM(_atom, _assign)         \
     A2M(DPI_MODE_CONN_CLOSE_DEFAULT, _atom, _assign);    \
     else A2M(DPI_MODE_CONN_CLOSE_DROP, _atom, _assign);  \
@@ -0,0 +1,280 @@
+#include "dpiSubscr_nif.h"
+#include "dpiStmt_nif.h"
+
+#include <string.h>
+
+/*
+ * Continuous query notification
+ * conn_subscribe registers a DBCHANGE subscription with a callback, queries
+ * are added by executing statements prepared with subscr_prepareStmt. ODPI-C
+ * invokes the callback on an OCI thread, which turns the message into
+ * {dpi_subscr, Subscr, MessageMap} and sends it to the owner pid
+ */
+
+ErlNifResourceType *dpiSubscr_type;
+
+void dpiSubscr_res_dtor(ErlNifEnv *env, void *resource)
+{
+    CALL_TRACE;
+
+    dpiSubscr_res *subscrRes = (dpiSubscr_res *)resource;
+    if (subscrRes->lock)
+        enif_mutex_destroy(subscrRes->lock);
+    if (subscrRes->msgEnv)
+        enif_free_env(subscrRes->msgEnv);
+
+    RETURNED_TRACE;
+}
+
+static ERL_NIF_TERM subscr_makeBinary(
+    ErlNifEnv *env, const void *data, uint32_t length)
+{
+    ERL_NIF_TERM bin;
+
+    if (length > 0)
+        memcpy(enif_make_new_binary(env, length, &bin), data, length);
+    else
+        enif_make_new_binary(env, 0, &bin);
+
+    return bin;
+}
+
+// operation bitmask as a list of DPI_OPCODE_* atoms
+static ERL_NIF_TERM subscr_makeOperation(ErlNifEnv *env, dpiOpCode op)
+{
+    ERL_NIF_TERM list = enif_make_list(env, 0);
+
+#define OPCODE_CONS(_macro)                                      \
+    if (op & _macro)                                             \
+    list = enif_make_list_cell(env, enif_make_atom(env, #_macro), list)
+
+    OPCODE_CONS(DPI_OPCODE_UNKNOWN);
+    OPCODE_CONS(DPI_OPCODE_DROP);
+    OPCODE_CONS(DPI_OPCODE_ALTER);
+    OPCODE_CONS(DPI_OPCODE_DELETE);
+    OPCODE_CONS(DPI_OPCODE_UPDATE);
+    OPCODE_CONS(DPI_OPCODE_INSERT);
+    OPCODE_CONS(DPI_OPCODE_ALL_ROWS);
+#undef OPCODE_CONS
+
+    return list;
+}
+
+static ERL_NIF_TERM subscr_makeTables(
+    ErlNifEnv *env, dpiSubscrMessageTable *tables, uint32_t numTables)
+{
+    ERL_NIF_TERM list = enif_make_list(env, 0);
+    ERL_NIF_TERM rowKeys[] = {ATOM_operation, ATOM_rowid};
+    ERL_NIF_TERM keys[] = {ATOM_name, ATOM_operation, ATOM_rows};
+
+    for (uint32_t t = numTables; t > 0; t--)
+    {
+        dpiSubscrMessageTable *table = &tables[t - 1];
+        ERL_NIF_TERM rows = enif_make_list(env, 0);
+
+        for (uint32_t r = table->numRows; r > 0; r--)
+        {
+            ERL_NIF_TERM rowValues[] = {
+                subscr_makeOperation(env, table->rows[r - 1].operation),
+                subscr_makeBinary(
+                    env, table->rows[r - 1].rowid,
+                    table->rows[r - 1].rowidLength)};
+            rows = enif_make_list_cell(
+                env, MAKE_MAP(env, rowKeys, rowValues), rows);
+        }
+
+        ERL_NIF_TERM values[] = {
+            subscr_makeBinary(env, table->name, table->nameLength),
+            subscr_makeOperation(env, table->operation), rows};
+        list = enif_make_list_cell(env, MAKE_MAP(env, keys, values), list);
+    }
+
+    return list;
+}
+
+static ERL_NIF_TERM subscr_makeMessage(
+    ErlNifEnv *env, dpiSubscrMessage *message)
+{
+    ERL_NIF_TERM eventType, queries = enif_make_list(env, 0);
+    ERL_NIF_TERM queryKeys[] = {ATOM_id, ATOM_operation, ATOM_tables};
+
+    DPI_EVENT_TYPE_TO_ATOM(message->eventType, eventType);
+
+    for (uint32_t q = message->numQueries; q > 0; q--)
+    {
+        dpiSubscrMessageQuery *query = &message->queries[q - 1];
+        ERL_NIF_TERM queryValues[] = {
+            enif_make_uint64(env, query->id),
+            subscr_makeOperation(env, query->operation),
+            subscr_makeTables(env, query->tables, query->numTables)};
+        queries = enif_make_list_cell(
+            env, MAKE_MAP(env, queryKeys, queryValues), queries);
+    }
+
+    ERL_NIF_TERM keys[] = {
+        ATOM_dbName, ATOM_error, ATOM_eventType, ATOM_queries, ATOM_tables,
+        ATOM_txId};
+    ERL_NIF_TERM values[] = {
+        subscr_makeBinary(env, message->dbName, message->dbNameLength),
+        message->errorInfo ? dpiErrorInfoMap(env, *message->errorInfo)
+                           : ATOM_NULL,
+        eventType, queries,
+        subscr_makeTables(env, message->tables, message->numTables),
+        subscr_makeBinary(env, message->txId, message->txIdLength)};
+
+    return MAKE_MAP(env, keys, values);
+}
+
+// runs on an OCI thread, never on a scheduler
+void dpiSubscr_callback(void *context, dpiSubscrMessage *message)
+{
+    dpiSubscr_res *subscrRes = (dpiSubscr_res *)context;
+    ErlNifEnv *env = subscrRes->msgEnv;
+
+    enif_mutex_lock(subscrRes->lock);
+    if (subscrRes->active)
+    {
+        enif_send(
+            NULL, &subscrRes->owner, env,
+            enif_make_tuple3(
+                env, enif_make_atom(env, "dpi_subscr"),
+                enif_make_resource(env, subscrRes),
+                subscr_makeMessage(env, message)));
+        enif_clear_env(env);
+    }
+    enif_mutex_unlock(subscrRes->lock);
+}
+
+DPI_NIF_FUN(subscr_prepareStmt)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiSubscr_res *subscrRes;
+    ErlNifBinary sql;
+
+    if (!enif_get_resource(env, argv[0], dpiSubscr_type, (void **)&subscrRes))
+        BADARG_EXCEPTION(0, "resource subscription");
+    if (!enif_inspect_binary(env, argv[1], &sql))
+        BADARG_EXCEPTION(1, "binary/string sql");
+    if (!subscrRes->active)
+        RAISE_STR_EXCEPTION("subscription is closed");
+
+    dpiStmt_res *stmtRes;
+    ALLOC_RESOURCE(stmtRes, dpiStmt);
+    dpiStmt_res_init(stmtRes, subscrRes->context);
+    dpiStmt_res_attach(stmtRes, subscrRes->connRes);
+
+    RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(
+        subscrRes->context,
+        dpiSubscr_prepareStmt(
+            subscrRes->subscr, (const char *)sql.data, sql.size,
+            &stmtRes->stmt),
+        stmtRes, dpiStmt);
+
+    ERL_NIF_TERM stmtResTerm = enif_make_resource(env, stmtRes);
+
+    RETURNED_TRACE;
+    return stmtResTerm;
+}
+
+#ifdef ORANIF_TEST
+/*******************************************************************************
+ * Synthetic notifications
+ * subscr_notify feeds a message through the callback from a native thread,
+ * the same path the OCI notification thread takes, so that consumers can be
+ * tested without a database raising change events. ORANIF_TEST builds only,
+ * it waits for the thread on a dirty IO scheduler
+ ******************************************************************************/
+
+typedef struct
+{
+    dpiSubscr_res *subscrRes;
+    dpiSubscrMessage *message;
+} dpiSubscrNotify;
+
+static void *subscr_notifyThread(void *arg)
+{
+    dpiSubscrNotify *notify = (dpiSubscrNotify *)arg;
+
+    dpiSubscr_callback(notify->subscrRes, notify->message);
+
+    return NULL;
+}
+
+DPI_NIF_FUN(subscr_notify)
+{
+    CHECK_ARGCOUNT(3);
+
+    dpiSubscr_res *subscrRes;
+    dpiSubscrMessage message;
+    unsigned numTables, numRows;
+    ERL_NIF_TERM head, tail, rowHead, rowTail;
+    const ERL_NIF_TERM *tuple;
+    ErlNifBinary bin;
+    int arity;
+
+    if (!enif_get_resource(env, argv[0], dpiSubscr_type, (void **)&subscrRes))
+        BADARG_EXCEPTION(0, "resource subscription");
+
+    memset(&message, 0, sizeof(message));
+    DPI_EVENT_TYPE_FROM_ATOM(argv[1], message.eventType);
+
+    if (!enif_get_list_length(env, argv[2], &numTables))
+        BADARG_EXCEPTION(2, "list tables");
+
+    // the whole message is allocated in one block, tables first
+    size_t size = sizeof(dpiSubscrMessageTable) * numTables;
+    for (tail = argv[2]; enif_get_list_cell(env, tail, &head, &tail);)
+    {
+        if (!enif_get_tuple(env, head, &arity, &tuple) || arity != 2 ||
+            !enif_is_binary(env, tuple[0]) ||
+            !enif_get_list_length(env, tuple[1], &numRows))
+            BADARG_EXCEPTION(2, "list tables of {Name, Rowids}");
+        size += sizeof(dpiSubscrMessageRow) * numRows;
+    }
+    dpiSubscrMessageTable *tables = enif_alloc(size > 0 ? size : 1);
+    dpiSubscrMessageRow *rows = (dpiSubscrMessageRow *)(tables + numTables);
+
+    tail = argv[2];
+    for (unsigned t = 0; enif_get_list_cell(env, tail, &head, &tail); t++)
+    {
+        enif_get_tuple(env, head, &arity, &tuple);
+        enif_inspect_binary(env, tuple[0], &bin);
+        tables[t].operation = DPI_OPCODE_UPDATE;
+        tables[t].name = (const char *)bin.data;
+        tables[t].nameLength = bin.size;
+        tables[t].rows = rows;
+        tables[t].numRows = 0;
+        for (rowTail = tuple[1];
+             enif_get_list_cell(env, rowTail, &rowHead, &rowTail);)
+        {
+            if (!enif_inspect_binary(env, rowHead, &bin))
+            {
+                enif_free(tables);
+                BADARG_EXCEPTION(2, "list tables of {Name, Rowids}");
+            }
+            rows->operation = DPI_OPCODE_UPDATE;
+            rows->rowid = (const char *)bin.data;
+            rows->rowidLength = bin.size;
+            rows++;
+            tables[t].numRows++;
+        }
+    }
+    message.tables = tables;
+    message.numTables = numTables;
+
+    dpiSubscrNotify notify = {subscrRes, &message};
+    ErlNifTid tid;
+    if (enif_thread_create(
+            "oranif_subscr", &tid, subscr_notifyThread, &notify, NULL))
+    {
+        enif_free(tables);
+        RAISE_STR_EXCEPTION("failed to create notification thread");
+    }
+    enif_thread_join(tid, NULL);
+    enif_free(tables);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+#endif // ORANIF_TEST
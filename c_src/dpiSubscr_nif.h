@@ -0,0 +1,80 @@
+#ifndef _DPISUBSCR_NIF_H_
+#define _DPISUBSCR_NIF_H_
+
+#include "dpi_nif.h"
+#include "dpi.h"
+#include "dpiConn_nif.h"
+
+typedef struct
+{
+    dpiSubscr *subscr;
+    dpiContext *context;
+    dpiConn_res *connRes; // kept while subscribed
+    ErlNifMutex *lock;
+    ErlNifPid owner;
+    ErlNifEnv *msgEnv;
+    int active;
+} dpiSubscr_res;
+
+extern ErlNifResourceType *dpiSubscr_type;
+
+extern void dpiSubscr_res_dtor(ErlNifEnv *env, void *resource);
+extern void dpiSubscr_callback(void *context, dpiSubscrMessage *message);
+
+extern DPI_NIF_FUN(subscr_prepareStmt);
+
+#ifdef ORANIF_TEST
+extern DPI_NIF_FUN(subscr_notify);
+
+#define DPISUBSCR_NIFS                    \
+    IOB_NIF(subscr_prepareStmt, 2),       \
+        IOB_NIF(subscr_notify, 3)
+#else
+#define DPISUBSCR_NIFS                    \
+    IOB_NIF(subscr_prepareStmt, 2)
+#endif // ORANIF_TEST
+
+#define DPI_SUBSCR_QOS_FROM_ATOM(_atom, _assign)            \
+    A2M(DPI_SUBSCR_QOS_RELIABLE, _atom, _assign);           \
+    else A2M(DPI_SUBSCR_QOS_DEREG_NFY, _atom, _assign);     \
+    else A2M(DPI_SUBSCR_QOS_ROWIDS, _atom, _assign);        \
+    else A2M(DPI_SUBSCR_QOS_QUERY, _atom, _assign);         \
+    else A2M(DPI_SUBSCR_QOS_BEST_EFFORT, _atom, _assign);   \
+    else BADARG_EXCEPTION(1, "DPI_SUBSCR_QOS atom")
+
+#define DPI_OPCODE_FROM_ATOM(_atom, _assign)         \
+    A2M(DPI_OPCODE_ALL_OPS, _atom, _assign);         \
+    else A2M(DPI_OPCODE_ALL_ROWS, _atom, _assign);   \
+    else A2M(DPI_OPCODE_INSERT, _atom, _assign);     \
+    else A2M(DPI_OPCODE_UPDATE, _atom, _assign);     \
+    else A2M(DPI_OPCODE_DELETE, _atom, _assign);     \
+    else A2M(DPI_OPCODE_ALTER, _atom, _assign);      \
+    else A2M(DPI_OPCODE_DROP, _atom, _assign);       \
+    else BADARG_EXCEPTION(1, "DPI_OPCODE atom")
+
+#define DPI_EVENT_TYPE_FROM_ATOM(_atom, _assign)          \
+    A2M(DPI_EVENT_NONE, _atom, _assign);                  \
+    else A2M(DPI_EVENT_STARTUP, _atom, _assign);          \
+    else A2M(DPI_EVENT_SHUTDOWN, _atom, _assign);         \
+    else A2M(DPI_EVENT_SHUTDOWN_ANY, _atom, _assign);     \
+    else A2M(DPI_EVENT_DEREG, _atom, _assign);            \
+    else A2M(DPI_EVENT_OBJCHANGE, _atom, _assign);        \
+    else A2M(DPI_EVENT_QUERYCHANGE, _atom, _assign);      \
+    else BADARG_EXCEPTION(1, "DPI_EVENT atom")
+
+#define DPI_EVENT_TYPE_TO_ATOM(_type, _assign)      \
+    switch (_type)                                  \
+    {                                               \
+        M2A(DPI_EVENT_NONE, _assign);               \
+        M2A(DPI_EVENT_STARTUP, _assign);            \
+        M2A(DPI_EVENT_SHUTDOWN, _assign);           \
+        M2A(DPI_EVENT_SHUTDOWN_ANY, _assign);       \
+        M2A(DPI_EVENT_DEREG, _assign);              \
+        M2A(DPI_EVENT_OBJCHANGE, _assign);          \
+        M2A(DPI_EVENT_QUERYCHANGE, _assign);        \
+        M2A(DPI_EVENT_AQ, _assign);                 \
+    default:                                        \
+        _assign = enif_make_atom(env, "unsupported"); \
+    }
+
+#endif // _DPISUBSCR_NIF_H_
@@ -1,14 +1,33 @@
 #include "dpiVar_nif.h"
+#include "dpiConn_nif.h"
 #include "dpiData_nif.h"
+#include "dpiObject_nif.h"
 
 ErlNifResourceType *dpiVar_type;
 
 void dpiVar_res_dtor(ErlNifEnv *env, void *resource)
 {
     CALL_TRACE;
+
+    dpiVar_res_uncharge(env, (dpiVar_res *)resource);
+
     RETURNED_TRACE;
 }
 
+// releases the memory charged for the variable and its connection reference
+void dpiVar_res_uncharge(ErlNifEnv *env, dpiVar_res *varRes)
+{
+    dpiConn_res *connRes = (dpiConn_res *)varRes->connRes;
+
+    if (!connRes)
+        return;
+    oranif_memRelease(
+        env, ORANIF_MEM_VAR, &connRes->memBytes, varRes->memBytes);
+    varRes->memBytes = 0;
+    varRes->connRes = NULL;
+    enif_release_resource(connRes);
+}
+
 DPI_NIF_FUN(var_setNumElementsInArray)
 {
     CHECK_ARGCOUNT(2);
@@ -54,6 +73,28 @@ DPI_NIF_FUN(var_setFromBytes)
     return ATOM_OK;
 }
 
+DPI_NIF_FUN(var_setFromObject)
+{
+    CHECK_ARGCOUNT(3);
+
+    dpiVar_res *vRes = NULL;
+    dpiObject_res *objRes = NULL;
+    uint32_t pos;
+
+    if ((!enif_get_resource(env, argv[0], dpiVar_type, (void **)&vRes)))
+        BADARG_EXCEPTION(0, "resource var");
+    if (!enif_get_uint(env, argv[1], &pos))
+        BADARG_EXCEPTION(1, "uint pos");
+    if (!enif_get_resource(env, argv[2], dpiObject_type, (void **)&objRes))
+        BADARG_EXCEPTION(2, "resource object");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        vRes->context, dpiVar_setFromObject(vRes->var, pos, objRes->obj));
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
 DPI_NIF_FUN(var_release)
 {
     CHECK_ARGCOUNT(1);
@@ -65,13 +106,18 @@ DPI_NIF_FUN(var_release)
 
     RAISE_EXCEPTION_ON_DPI_ERROR(vRes->context, dpiVar_release(vRes->var));
 
-    dpiDataPtr_res *t_itr;
-    for (dpiDataPtr_res *itr = vRes->head; itr != NULL;)
+    if (vRes->slab)
     {
-        t_itr = itr;
-        itr = itr->next;
-        RELEASE_RESOURCE(t_itr, dpiDataPtr);
+        // only REF CURSOR elements own a statement
+        if (vRes->nativeTypeNum == DPI_NATIVE_TYPE_STMT)
+            for (uint32_t i = 0; i < vRes->maxArraySize; i++)
+                if (vRes->slab[i].stmtRes)
+                    RELEASE_RESOURCE(vRes->slab[i].stmtRes, dpiStmt);
+        enif_free(vRes->slab);
+        vRes->slab = NULL;
     }
+    vRes->conn = NULL;
+    dpiVar_res_uncharge(env, vRes);
 
     RELEASE_RESOURCE(vRes, dpiVar);
 
@@ -98,24 +144,97 @@ DPI_NIF_FUN(var_getReturnedData)
         varRes->context,
         dpiVar_getReturnedData(varRes->var, pos, &numElements, &data));
 
-    ERL_NIF_TERM dataList = enif_make_list(env, 0);
+    if (!varRes->slab || numElements > varRes->maxArraySize)
+        RAISE_STR_EXCEPTION("returned data exceeds the variable array size");
 
-    dpiDataPtr_res *dataRes = varRes->head;
+    ERL_NIF_TERM dataList = enif_make_list(env, 0);
 
     for (int i = numElements - 1; i >= 0; i--)
     {
-        dataRes->dpiDataPtr = data + i;
-        ERL_NIF_TERM dataResTerm = enif_make_resource(env, dataRes);
-        dataList = enif_make_list_cell(env, dataResTerm, dataList);
-        dataRes = dataRes->next;
+        varRes->slab[i].dpiDataPtr = data + i;
+        dataList = enif_make_list_cell(
+            env, enif_make_tuple2(env, argv[0], enif_make_uint(env, i)),
+            dataList);
     }
-    ERL_NIF_TERM ret = enif_make_new_map(env);
-    ret = enif_make_new_map(env);
-    enif_make_map_put(
-        env, ret, enif_make_atom(env, "numElements"),
-        enif_make_uint(env, numElements), &ret);
-    enif_make_map_put(env, ret, enif_make_atom(env, "data"), dataList, &ret);
+    ERL_NIF_TERM keys[] = {ATOM_data, ATOM_numElements};
+    ERL_NIF_TERM values[] = {dataList, enif_make_uint(env, numElements)};
+    ERL_NIF_TERM ret = MAKE_MAP(env, keys, values);
 
     RETURNED_TRACE;
     return ret;
 }
+
+DPI_NIF_FUN(var_getReturnedValues)
+{
+    CHECK_ARGCOUNT(2);
+
+    dpiVar_res *varRes = NULL;
+    uint32_t numIters, numElements;
+    dpiData *data;
+    ERL_NIF_TERM value;
+
+    if ((!enif_get_resource(env, argv[0], dpiVar_type, (void **)&varRes)))
+        BADARG_EXCEPTION(0, "resource var");
+    if (!enif_get_uint(env, argv[1], &numIters))
+        BADARG_EXCEPTION(1, "uint numIters");
+
+    dpiDataDecoder decode = dpiData_getDecoder(varRes->nativeTypeNum, 1);
+    if (!decode)
+        RAISE_STR_EXCEPTION("Unsupported nativeTypeNum");
+
+    // one list of returned values for each iteration of executeMany
+    ERL_NIF_TERM iterList = enif_make_list(env, 0);
+    for (int pos = numIters - 1; pos >= 0; pos--)
+    {
+        RAISE_EXCEPTION_ON_DPI_ERROR(
+            varRes->context,
+            dpiVar_getReturnedData(varRes->var, pos, &numElements, &data));
+
+        ERL_NIF_TERM valueList = enif_make_list(env, 0);
+        for (int i = numElements - 1; i >= 0; i--)
+        {
+            RAISE_EXCEPTION_ON_DPI_ERROR(
+                varRes->context, decode(env, data + i, &value));
+            valueList = enif_make_list_cell(env, value, valueList);
+        }
+        iterList = enif_make_list_cell(env, valueList, iterList);
+    }
+
+    // [[term]]
+    RETURNED_TRACE;
+    return iterList;
+}
+
+DPI_NIF_FUN(var_getArrayValues)
+{
+    CHECK_ARGCOUNT(1);
+
+    dpiVar_res *vRes = NULL;
+    uint32_t numElements;
+    ERL_NIF_TERM value, list;
+
+    if ((!enif_get_resource(env, argv[0], dpiVar_type, (void **)&vRes)))
+        BADARG_EXCEPTION(0, "resource var");
+
+    dpiDataDecoder decode = dpiData_getDecoder(vRes->nativeTypeNum, 1);
+    if (!decode)
+        RAISE_STR_EXCEPTION("Unsupported nativeTypeNum");
+
+    RAISE_EXCEPTION_ON_DPI_ERROR(
+        vRes->context,
+        dpiVar_getNumElementsInArray(vRes->var, &numElements));
+    if (numElements > vRes->maxArraySize)
+        numElements = vRes->maxArraySize;
+
+    list = enif_make_list(env, 0);
+    for (uint32_t i = numElements; i > 0; i--)
+    {
+        RAISE_EXCEPTION_ON_DPI_ERROR(
+            vRes->context, decode(env, &vRes->data[i - 1], &value));
+        list = enif_make_list_cell(env, value, list);
+    }
+
+    // [term]
+    RETURNED_TRACE;
+    return list;
+}
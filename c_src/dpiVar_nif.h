@@ -3,27 +3,54 @@
 
 #include "dpi_nif.h"
 #include "dpi.h"
+#include "dpiData_nif.h"
+
+// creation parameters a pooled variable is matched by
+typedef struct
+{
+    dpiOracleTypeNum oracleTypeNum;
+    dpiNativeTypeNum nativeTypeNum;
+    uint32_t maxArraySize;
+    uint32_t size;
+    int sizeIsBytes;
+    int isArray;
+} dpiVarKey;
 
 typedef struct
 {
     dpiVar *var;
     dpiContext *context;
-    void *head;
+    dpiNativeTypeNum nativeTypeNum;
+    dpiDataPtr_res *slab; // element handles, NULL if not created by newVar
+    dpiData *data;
+    uint32_t maxArraySize;
+    dpiConn *conn; // creating connection, NULL if the var can't be pooled
+    dpiVarKey key;
+    void *connRes;     // dpiConn_res kept while memBytes are charged to it
+    uint64_t memBytes; // buffers, element data and handles
+    volatile int32_t stmtUses; // statements it's bound to or defined on
 } dpiVar_res;
 
 extern ErlNifResourceType *dpiVar_type;
 
 extern void dpiVar_res_dtor(ErlNifEnv *env, void *resource);
+extern void dpiVar_res_uncharge(ErlNifEnv *env, dpiVar_res *varRes);
 
 extern DPI_NIF_FUN(var_release);
 extern DPI_NIF_FUN(var_setFromBytes);
+extern DPI_NIF_FUN(var_setFromObject);
 extern DPI_NIF_FUN(var_setNumElementsInArray);
 extern DPI_NIF_FUN(var_getReturnedData);
+extern DPI_NIF_FUN(var_getReturnedValues);
+extern DPI_NIF_FUN(var_getArrayValues);
 
 #define DPIVAR_NIFS                            \
     DEF_NIF(var_release, 1),                   \
         IOB_NIF(var_setFromBytes, 3),          \
+        DEF_NIF(var_setFromObject, 3),         \
         DEF_NIF(var_setNumElementsInArray, 2), \
-        DEF_NIF(var_getReturnedData, 2)
+        DEF_NIF(var_getReturnedData, 2),       \
+        IOB_NIF(var_getReturnedValues, 2),     \
+        DEF_NIF(var_getArrayValues, 1)
 
 #endif // _DPIVAR_NIF_H_
@@ -9,6 +9,15 @@
 #include "dpiQueryInfo_nif.h"
 #include "dpiData_nif.h"
 #include "dpiVar_nif.h"
+#include "dpiScan_nif.h"
+#include "dpiRouter_nif.h"
+#include "dpiSubscr_nif.h"
+#include "dpiQueue_nif.h"
+#include "dpiObject_nif.h"
+
+#ifdef __WIN32__
+#include <windows.h>
+#endif
 
 ERL_NIF_TERM ATOM_OK;
 ERL_NIF_TERM ATOM_NULL;
@@ -17,7 +26,15 @@ ERL_NIF_TERM ATOM_FALSE;
 ERL_NIF_TERM ATOM_ERROR;
 ERL_NIF_TERM ATOM_ENOMEM;
 
+#define ORANIF_DEFINE_KEY_ATOM(_name) ERL_NIF_TERM ATOM_##_name;
+ORANIF_KEY_ATOMS(ORANIF_DEFINE_KEY_ATOM)
+
 DPI_NIF_FUN(resource_count);
+#ifdef ORANIF_TEST
+DPI_NIF_FUN(inject_latency);
+#endif
+DPI_NIF_FUN(memory_usage);
+DPI_NIF_FUN(memory_limit);
 
 static ErlNifFunc nif_funcs[] = {
     DPICONTEXT_NIFS,
@@ -25,7 +42,17 @@ static ErlNifFunc nif_funcs[] = {
     DPISTMT_NIFS,
     DPIDATA_NIFS,
     DPIVAR_NIFS,
-    {"resource_count", 0, resource_count}};
+    DPISCAN_NIFS,
+    DPIROUTER_NIFS,
+    DPISUBSCR_NIFS,
+    DPIQUEUE_NIFS,
+    DPIOBJECT_NIFS,
+    {"resource_count", 0, resource_count},
+#ifdef ORANIF_TEST
+    {"inject_latency", 1, inject_latency},
+#endif
+    {"memory_usage", 0, memory_usage},
+    {"memory_limit", 1, memory_limit}};
 
 /*******************************************************************************
  * Helper internal functions
@@ -36,72 +63,287 @@ DPI_NIF_FUN(resource_count)
 
     oranif_st *st = (oranif_st *)enif_priv_data(env);
 
-    ERL_NIF_TERM ret = enif_make_new_map(env);
-    ret = enif_make_new_map(env);
-    enif_make_map_put(
-        env, ret, enif_make_atom(env, "context"),
-        enif_make_ulong(env, st->dpiContext_count), &ret);
-    enif_make_map_put(
-        env, ret, enif_make_atom(env, "connection"),
-        enif_make_ulong(env, st->dpiConn_count), &ret);
-    enif_make_map_put(
-        env, ret, enif_make_atom(env, "statement"),
-        enif_make_ulong(env, st->dpiStmt_count), &ret);
-    enif_make_map_put(
-        env, ret, enif_make_atom(env, "variable"),
-        enif_make_ulong(env, st->dpiVar_count), &ret);
-    enif_make_map_put(
-        env, ret, enif_make_atom(env, "data"),
-        enif_make_ulong(env, st->dpiData_count), &ret);
-    enif_make_map_put(
-        env, ret, enif_make_atom(env, "datapointer"),
-        enif_make_ulong(env, st->dpiDataPtr_count), &ret);
+    ERL_NIF_TERM keys[] = {
+        ATOM_connection, ATOM_context, ATOM_data, ATOM_datapointer,
+        ATOM_object, ATOM_objecttype, ATOM_router, ATOM_scan,
+        ATOM_statement, ATOM_subscription, ATOM_variable};
+    ERL_NIF_TERM values[] = {
+        enif_make_ulong(env, st->dpiConn_count),
+        enif_make_ulong(env, st->dpiContext_count),
+        enif_make_ulong(env, st->dpiData_count),
+        enif_make_ulong(env, st->dpiDataPtr_count),
+        enif_make_ulong(env, st->dpiObject_count),
+        enif_make_ulong(env, st->dpiObjectType_count),
+        enif_make_ulong(env, st->dpiRouter_count),
+        enif_make_ulong(env, st->dpiScan_count),
+        enif_make_ulong(env, st->dpiStmt_count),
+        enif_make_ulong(env, st->dpiSubscr_count),
+        enif_make_ulong(env, st->dpiVar_count)};
+
+    RETURNED_TRACE;
+    return MAKE_MAP(env, keys, values);
+}
+
+#ifdef ORANIF_TEST
+DPI_NIF_FUN(inject_latency)
+{
+    CHECK_ARGCOUNT(1);
+
+    oranif_st *st = (oranif_st *)enif_priv_data(env);
+    uint32_t latency;
+
+    if (!enif_get_uint(env, argv[0], &latency))
+        BADARG_EXCEPTION(0, "uint latency");
+
+    st->injectedLatency = latency;
 
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+#endif // ORANIF_TEST
+
+int32_t oranif_atomicAdd(volatile int32_t *value, int32_t delta)
+{
+#ifdef __WIN32__
+    return InterlockedExchangeAdd((volatile LONG *)value, delta) + delta;
+#else
+    return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+int oranif_atomicCas(
+    volatile int32_t *value, int32_t expected, int32_t desired)
+{
+#ifdef __WIN32__
+    return InterlockedCompareExchange(
+               (volatile LONG *)value, desired, expected) == expected;
+#else
+    return __atomic_compare_exchange_n(
+        value, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+int oranif_memCharge(
+    ErlNifEnv *env, int kind, uint64_t *owner, uint64_t bytes, int force)
+{
+    oranif_st *st = (oranif_st *)enif_priv_data(env);
+    int charged = 0;
+
+    enif_mutex_lock(st->lock);
+    uint64_t total = 0;
+    for (int k = 0; k < ORANIF_MEM_KINDS; k++)
+        total += st->memBytes[k];
+    if (force || !st->memLimit || total + bytes <= st->memLimit)
+    {
+        st->memBytes[kind] += bytes;
+        if (owner)
+            *owner += bytes;
+        charged = 1;
+    }
+    enif_mutex_unlock(st->lock);
+
+    return charged;
+}
+
+void oranif_memRelease(
+    ErlNifEnv *env, int kind, uint64_t *owner, uint64_t bytes)
+{
+    oranif_st *st = (oranif_st *)enif_priv_data(env);
+
+    enif_mutex_lock(st->lock);
+    st->memBytes[kind] -= bytes;
+    if (owner)
+        *owner -= bytes;
+    enif_mutex_unlock(st->lock);
+}
+
+DPI_NIF_FUN(memory_usage)
+{
+    CHECK_ARGCOUNT(0);
+
+    oranif_st *st = (oranif_st *)enif_priv_data(env);
+
+    ERL_NIF_TERM keys[] = {ATOM_data, ATOM_limit, ATOM_total, ATOM_variable};
+    ERL_NIF_TERM values[4];
+    enif_mutex_lock(st->lock);
+    values[0] = enif_make_uint64(env, st->memBytes[ORANIF_MEM_DATA]);
+    values[1] = st->memLimit ? enif_make_uint64(env, st->memLimit)
+                             : enif_make_atom(env, "infinity");
+    values[2] = enif_make_uint64(
+        env, st->memBytes[ORANIF_MEM_VAR] + st->memBytes[ORANIF_MEM_DATA]);
+    values[3] = enif_make_uint64(env, st->memBytes[ORANIF_MEM_VAR]);
+    enif_mutex_unlock(st->lock);
+    ERL_NIF_TERM ret = MAKE_MAP(env, keys, values);
+
+    /* #{variable => integer, data => integer, total => integer,
+         limit => integer | infinity} */
     RETURNED_TRACE;
     return ret;
 }
 
+DPI_NIF_FUN(memory_limit)
+{
+    CHECK_ARGCOUNT(1);
+
+    oranif_st *st = (oranif_st *)enif_priv_data(env);
+    ErlNifUInt64 limit;
+
+    if (enif_is_identical(argv[0], enif_make_atom(env, "infinity")))
+        limit = 0;
+    else if (!enif_get_uint64(env, argv[0], &limit) || limit == 0)
+        BADARG_EXCEPTION(0, "pos_integer or atom infinity limit");
+
+    // lowering the limit below the usage only fails later allocations
+    enif_mutex_lock(st->lock);
+    st->memLimit = limit;
+    enif_mutex_unlock(st->lock);
+
+    RETURNED_TRACE;
+    return ATOM_OK;
+}
+
+#ifdef ORANIF_TEST
+/*
+ * delays ODPI-C calls on whatever thread makes them, a NIF doing round trips
+ * which isn't registered as dirty then blocks a normal scheduler for the
+ * latency, which the tests notice
+ */
+void oranif_injectLatency(ErlNifEnv *env)
+{
+    oranif_st *st = (oranif_st *)enif_priv_data(env);
+
+    if (st->injectedLatency)
+        oranif_sleep(st->injectedLatency);
+}
+#endif // ORANIF_TEST
+
+/*******************************************************************************
+ * Thread reaper
+ * one per loaded library, it only joins threads which already queued
+ * themselves and are about to return
+ ******************************************************************************/
+
+typedef struct oranif_reapEntry
+{
+    struct oranif_reapEntry *next;
+    ErlNifTid tid;
+} oranif_reapEntry;
+
+static struct
+{
+    ErlNifMutex *lock;
+    ErlNifCond *cond;
+    ErlNifTid tid;
+    oranif_reapEntry *entries;
+    int stop;
+} reaper;
+
+static void *oranif_reaperThread(void *arg)
+{
+    oranif_reapEntry *entry;
+
+    enif_mutex_lock(reaper.lock);
+    for (;;)
+    {
+        while (!reaper.entries && !reaper.stop)
+            enif_cond_wait(reaper.cond, reaper.lock);
+        if (!reaper.entries)
+            break;
+        entry = reaper.entries;
+        reaper.entries = entry->next;
+        enif_mutex_unlock(reaper.lock);
+
+        enif_thread_join(entry->tid, NULL);
+        enif_free(entry);
+
+        enif_mutex_lock(reaper.lock);
+    }
+    enif_mutex_unlock(reaper.lock);
+
+    return NULL;
+}
+
+static int oranif_reaperStart(void)
+{
+    reaper.lock = enif_mutex_create("oranif_reaper");
+    reaper.cond = enif_cond_create("oranif_reaper");
+    reaper.entries = NULL;
+    reaper.stop = 0;
+
+    return reaper.lock && reaper.cond &&
+           !enif_thread_create(
+               "oranif_reaper", &reaper.tid, oranif_reaperThread, NULL,
+               NULL);
+}
+
+// joins the threads queued so far, later ones are the caller's problem
+static void oranif_reaperStop(void)
+{
+    enif_mutex_lock(reaper.lock);
+    reaper.stop = 1;
+    enif_cond_signal(reaper.cond);
+    enif_mutex_unlock(reaper.lock);
+    enif_thread_join(reaper.tid, NULL);
+
+    enif_cond_destroy(reaper.cond);
+    enif_mutex_destroy(reaper.lock);
+}
+
+// returns 0 if the thread couldn't be created
+int oranif_threadCreate(char *name, void *(*func)(void *), void *arg)
+{
+    ErlNifTid tid;
+
+    return !enif_thread_create(name, &tid, func, arg, NULL);
+}
+
+void oranif_threadExit(void)
+{
+    oranif_reapEntry *entry = enif_alloc(sizeof(oranif_reapEntry));
+
+    entry->tid = enif_thread_self();
+    enif_mutex_lock(reaper.lock);
+    entry->next = reaper.entries;
+    reaper.entries = entry;
+    enif_cond_signal(reaper.cond);
+    enif_mutex_unlock(reaper.lock);
+}
+
+ERL_NIF_TERM oranif_makeMap(
+    ErlNifEnv *env, ERL_NIF_TERM keys[], ERL_NIF_TERM values[], size_t count)
+{
+    ERL_NIF_TERM map;
+
+#if ERL_NIF_MAJOR_VERSION > 2 || \
+    (ERL_NIF_MAJOR_VERSION == 2 && ERL_NIF_MINOR_VERSION >= 14)
+    if (enif_make_map_from_arrays(env, keys, values, count, &map))
+        return map;
+#endif
+    // older emulators, or duplicate keys which are a bug of the caller
+    map = enif_make_new_map(env);
+    for (size_t i = 0; i < count; i++)
+        enif_make_map_put(env, map, keys[i], values[i], &map);
+
+    return map;
+}
+
 ERL_NIF_TERM dpiErrorInfoMap(ErlNifEnv *env, dpiErrorInfo e)
 {
     CALL_TRACE;
 
-    ERL_NIF_TERM map = enif_make_new_map(env);
-
-    enif_make_map_put(
-        env, map,
-        enif_make_atom(env, "code"), enif_make_int(env, e.code), &map);
-    enif_make_map_put(
-        env, map,
-        enif_make_atom(env, "offset"), enif_make_uint(env, e.offset), &map);
-    enif_make_map_put(
-        env, map,
-        enif_make_atom(env, "message"),
-        enif_make_string_len(env, e.message, e.messageLength, ERL_NIF_LATIN1),
-        &map);
-    enif_make_map_put(
-        env, map,
-        enif_make_atom(env, "encoding"),
+    ERL_NIF_TERM keys[] = {
+        ATOM_action, ATOM_code, ATOM_encoding, ATOM_fnName,
+        ATOM_isRecoverable, ATOM_message, ATOM_offset, ATOM_sqlState};
+    ERL_NIF_TERM values[] = {
+        enif_make_string(env, e.action, ERL_NIF_LATIN1),
+        enif_make_int(env, e.code),
         enif_make_string(env, e.encoding, ERL_NIF_LATIN1),
-        &map);
-    enif_make_map_put(
-        env, map,
-        enif_make_atom(env, "fnName"),
         enif_make_string(env, e.fnName, ERL_NIF_LATIN1),
-        &map);
-    enif_make_map_put(
-        env, map,
-        enif_make_atom(env, "action"),
-        enif_make_string(env, e.action, ERL_NIF_LATIN1),
-        &map);
-    enif_make_map_put(
-        env, map,
-        enif_make_atom(env, "sqlState"),
-        enif_make_string(env, e.sqlState, ERL_NIF_LATIN1),
-        &map);
-    enif_make_map_put(
-        env, map,
-        enif_make_atom(env, "isRecoverable"),
-        (e.isRecoverable == 0 ? ATOM_FALSE : ATOM_TRUE), &map);
+        e.isRecoverable == 0 ? ATOM_FALSE : ATOM_TRUE,
+        enif_make_string_len(env, e.message, e.messageLength, ERL_NIF_LATIN1),
+        enif_make_uint(env, e.offset),
+        enif_make_string(env, e.sqlState, ERL_NIF_LATIN1)};
+    ERL_NIF_TERM map = MAKE_MAP(env, keys, values);
 
     /* #{ code => integer(), offset => integer(), message => string(),
           encoding => string(), fnName => string(), action => string(),
@@ -132,12 +374,27 @@ static int load(ErlNifEnv *env, void **priv_data, ERL_NIF_TERM load_info)
         return 1;
     }
 
+    if (!oranif_reaperStart())
+    {
+        E("failed to start oranif reaper thread\r\n");
+        return 1;
+    }
+
     st->dpiVar_count = 0;
     st->dpiData_count = 0;
     st->dpiStmt_count = 0;
     st->dpiConn_count = 0;
     st->dpiContext_count = 0;
     st->dpiDataPtr_count = 0;
+    st->dpiScan_count = 0;
+    st->dpiRouter_count = 0;
+    st->dpiSubscr_count = 0;
+    st->dpiObjectType_count = 0;
+    st->dpiObject_count = 0;
+    st->injectedLatency = 0;
+    for (int k = 0; k < ORANIF_MEM_KINDS; k++)
+        st->memBytes[k] = 0;
+    st->memLimit = 0;
 
     DEF_RES(dpiContext);
     DEF_RES(dpiConn);
@@ -145,6 +402,11 @@ static int load(ErlNifEnv *env, void **priv_data, ERL_NIF_TERM load_info)
     DEF_RES(dpiData);
     DEF_RES(dpiDataPtr);
     DEF_RES(dpiVar);
+    DEF_RES_DOWN(dpiScan);
+    DEF_RES(dpiRouter);
+    DEF_RES(dpiSubscr);
+    DEF_RES(dpiObjectType);
+    DEF_RES(dpiObject);
 
     ATOM_OK = enif_make_atom(env, "ok");
     ATOM_NULL = enif_make_atom(env, "null");
@@ -152,6 +414,8 @@ static int load(ErlNifEnv *env, void **priv_data, ERL_NIF_TERM load_info)
     ATOM_FALSE = enif_make_atom(env, "false");
     ATOM_ERROR = enif_make_atom(env, "error");
     ATOM_ENOMEM = enif_make_atom(env, "enomem");
+#define ORANIF_MAKE_KEY_ATOM(_name) ATOM_##_name = enif_make_atom(env, #_name);
+    ORANIF_KEY_ATOMS(ORANIF_MAKE_KEY_ATOM)
 
     *priv_data = (void *)st;
 
@@ -179,6 +443,12 @@ static int upgrade(
         return 1;
     }
 
+    if (!oranif_reaperStart())
+    {
+        E("failed to start oranif reaper thread\r\n");
+        return 1;
+    }
+
     oranif_st *old_st = (oranif_st *)*old_priv_data;
     st->dpiVar_count = old_st->dpiVar_count;
     st->dpiData_count = old_st->dpiData_count;
@@ -186,6 +456,15 @@ static int upgrade(
     st->dpiConn_count = old_st->dpiConn_count;
     st->dpiContext_count = old_st->dpiContext_count;
     st->dpiDataPtr_count = old_st->dpiDataPtr_count;
+    st->dpiScan_count = old_st->dpiScan_count;
+    st->dpiRouter_count = old_st->dpiRouter_count;
+    st->dpiSubscr_count = old_st->dpiSubscr_count;
+    st->dpiObjectType_count = old_st->dpiObjectType_count;
+    st->dpiObject_count = old_st->dpiObject_count;
+    st->injectedLatency = old_st->injectedLatency;
+    for (int k = 0; k < ORANIF_MEM_KINDS; k++)
+        st->memBytes[k] = old_st->memBytes[k];
+    st->memLimit = old_st->memLimit;
 
     *priv_data = (void *)st;
 
@@ -198,6 +477,7 @@ static void unload(ErlNifEnv *env, void *priv_data)
     CALL_TRACE;
 
     oranif_st *st = (oranif_st *)priv_data;
+    oranif_reaperStop();
     enif_mutex_destroy(st->lock);
     enif_free(priv_data);
 
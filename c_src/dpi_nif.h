@@ -131,6 +131,21 @@
         return -1;                                                   \
     }
 
+// resource type with a down callback for the processes it monitors
+#define DEF_RES_DOWN(_res)                                                   \
+    {                                                                        \
+        ErlNifResourceTypeInit _init = {                                     \
+            _res##_res_dtor, NULL, _res##_res_down};                         \
+        _res##_type = enif_open_resource_type_x(                             \
+            env, #_res, &_init, ERL_NIF_RT_CREATE, NULL);                    \
+    }                                                                        \
+    if (!_res##_type)                                                        \
+    {                                                                        \
+        E("Failed to open resource type \"" #_res "\"");                     \
+        RETURNED_TRACE;                                                      \
+        return -1;                                                           \
+    }
+
 extern ERL_NIF_TERM ATOM_OK;
 extern ERL_NIF_TERM ATOM_NULL;
 extern ERL_NIF_TERM ATOM_TRUE;
@@ -138,6 +153,40 @@ extern ERL_NIF_TERM ATOM_FALSE;
 extern ERL_NIF_TERM ATOM_ERROR;
 extern ERL_NIF_TERM ATOM_ENOMEM;
 
+/*
+ * keys of the maps returned by the NIFs, created once in load() so that maps
+ * are built by MAKE_MAP from arrays instead of one copy per enif_make_map_put
+ */
+#define ORANIF_KEY_ATOMS(_)                                                  \
+    _(action) _(bufferRowIndex) _(cached) _(checks) _(clientSizeInBytes)      \
+    _(code) _(connection) _(context) _(data) _(datapointer) _(day) _(days)    \
+    _(dbName) _(dbSizeInBytes) _(defaultNativeTypeNum)                        \
+    _(elementNativeTypeNum) _(elementOracleTypeNum) _(encoding) _(entries)    \
+    _(error) _(eventType) _(fnName) _(found) _(fsPrecision) _(fsecond)        \
+    _(fseconds) _(fullVersionNum) _(hits) _(hour) _(hours) _(id) _(idle)      \
+    _(isCollection) _(isDDL) _(isDML) _(isPLSQL) _(isQuery) _(isRecoverable)  \
+    _(isReturning) _(lastCheck) _(limit) _(message) _(minute) _(minutes)      \
+    _(misses) _(month) _(months) _(moreRows) _(name) _(nativeTypeNum)         \
+    _(nencoding) _(nullOk) _(numAttributes) _(numElements) _(object)          \
+    _(objectType) _(objecttype) _(ociTypeCode) _(offset) _(operation)         \
+    _(oracleTypeNum) _(portReleaseNum) _(portUpdateNum) _(precision)          \
+    _(queries) _(ref) _(releaseNum) _(releaseString) _(router) _(rowid)       \
+    _(rows) _(scale) _(scan) _(schema) _(second) _(seconds) _(sent)           \
+    _(sizeInChars) _(skipped)                                                 \
+    _(sqlState) _(state) _(statement) _(statementType) _(subscription)        \
+    _(tables) _(total) _(txId) _(typeInfo) _(tzHourOffset) _(tzMinuteOffset)  \
+    _(updateNum) _(var) _(variable) _(versionNum) _(year) _(years)           
+
+#define ORANIF_DECLARE_KEY_ATOM(_name) extern ERL_NIF_TERM ATOM_##_name;
+ORANIF_KEY_ATOMS(ORANIF_DECLARE_KEY_ATOM)
+
+// keys in term order (sorted by name) keep the flatmap sort a single pass
+extern ERL_NIF_TERM oranif_makeMap(
+    ErlNifEnv *env, ERL_NIF_TERM keys[], ERL_NIF_TERM values[], size_t count);
+
+#define MAKE_MAP(_env, _keys, _values) \
+    oranif_makeMap(_env, _keys, _values, sizeof(_keys) / sizeof(_keys[0]))
+
 #define DEF_NIF(_fun, _arity) \
     {                         \
 #_fun, _arity, _fun   \
@@ -153,16 +202,62 @@ extern ERL_NIF_TERM ATOM_ENOMEM;
         ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
 
 extern ERL_NIF_TERM dpiErrorInfoMap(ErlNifEnv *, dpiErrorInfo);
-#define RAISE_EXCEPTION_ON_DPI_ERROR(_ctx, _exprn)    \
-    if (DPI_FAILURE == (_exprn))                      \
-    {                                                 \
-        dpiErrorInfo __err;                           \
-        dpiContext_getError(_ctx, &__err);            \
-        RAISE_EXCEPTION(dpiErrorInfoMap(env, __err)); \
+
+#ifdef ORANIF_TEST
+// latency injected (see inject_latency/1) before every wrapped ODPI-C call
+extern void oranif_injectLatency(ErlNifEnv *env);
+#define ORANIF_INJECT_LATENCY(_env) oranif_injectLatency(_env)
+#define ORANIF_DPI_FAILED(_exprn) \
+    (oranif_injectLatency(env), DPI_FAILURE == (_exprn))
+#else
+#define ORANIF_INJECT_LATENCY(_env)
+#define ORANIF_DPI_FAILED(_exprn) (DPI_FAILURE == (_exprn))
+#endif // ORANIF_TEST
+
+extern void oranif_sleep(uint32_t ms);
+
+/*
+ * native threads which end on their own call oranif_threadExit as their last
+ * step, the reaper thread joins them, so that neither a NIF nor a resource
+ * destructor waits for a thread which may be in a round trip
+ */
+extern int oranif_threadCreate(
+    char *name, void *(*func)(void *), void *arg);
+extern void oranif_threadExit(void);
+
+// lock-free counter shared between processes, returns the new value
+extern int32_t oranif_atomicAdd(volatile int32_t *value, int32_t delta);
+// sets value to desired if it is expected, returns whether it did
+extern int oranif_atomicCas(
+    volatile int32_t *value, int32_t expected, int32_t desired);
+
+// kinds of native memory accounted by oranif_memCharge, see memory_usage/0
+#define ORANIF_MEM_VAR 0  // variable buffers, element data and handles
+#define ORANIF_MEM_DATA 1 // binaries copied into data resources
+#define ORANIF_MEM_KINDS 2
+
+#define ORANIF_MEM_LIMIT_ERROR "native memory limit exceeded"
+
+/*
+ * charges bytes of a kind to the node and to owner (may be NULL), returns 0
+ * without charging if that exceeds the limit set by memory_limit/1 unless
+ * force is set, a release must name the same kind and owner
+ */
+extern int oranif_memCharge(
+    ErlNifEnv *env, int kind, uint64_t *owner, uint64_t bytes, int force);
+extern void oranif_memRelease(
+    ErlNifEnv *env, int kind, uint64_t *owner, uint64_t bytes);
+
+#define RAISE_EXCEPTION_ON_DPI_ERROR(_ctx, _exprn)                \
+    if (ORANIF_DPI_FAILED(_exprn))                                \
+    {                                                             \
+        dpiErrorInfo __err;                                       \
+        dpiContext_getError(_ctx, &__err);                        \
+        RAISE_EXCEPTION(dpiErrorInfoMap(env, __err));             \
     }
 
 #define RAISE_EXCEPTION_ON_DPI_ERROR_RESOURCE(_ctx, _exprn, _opt_res, _res) \
-    if (DPI_FAILURE == (_exprn))                                            \
+    if (ORANIF_DPI_FAILED(_exprn))                                          \
     {                                                                       \
         dpiErrorInfo __err;                                                 \
         if (_opt_res)                                                       \
@@ -194,6 +289,14 @@ typedef struct
     unsigned long dpiData_count;
     unsigned long dpiDataPtr_count;
     unsigned long dpiVar_count;
+    unsigned long dpiScan_count;
+    unsigned long dpiRouter_count;
+    unsigned long dpiSubscr_count;
+    unsigned long dpiObjectType_count;
+    unsigned long dpiObject_count;
+    uint32_t injectedLatency; // milliseconds, ORANIF_TEST builds only
+    uint64_t memBytes[ORANIF_MEM_KINDS];
+    uint64_t memLimit; // bytes over all kinds, 0 if unlimited
 } oranif_st;
 
 #define ALLOC_RESOURCE(_var, _dpiType)                                       \
@@ -6,13 +6,19 @@
 -export([load_unsafe/0]).
 -export([safe/2, safe/3, safe/4]).
 
--export([resource_count/0]).
+-export([resource_count/0, inject_latency/1]).
+-export([memory_usage/0, memory_limit/1]).
 
 -include("dpiContext.hrl").
 -include("dpiConn.hrl").
 -include("dpiStmt.hrl").
 -include("dpiData.hrl").
 -include("dpiVar.hrl").
+-include("dpiScan.hrl").
+-include("dpiRouter.hrl").
+-include("dpiSubscr.hrl").
+-include("dpiQueue.hrl").
+-include("dpiObject.hrl").
 
 %===============================================================================
 %   Slave Node APIs
@@ -181,3 +187,15 @@ get_reg_pids(SlaveNode, [_ | Rest], Acc) ->
     get_reg_pids(SlaveNode, Rest, Acc).
 
 resource_count() -> ?NIF_NOT_LOADED.
+
+% test mode: delays every wrapped ODPI-C call by Ms on any thread,
+% only NIF libraries built with ORANIF_TEST (make test) implement it
+inject_latency(Ms) when is_integer(Ms) -> ?NIF_NOT_LOADED.
+
+% native bytes held by variables and data resources
+memory_usage() -> ?NIF_NOT_LOADED.
+
+% new variables and data binaries fail once the total would exceed Limit,
+% variables are checked by an estimate of their size, see README
+memory_limit(Limit) when is_integer(Limit); Limit == infinity ->
+    ?NIF_NOT_LOADED.
@@ -0,0 +1,140 @@
+/*
+ * Checks the block (SSE2/AVX2) charset kernels of c_src/dpiCharset.c against
+ * their scalar variants and compares their throughput
+ *
+ *   gcc -O2 -std=c11 -Ic_src test/charset_bench.c c_src/dpiCharset.c
+ *   gcc -O2 -std=c11 -mavx2 -Ic_src test/charset_bench.c c_src/dpiCharset.c
+ */
+#include "dpiCharset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SIZE (1 << 20)
+#define ROUNDS 200
+
+static double now(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// fills s with text where about one byte in every asciiRun is not ASCII
+static void fill(unsigned char *s, size_t len, int asciiRun, int utf8)
+{
+    static const char *samples[] = {"\xC3\xA4", "\xE2\x82\xAC",
+                                    "\xF0\x9F\x98\x80"};
+    size_t i = 0;
+
+    while (i < len)
+    {
+        if (asciiRun && rand() % asciiRun == 0)
+        {
+            if (utf8)
+            {
+                const char *u = samples[rand() % 3];
+                size_t n = strlen(u);
+                if (i + n > len)
+                    break;
+                memcpy(s + i, u, n);
+                i += n;
+            }
+            else
+                s[i++] = (unsigned char)(0x80 + rand() % 128);
+        }
+        else
+            s[i++] = (unsigned char)(' ' + rand() % 95);
+    }
+    while (i < len)
+        s[i++] = 'x';
+}
+
+static int check(unsigned char *s, unsigned char *a, unsigned char *b)
+{
+    int failed = 0;
+
+    for (int t = 0; t < 10000; t++)
+    {
+        size_t len = (size_t)(rand() % 200);
+        for (size_t i = 0; i < len; i++)
+            s[i] = (unsigned char)(rand() % 4 ? ' ' + rand() % 95
+                                               : rand() % 256);
+        if (dpiCharset_isUtf8(s, len) != dpiCharset_isUtf8Scalar(s, len))
+            failed = 1;
+        size_t n = dpiCharset_sbToUtf8Length(dpiCharset_we8mswin1252, s, len);
+        if (n != dpiCharset_sbToUtf8LengthScalar(
+                     dpiCharset_we8mswin1252, s, len))
+            failed = 1;
+        dpiCharset_sbToUtf8(dpiCharset_we8mswin1252, s, len, a);
+        dpiCharset_sbToUtf8Scalar(dpiCharset_we8mswin1252, s, len, b);
+        if (memcmp(a, b, n) || !dpiCharset_isUtf8(a, n))
+            failed = 1;
+    }
+
+    return failed;
+}
+
+int main(void)
+{
+    unsigned char *s = malloc(SIZE), *out = malloc(SIZE * 3);
+    static const int runs[] = {0, 1000, 50, 5};
+    volatile size_t sink = 0;
+    double t;
+
+    if (check(s, out, out + SIZE))
+    {
+        printf("block and scalar kernels differ\n");
+        return 1;
+    }
+
+    printf("%-30s %10s %10s\n", "MB/s", "block", "scalar");
+    for (int r = 0; r < 4; r++)
+    {
+        double block, scalar;
+        char mix[16];
+
+        if (runs[r])
+            snprintf(mix, sizeof(mix), "1/%d", runs[r]);
+        else
+            snprintf(mix, sizeof(mix), "none");
+
+        fill(s, SIZE, runs[r], 1);
+        t = now();
+        for (int i = 0; i < ROUNDS; i++)
+            sink += dpiCharset_isUtf8(s, SIZE);
+        block = ROUNDS / (now() - t);
+        t = now();
+        for (int i = 0; i < ROUNDS; i++)
+            sink += dpiCharset_isUtf8Scalar(s, SIZE);
+        scalar = ROUNDS / (now() - t);
+        printf("utf8 validate, %-6s non-ASCII %10.0f %10.0f\n", mix, block,
+               scalar);
+
+        fill(s, SIZE, runs[r], 0);
+        t = now();
+        for (int i = 0; i < ROUNDS; i++)
+        {
+            size_t n =
+                dpiCharset_sbToUtf8Length(dpiCharset_we8mswin1252, s, SIZE);
+            dpiCharset_sbToUtf8(dpiCharset_we8mswin1252, s, SIZE, out);
+            sink += n;
+        }
+        block = ROUNDS / (now() - t);
+        t = now();
+        for (int i = 0; i < ROUNDS; i++)
+        {
+            size_t n = dpiCharset_sbToUtf8LengthScalar(
+                dpiCharset_we8mswin1252, s, SIZE);
+            dpiCharset_sbToUtf8Scalar(dpiCharset_we8mswin1252, s, SIZE, out);
+            sink += n;
+        }
+        scalar = ROUNDS / (now() - t);
+        printf("cp1252 to utf8, %-5s non-ASCII %10.0f %10.0f\n", mix, block,
+               scalar);
+    }
+
+    free(s);
+    free(out);
+    return 0;
+}
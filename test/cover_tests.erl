@@ -143,11 +143,58 @@ connCreate(TestCtx) ->
         #{message := "ORA-01017: invalid username/password; logon denied"},
         dpiCall(TestCtx, conn_create, [Context, <<"C">>, <<"N">>, Tns, CP, #{}])
     ),
+    ?ASSERT_EX(
+        "Unable to retrieve map connCreateParams from arg5",
+        dpiCall(
+            TestCtx, conn_create, [Context, User, Password, Tns, CP, badMap]
+        )
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve DPI_MODE_CREATE atom from arg4",
+        dpiCall(
+            TestCtx, conn_create,
+            [Context, User, Password, Tns, CP#{createMode => [badAtom]}, #{}]
+        )
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve DPI_MODE_AUTH atom from arg5",
+        dpiCall(
+            TestCtx, conn_create,
+            [Context, User, Password, Tns, CP, #{authMode => [badAtom]}]
+        )
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve DPI_PURITY atom from arg5",
+        dpiCall(
+            TestCtx, conn_create,
+            [Context, User, Password, Tns, CP, #{purity => badAtom}]
+        )
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint connCreateParams.stmtCacheSize from arg5",
+        dpiCall(
+            TestCtx, conn_create,
+            [Context, User, Password, Tns, CP, #{stmtCacheSize => -1}]
+        )
+    ),
     Conn = dpiCall(
         TestCtx, conn_create, [Context, User, Password, Tns, CP, #{}]
     ),
     ?assert(is_reference(Conn)),
     dpiCall(TestCtx, conn_close, [Conn, [], <<>>]),
+    Conn1 = dpiCall(
+        TestCtx, conn_create,
+        [
+            Context, User, Password, Tns,
+            CP#{createMode => ['DPI_MODE_CREATE_DEFAULT'],
+                driverName => "oranif"},
+            #{authMode => ['DPI_MODE_AUTH_DEFAULT'],
+              purity => 'DPI_PURITY_DEFAULT', externalAuth => false,
+              stmtCacheSize => 7}
+        ]
+    ),
+    ?assertEqual(7, dpiCall(TestCtx, conn_getStmtCacheSize, [Conn1])),
+    dpiCall(TestCtx, conn_close, [Conn1, [], <<>>]),
     dpiCall(TestCtx, context_destroy, [Context]).
 
 connPrepareStmt(#{session := Conn} = TestCtx) ->
@@ -255,7 +302,7 @@ connNewVar(#{session := Conn} = TestCtx) ->
         )
     ),
     ?ASSERT_EX(
-        "Unable to retrieve atom objType from arg7",
+        "Unable to retrieve resource objectType or atom null objType from arg7",
         dpiCall(
             TestCtx, conn_newVar,
             [
@@ -284,10 +331,15 @@ connNewVar(#{session := Conn} = TestCtx) ->
     ),
     ?assert(is_reference(Var)),
     ?assert(is_list(Data)),
-    [FirstData | _] = Data,
-    ?assert(is_reference(FirstData)),
+    ?assertEqual(100, length(Data)),
+    [{Var, 0} = FirstData | _] = Data,
+    ?assert(is_tuple(FirstData)),
     [dpiCall(TestCtx, data_release, [X]) || X <- Data],
-    dpiCall(TestCtx, var_release, [Var]).
+    dpiCall(TestCtx, var_release, [Var]),
+    ?ASSERT_EX(
+        "Unable to retrieve resource data from arg0",
+        dpiCall(TestCtx, data_get, [FirstData])
+    ).
 
 connCommit(#{context := Context, session := Conn} = TestCtx) ->
     ?ASSERT_EX(
@@ -328,227 +380,1592 @@ connPing(#{context := Context, session := Conn} = TestCtx) ->
     Result = dpiCall(TestCtx, conn_ping, [Conn]),
     ?assertEqual(ok, Result).
   
+connHealthCheck(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_startHealthCheck, [?BAD_REF, 10])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint interval from arg1",
+        dpiCall(TestCtx, conn_startHealthCheck, [Conn, 0])
+    ),
+    ?ASSERT_EX(
+        "health check not running",
+        dpiCall(TestCtx, conn_getHealth, [Conn])
+    ),
+    ok = dpiCall(TestCtx, conn_startHealthCheck, [Conn, 1000]),
+    #{state := unchecked, checks := 0, error := null} =
+        dpiCall(TestCtx, conn_getHealth, [Conn]),
+    % restarting only changes the interval
+    ok = dpiCall(TestCtx, conn_startHealthCheck, [Conn, 20]),
+    timer:sleep(500),
+    #{state := alive, checks := Checks, lastCheck := LastCheck} =
+        dpiCall(TestCtx, conn_getHealth, [Conn]),
+    ?assert(Checks > 0),
+    ?assert(LastCheck > 0),
+    % the connection stays usable while being checked
+    ok = dpiCall(TestCtx, conn_ping, [Conn]),
+    ok = dpiCall(TestCtx, conn_stopHealthCheck, [Conn]),
+    ok = dpiCall(TestCtx, conn_stopHealthCheck, [Conn]),
+    ?ASSERT_EX(
+        "health check not running",
+        dpiCall(TestCtx, conn_getHealth, [Conn])
+    ).
+
+connStmtCacheSize(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_getStmtCacheSize, [?BAD_REF])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint cacheSize from arg1",
+        dpiCall(TestCtx, conn_setStmtCacheSize, [Conn, ?BAD_INT])
+    ),
+    Size = dpiCall(TestCtx, conn_getStmtCacheSize, [Conn]),
+    ok = dpiCall(TestCtx, conn_setStmtCacheSize, [Conn, 40]),
+    ?assertEqual(40, dpiCall(TestCtx, conn_getStmtCacheSize, [Conn])),
+    ok = dpiCall(TestCtx, conn_setStmtCacheSize, [Conn, Size]).
+
+connCachedQuery(#{session := Conn} = TestCtx) ->
+    Sql = <<"select /*+ RESULT_CACHE */ :1 + 1, :2 from dual">>,
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_cachedQuery, [?BAD_REF, Sql, [], 0])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve binary/string sql from arg1",
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, badBin, [], 0])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list binds of integer/float/binary/null from arg2",
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, Sql, [badAtom, 1], 0])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint ttl from arg3",
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, Sql, [], ?BAD_INT])
+    ),
+    ?ASSERT_EX(
+        "statement is not a query",
+        dpiCall(
+            TestCtx, conn_cachedQuery, [Conn, <<"begin null; end;">>, [], 0]
+        )
+    ),
+    ?ASSERT_EX(
+        #{message := "ORA-00923" ++ _},
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, <<"select">>, [], 0])
+    ),
+    ok = dpiCall(TestCtx, conn_cacheInvalidate, [Conn]),
+    Binds = [1, <<"a">>],
+    #{rows := [[2.0, <<"a">>]] = Rows, cached := false} =
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, Sql, Binds, 60000]),
+    #{rows := Rows, cached := true} =
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, Sql, Binds, 60000]),
+    % other binds are another key
+    #{cached := false} =
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, Sql, [2, null], 60000]),
+    % the failed calls above were misses too
+    #{hits := 1, misses := 4, entries := 2} =
+        dpiCall(TestCtx, conn_cacheStats, [Conn]),
+    % a rejected PL/SQL block never runs
+    ?ASSERT_EX(
+        "statement is not a query",
+        dpiCall(
+            TestCtx, conn_cachedQuery,
+            [Conn,
+             <<"begin dbms_application_info.set_client_info('cached'); end;">>,
+             [], 0]
+        )
+    ),
+    #{rows := [[ClientInfo]]} = dpiCall(
+        TestCtx, conn_cachedQuery,
+        [Conn, <<"select sys_context('userenv', 'client_info') from dual">>,
+         [], 0]
+    ),
+    ?assertNotEqual(<<"cached">>, ClientInfo),
+    % expired entries are refreshed
+    #{cached := false} =
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, Sql, [3, null], 1]),
+    timer:sleep(10),
+    #{cached := false} =
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, Sql, [3, null], 1]),
+    ok = dpiCall(TestCtx, conn_cacheInvalidate, [Conn]),
+    #{entries := 0} = dpiCall(TestCtx, conn_cacheStats, [Conn]),
+    #{cached := false} =
+        dpiCall(TestCtx, conn_cachedQuery, [Conn, Sql, Binds, 0]),
+    #{entries := 0} = dpiCall(TestCtx, conn_cacheStats, [Conn]),
+    ?ASSERT_EX(
+        "query result exceeds the cache row limit",
+        dpiCall(
+            TestCtx, conn_cachedQuery,
+            [
+                Conn, <<"select level from dual connect by level <= 10001">>,
+                [], 60000
+            ]
+        )
+    ),
+    #{entries := 0} = dpiCall(TestCtx, conn_cacheStats, [Conn]).
+
+connTransaction(#{context := Context, session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_transaction, [?BAD_REF, []])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list of {sql or statement, binds} from arg1",
+        dpiCall(TestCtx, conn_transaction, [Conn, []])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list binds of integer/float/binary/null from arg1",
+        dpiCall(
+            TestCtx, conn_transaction,
+            [Conn, [{<<"select 1 from dual">>, [bad]}]]
+        )
+    ),
+    ?EXEC_STMT(Conn, <<"drop table oranif_test">>),
+    0 = ?EXEC_STMT(
+        Conn, <<"create table oranif_test (col1 number primary key)">>
+    ),
+    Insert = <<"insert into oranif_test values(:1)">>,
+    Select = <<"select col1 from oranif_test order by col1">>,
+    Stmt = dpiCall(TestCtx, conn_prepareStmt, [Conn, false, Insert, <<>>]),
+    ?assertEqual(
+        [1, 1, [[1.0], [2.0]]],
+        dpiCall(
+            TestCtx, conn_transaction,
+            [Conn, [{Insert, [1]}, {Stmt, [2]}, {Select, []}]]
+        )
+    ),
+    % the duplicate rolls back the insert of 3 as well
+    ?assertException(
+        error, {error, _File, _Line, #{code := 1, statement := 1}},
+        dpiCall(TestCtx, conn_transaction, [Conn, [{Stmt, [3]}, {Stmt, [1]}]])
+    ),
+    ?assertEqual(
+        [[[1.0], [2.0]]],
+        dpiCall(TestCtx, conn_transaction, [Conn, [{Select, []}]])
+    ),
+    % another session only sees committed rows
+    #{tns := Tns, user := User, password := Password} = getConfig(),
+    Conn1 = dpiCall(
+        TestCtx, conn_create,
+        [
+            Context, User, Password, Tns,
+            #{encoding => "AL32UTF8", nencoding => "AL32UTF8"}, #{}
+        ]
+    ),
+    % a last query is checked before the commit, the insert of 4 is lost
+    ?ASSERT_EX(
+        "query of statement 1 exceeds the row limit",
+        dpiCall(
+            TestCtx, conn_transaction,
+            [Conn, [
+                {Insert, [4]},
+                {<<"select level from dual connect by level <= 10001">>, []}
+            ]]
+        )
+    ),
+    ?assertEqual(
+        [[[1.0], [2.0]]],
+        dpiCall(TestCtx, conn_transaction, [Conn1, [{Select, []}]])
+    ),
+    % and commits once its rows are fetched
+    ?assertEqual(
+        [1, [[1.0], [2.0], [5.0]]],
+        dpiCall(
+            TestCtx, conn_transaction, [Conn, [{Insert, [5]}, {Select, []}]]
+        )
+    ),
+    ?assertEqual(
+        [[[1.0], [2.0], [5.0]]],
+        dpiCall(TestCtx, conn_transaction, [Conn1, [{Select, []}]])
+    ),
+    ok = dpiCall(
+        TestCtx, conn_close, [Conn1, ['DPI_MODE_CONN_CLOSE_DEFAULT'], <<>>]
+    ),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    ?EXEC_STMT(Conn, <<"drop table oranif_test">>).
+
+connInjectLatency(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve uint latency from arg0",
+        dpiCall(TestCtx, inject_latency, [?BAD_INT])
+    ),
+    ok = dpiCall(TestCtx, inject_latency, [500]),
+    Self = self(),
+    Pids = [
+        spawn(
+            fun() ->
+                Self ! {self(), timer:tc(
+                    fun() -> dpiCall(TestCtx, conn_commit, [Conn]) end
+                )}
+            end
+        )
+        || _ <- lists:seq(1, 8)
+    ],
+    timer:sleep(100),
+    % the commits are stuck on dirty IO schedulers, the normal ones still
+    % serve NIFs immediately
+    {Micros, _} = timer:tc(
+        fun() -> dpiCall(TestCtx, resource_count, []) end
+    ),
+    ?assert(Micros < 250000),
+    % every commit got the latency, so each one really waited somewhere
+    [
+        receive
+            {Pid, {CommitMicros, ok}} -> ?assert(CommitMicros >= 500000)
+        after 10000 -> error(timeout)
+        end
+     || Pid <- Pids
+    ],
+    ok = dpiCall(TestCtx, inject_latency, [0]).
+
+connMemoryLimit(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve pos_integer or atom infinity limit from arg0",
+        dpiCall(TestCtx, memory_limit, [0])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_memoryUsage, [?BAD_REF])
+    ),
+    NewVar = fun() ->
+        dpiCall(
+            TestCtx, conn_newVar,
+            [Conn, 'DPI_ORACLE_TYPE_RAW', 'DPI_NATIVE_TYPE_BYTES', 100, 1000,
+             true, false, null]
+        )
+    end,
+    ConnBytes0 = dpiCall(TestCtx, conn_memoryUsage, [Conn]),
+    #{variable := VarBytes0, limit := infinity} =
+        dpiCall(TestCtx, memory_usage, []),
+    #{var := Var} = NewVar(),
+    ConnBytes1 = dpiCall(TestCtx, conn_memoryUsage, [Conn]),
+    ?assert(ConnBytes1 - ConnBytes0 >= 100 * 1000),
+    #{variable := VarBytes1, total := Total} =
+        dpiCall(TestCtx, memory_usage, []),
+    ?assertEqual(ConnBytes1 - ConnBytes0, VarBytes1 - VarBytes0),
+    ok = dpiCall(TestCtx, memory_limit, [Total + 1000]),
+    ?ASSERT_EX("native memory limit exceeded", NewVar()),
+    Data = dpiCall(TestCtx, data_ctor, []),
+    #{data := DataBytes0} = dpiCall(TestCtx, memory_usage, []),
+    % large binaries are kept alive by the data resource, they count too
+    ?ASSERT_EX(
+        "native memory limit exceeded",
+        dpiCall(TestCtx, data_setBytes, [Data, binary:copy(<<0>>, 2000)])
+    ),
+    ok = dpiCall(TestCtx, data_setBytes, [Data, binary:copy(<<0>>, 800)]),
+    ?assertMatch(
+        #{data := D} when D == DataBytes0 + 800,
+        dpiCall(TestCtx, memory_usage, [])
+    ),
+    % replacing the binary releases the charge of the earlier one
+    ok = dpiCall(TestCtx, data_setBytes, [Data, <<"small">>]),
+    ?assertMatch(
+        #{data := D} when D == DataBytes0 + 5,
+        dpiCall(TestCtx, memory_usage, [])
+    ),
+    ok = dpiCall(TestCtx, memory_limit, [infinity]),
+    ok = dpiCall(TestCtx, data_release, [Data]),
+    ok = dpiCall(TestCtx, var_release, [Var]),
+    ?assertEqual(ConnBytes0, dpiCall(TestCtx, conn_memoryUsage, [Conn])),
+    ?assertMatch(
+        #{variable := VarBytes0}, dpiCall(TestCtx, memory_usage, [])
+    ).
+
 connClose(#{context := Context, session := Conn} = TestCtx) ->
     ?ASSERT_EX(
         "Unable to retrieve resource connection from arg0",
         dpiCall(TestCtx, conn_close, [?BAD_REF, [], <<>>])
     ),
-    ?ASSERT_EX(
-        "Unable to retrieve atom list modes, not a list from arg1",
-        dpiCall(TestCtx, conn_close, [Conn, badList, <<>>])
+    ?ASSERT_EX(
+        "Unable to retrieve atom list modes, not a list from arg1",
+        dpiCall(TestCtx, conn_close, [Conn, badList, <<>>])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve mode list value from arg1",
+        dpiCall(TestCtx, conn_close, [Conn, ["badAtom"], <<>>])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve DPI_MODE atom from arg1",
+        dpiCall(TestCtx, conn_close, [Conn, [wrongAtom], <<>>])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve binary/string tag from arg2",
+        dpiCall(TestCtx, conn_close, [Conn, [], badBinary])
+    ),
+    % fails due to the reference being wrong
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_close, [Context, [], <<>>])
+    ),
+    #{tns := Tns, user := User, password := Password} = getConfig(),
+    Conn1 = dpiCall(
+        TestCtx, conn_create,
+        [
+            Context, User, Password, Tns,
+            #{encoding => "AL32UTF8", nencoding => "AL32UTF8"}, #{}
+        ]
+    ),
+    % the other two don't work without a session pool
+    Result = dpiCall(
+        TestCtx, conn_close, [Conn1, ['DPI_MODE_CONN_CLOSE_DEFAULT'], <<>>]
+    ),
+    ?assertEqual(ok, Result).
+
+connGetServerVersion(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_getServerVersion, [?BAD_REF])
+    ),
+    #{
+        releaseNum := ReleaseNum, versionNum := VersionNum,
+        fullVersionNum := FullVersionNum, portReleaseNum := PortReleaseNum,
+        portUpdateNum := PortUpdateNum, releaseString := ReleaseString
+    } = dpiCall(TestCtx, conn_getServerVersion, [Conn]),
+    ?assert(is_integer(ReleaseNum)),
+    ?assert(is_integer(VersionNum)),
+    ?assert(is_integer(FullVersionNum)),
+    ?assert(is_integer(PortReleaseNum)),
+    ?assert(is_integer(PortUpdateNum)),
+    ?assert(is_list(ReleaseString)).
+
+connSetClientIdentifier(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_setClientIdentifier, [?BAD_REF, <<"myCoolConn">>])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve string/binary value from arg1",
+        dpiCall(TestCtx, conn_setClientIdentifier, [Conn, badBinary])
+    ),
+    ?assertEqual(ok,
+        dpiCall(TestCtx, conn_setClientIdentifier, [Conn, <<"myCoolConn">>])
+    ).
+
+connSessionAttrs(#{session := Conn} = TestCtx) ->
+    Setters = [
+        conn_setClientIdentifier, conn_setModule, conn_setAction,
+        conn_setClientInfo, conn_setDbOp
+    ],
+    [
+        ?ASSERT_EX(
+            "Unable to retrieve string/binary value from arg1",
+            dpiCall(TestCtx, Setter, [Conn, badBinary])
+        )
+     || Setter <- Setters
+    ],
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_sessionAttrStats, [?BAD_REF])
+    ),
+    #{sent := Sent0, skipped := Skipped0} =
+        dpiCall(TestCtx, conn_sessionAttrStats, [Conn]),
+    [ok = dpiCall(TestCtx, Setter, [Conn, <<"first">>]) || Setter <- Setters],
+    % unchanged values aren't handed to ODPI-C again
+    [ok = dpiCall(TestCtx, Setter, [Conn, <<"first">>]) || Setter <- Setters],
+    ok = dpiCall(TestCtx, conn_setAction, [Conn, <<"second">>]),
+    ok = dpiCall(TestCtx, conn_setAction, [Conn, <<>>]),
+    ok = dpiCall(TestCtx, conn_setAction, [Conn, <<>>]),
+    #{sent := Sent1, skipped := Skipped1} =
+        dpiCall(TestCtx, conn_sessionAttrStats, [Conn]),
+    ?assertEqual({7, 6}, {Sent1 - Sent0, Skipped1 - Skipped0}),
+    % the attributes go along with the next round trip
+    ?assertEqual(ok, dpiCall(TestCtx, conn_ping, [Conn])),
+    % plain SQL can't change them, the remembered values are kept
+    Query = dpiCall(
+        TestCtx, conn_prepareStmt, [Conn, false, <<"select 1 from dual">>, <<>>]
+    ),
+    1 = dpiCall(TestCtx, stmt_execute, [Query, []]),
+    ok = dpiCall(TestCtx, stmt_close, [Query, <<>>]),
+    ok = dpiCall(TestCtx, conn_setAction, [Conn, <<>>]),
+    ?assertMatch(
+        #{sent := Sent1, skipped := Skipped2} when Skipped2 == Skipped1 + 1,
+        dpiCall(TestCtx, conn_sessionAttrStats, [Conn])
+    ),
+    % PL/SQL may change them, so its execute forgets the remembered values
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [Conn, false,
+         <<"begin dbms_application_info.set_action('plsql'); end;">>, <<>>]
+    ),
+    0 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    ok = dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    ok = dpiCall(TestCtx, conn_setAction, [Conn, <<>>]),
+    ?assertMatch(
+        #{sent := Sent2} when Sent2 == Sent1 + 1,
+        dpiCall(TestCtx, conn_sessionAttrStats, [Conn])
+    ).
+
+%-------------------------------------------------------------------------------
+% Statement APIs
+%-------------------------------------------------------------------------------
+
+stmtExecuteMany_varGetReturnedData(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_executeMany, [?BAD_REF, [], 0])
+    ),
+    StmtDrop = dpiCall(
+        TestCtx, conn_prepareStmt, 
+        [Conn, false, <<"drop table oranif_test">>, <<>>]
+    ),
+    catch dpiCall(TestCtx, stmt_execute, [StmtDrop, []]),
+    catch dpiCall(TestCtx, stmt_close, [StmtDrop, <<>>]),
+    StmtCreate = dpiCall(
+        TestCtx, conn_prepareStmt, 
+        [Conn, false, <<"create table oranif_test (col1 varchar2(100))">>, <<>>]
+    ),
+    0 = dpiCall(TestCtx, stmt_execute, [StmtCreate, []]),
+    ok = dpiCall(TestCtx, stmt_close, [StmtCreate, <<>>]),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt, 
+        [
+            Conn, false,
+            <<
+                "insert into oranif_test values(:col1)"
+                " returning rowid into :rid"
+            >>,
+            <<>>
+        ]
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list of atoms from arg1",
+        dpiCall(TestCtx, stmt_executeMany, [Stmt, badList, 0])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint32 numIters from arg2",
+        dpiCall(TestCtx, stmt_executeMany, [Stmt, [], ?BAD_INT])
+    ),
+    ?ASSERT_EX(
+        "mode must be a list of atoms",
+        dpiCall(TestCtx, stmt_executeMany, [Stmt, ["badAtom"], 0])
+    ),
+    #{var := Var} = dpiCall(
+        TestCtx, conn_newVar,
+        [
+            Conn, 'DPI_ORACLE_TYPE_VARCHAR', 'DPI_NATIVE_TYPE_BYTES', 10,
+            10, true, false, null
+        ]
+    ),
+    #{var := VarRowId} = dpiCall(
+        TestCtx, conn_newVar,
+        [
+            Conn, 'DPI_ORACLE_TYPE_ROWID', 'DPI_NATIVE_TYPE_ROWID',
+            10, 0, false, false, null
+        ]
+    ),
+    dpiCall(TestCtx, stmt_bindByName, [Stmt, <<"col1">>, Var]),
+    dpiCall(TestCtx, stmt_bindByName, [Stmt, <<"rid">>, VarRowId]),
+    Data = lists:seq($0, $z),
+    DataLen = length(Data),
+    Indices = lists:seq(0, 9),
+    rand:seed(exsplus, {0, 0, 0}),
+    [dpiCall(
+        TestCtx, var_setFromBytes,
+        [
+            Var, Idx,
+            << <<(lists:nth(rand:uniform(DataLen), Data))>>
+                || _ <- lists:seq(1, 10) >>
+        ]
+    ) || Idx <- Indices],
+    ?assertEqual(
+        ok,
+        dpiCall(
+            TestCtx, stmt_executeMany,
+            [Stmt, ['DPI_MODE_EXEC_COMMIT_ON_SUCCESS'], 10]
+        )
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource var from arg0",
+        dpiCall(TestCtx, var_getReturnedData, [?BAD_REF, 0])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint pos from arg1",
+        dpiCall(TestCtx, var_getReturnedData, [VarRowId, ?BAD_INT])
+    ),
+    [begin
+        Result = dpiCall(TestCtx, var_getReturnedData, [VarRowId, Idx]),
+        ?assertMatch(#{numElements := 1, data := [_]}, Result),
+        [D] = maps:get(data, Result),
+        ?assert(byte_size(dpiCall(TestCtx, data_get, [D])) > 0)
+    end || Idx <- Indices],
+    ?ASSERT_EX(
+        "Unable to retrieve resource var from arg0",
+        dpiCall(TestCtx, var_getReturnedValues, [?BAD_REF, 10])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint numIters from arg1",
+        dpiCall(TestCtx, var_getReturnedValues, [VarRowId, ?BAD_INT])
+    ),
+    ReturnedValues = dpiCall(
+        TestCtx, var_getReturnedValues, [VarRowId, 10]
+    ),
+    ?assertEqual(10, length(ReturnedValues)),
+    [?assertMatch([RowId] when is_binary(RowId), Values)
+     || Values <- ReturnedValues],
+    dpiCall(TestCtx, var_release, [Var]),
+    dpiCall(TestCtx, var_release, [VarRowId]),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
+
+stmtGetRowCounts_getBatchErrors(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_getRowCounts, [?BAD_REF])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_getBatchErrors, [?BAD_REF])
+    ),
+    ?EXEC_STMT(Conn, <<"drop table oranif_test">>),
+    0 = ?EXEC_STMT(
+        Conn, <<"create table oranif_test (col1 number primary key)">>
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [Conn, false, <<"insert into oranif_test values(:col1)">>, <<>>]
+    ),
+    #{var := Var, data := Data} = dpiCall(
+        TestCtx, conn_newVar,
+        [
+            Conn, 'DPI_ORACLE_TYPE_NATIVE_INT', 'DPI_NATIVE_TYPE_INT64', 5, 0,
+            false, false, null
+        ]
+    ),
+    % third row violates the primary key
+    [ok = dpiCall(TestCtx, data_setInt64, [D, V])
+     || {D, V} <- lists:zip(Data, [1, 2, 2, 3, 4])],
+    ok = dpiCall(TestCtx, stmt_bindByPos, [Stmt, 1, Var]),
+    ok = dpiCall(
+        TestCtx, stmt_executeMany,
+        [
+            Stmt,
+            ['DPI_MODE_EXEC_BATCH_ERRORS', 'DPI_MODE_EXEC_ARRAY_DML_ROWCOUNTS'],
+            5
+        ]
+    ),
+    ?assertEqual([1, 1, 0, 1, 1], dpiCall(TestCtx, stmt_getRowCounts, [Stmt])),
+    ?assertMatch(
+        [#{offset := 2, code := 1}],
+        dpiCall(TestCtx, stmt_getBatchErrors, [Stmt])
+    ),
+    [dpiCall(TestCtx, data_release, [D]) || D <- Data],
+    dpiCall(TestCtx, var_release, [Var]),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    dpiCall(TestCtx, conn_rollback, [Conn]).
+
+stmtExecute(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_execute, [?BAD_REF, []])
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt, 
+        [Conn, false, <<"select 1 from dual">>, <<>>]
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list of atoms from arg1",
+        dpiCall(TestCtx, stmt_execute, [Stmt, badList])
+    ),
+    ?ASSERT_EX(
+        "mode must be a list of atoms",
+        dpiCall(TestCtx, stmt_execute, [Stmt, ["badAtom"]])
+    ),
+    ?assertEqual(
+        1,
+        dpiCall(
+            TestCtx, stmt_execute, [Stmt, ['DPI_MODE_EXEC_DEFAULT']]
+        )
+    ),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    % fails due to the SQL being invalid
+    Stmt1 = dpiCall(
+        TestCtx, conn_prepareStmt, 
+        [Conn, false, <<"all your base are belong to us">>, <<>>]
+    ),
+    ?ASSERT_EX(
+        #{message := "ORA-00900: invalid SQL statement"},
+        dpiCall(TestCtx, stmt_execute, [Stmt1, []])
+    ),
+    dpiCall(TestCtx, stmt_close, [Stmt1, <<>>]).
+
+stmtFetch(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_fetch, [?BAD_REF])
+    ),
+    % fails due to the reference being of the wrong type
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_fetch, [Conn])
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [Conn, false, <<"select 1337 from dual">>, <<>>]
+    ),
+    dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    #{found := Found, bufferRowIndex := BufferRowIndex} =
+        dpiCall(TestCtx, stmt_fetch, [Stmt]),
+    ?assert(is_atom(Found)),
+    ?assert(is_integer(BufferRowIndex)),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
+
+stmtFetchRows(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_fetchRows, [?BAD_REF, 1])
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [
+            Conn, false,
+            <<
+                "select level, 'row' || level, null, sysdate"
+                " from dual connect by level <= 10"
+            >>,
+            <<>>
+        ]
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint maxRows from arg1",
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, ?BAD_INT])
+    ),
+    4 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    #{rows := Rows, moreRows := true} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 4]),
+    ?assertEqual(4, length(Rows)),
+    [[1.0, <<"row1">>, null, #{year := Year}] | _] = Rows,
+    ?assert(is_integer(Year)),
+    #{rows := Rest, moreRows := false} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 100]),
+    ?assertEqual(6, length(Rest)),
+    ?assertEqual(
+        #{rows => [], moreRows => false},
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 100])
+    ),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    % fails due to the statement not being a query
+    Stmt1 = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [Conn, false, <<"begin null; end;">>, <<>>]
+    ),
+    0 = dpiCall(TestCtx, stmt_execute, [Stmt1, []]),
+    ?ASSERT_EX(
+        "statement is not a query",
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt1, 1])
+    ),
+    dpiCall(TestCtx, stmt_close, [Stmt1, <<>>]).
+
+stmtSetPrefetch(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_setPrefetch, [?BAD_REF, true])
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [
+            Conn, false, <<"select level from dual connect by level <= 10">>,
+            <<>>
+        ]
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve bool/atom enable from arg1",
+        dpiCall(TestCtx, stmt_setPrefetch, [Stmt, badAtom])
+    ),
+    ok = dpiCall(TestCtx, stmt_setPrefetch, [Stmt, true]),
+    % enabling twice keeps the running prefetch
+    ok = dpiCall(TestCtx, stmt_setPrefetch, [Stmt, true]),
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    Rows = lists:append(fetchAllRows(TestCtx, Stmt, 3)),
+    ?assertEqual([[float(L)] || L <- lists:seq(1, 10)], Rows),
+    % re-execution drops the prefetched batch
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    #{rows := [[1.0], [2.0], [3.0], [4.0]], moreRows := true} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 4]),
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    #{rows := [[1.0]], moreRows := true} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1]),
+    % moving the cursor otherwise is refused while a batch is pending
+    ?ASSERT_EX(
+        "prefetch in progress",
+        dpiCall(TestCtx, stmt_fetch, [Stmt])
+    ),
+    % disabling still returns the batch already prefetched
+    ok = dpiCall(TestCtx, stmt_setPrefetch, [Stmt, false]),
+    #{rows := [[2.0]], moreRows := true} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1]),
+    #{rows := [[3.0]], moreRows := true} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1]),
+    #{found := true} = dpiCall(TestCtx, stmt_fetch, [Stmt]),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
+
+fetchAllRows(TestCtx, Stmt, MaxRows) ->
+    case dpiCall(TestCtx, stmt_fetchRows, [Stmt, MaxRows]) of
+        #{rows := Rows, moreRows := true} ->
+            [Rows | fetchAllRows(TestCtx, Stmt, MaxRows)];
+        #{rows := Rows, moreRows := false} -> [Rows]
+    end.
+
+stmtStream(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_stream, [?BAD_REF, self(), 1, 1])
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [
+            Conn, false, <<"select level from dual connect by level <= 10">>,
+            <<>>
+        ]
+    ),
+    Owner = localPid(TestCtx),
+    ?ASSERT_EX(
+        "Unable to retrieve uint batchRows from arg2",
+        dpiCall(TestCtx, stmt_stream, [Stmt, Owner, 0, 1])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint credits from arg3",
+        dpiCall(TestCtx, stmt_stream, [Stmt, Owner, 1, ?BAD_INT])
+    ),
+    ?ASSERT_EX(
+        "statement is not streaming",
+        dpiCall(TestCtx, stmt_streamAck, [Stmt, 1])
+    ),
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    % one credit, so only the first batch arrives before the ack
+    Ref = dpiCall(TestCtx, stmt_stream, [Stmt, Owner, 4, 1]),
+    ?assert(is_reference(Ref)),
+    ?assertEqual([[1.0], [2.0], [3.0], [4.0]], receiveStream(Ref)),
+    ?ASSERT_EX(
+        "statement is streaming",
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1])
+    ),
+    ?assertEqual(timeout, receiveStream(Ref)),
+    ok = dpiCall(TestCtx, stmt_streamAck, [Stmt, 10]),
+    ?assertEqual([[5.0], [6.0], [7.0], [8.0]], receiveStream(Ref)),
+    ?assertEqual([[9.0], [10.0]], receiveStream(Ref)),
+    ?assertEqual(done, receiveStream(Ref)),
+    ok = dpiCall(TestCtx, stmt_streamStop, [Stmt]),
+    % stopping is idempotent
+    ok = dpiCall(TestCtx, stmt_streamStop, [Stmt]),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    Owner ! stop.
+
+stmtOwner(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_setOwner, [?BAD_REF, null])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_getOwner, [?BAD_REF])
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt, [Conn, false, <<"select 1 from dual">>, <<>>]
+    ),
+    ?assertEqual(null, dpiCall(TestCtx, stmt_getOwner, [Stmt])),
+    % the relay is never the caller of the NIFs, in safe mode neither
+    Owner = localPid(TestCtx),
+    ok = dpiCall(TestCtx, stmt_setOwner, [Stmt, Owner]),
+    ?assertEqual(Owner, dpiCall(TestCtx, stmt_getOwner, [Stmt])),
+    ?ASSERT_EX(
+        "statement is owned by another process",
+        dpiCall(TestCtx, stmt_execute, [Stmt, []])
+    ),
+    ?ASSERT_EX(
+        "statement is owned by another process",
+        dpiCall(TestCtx, stmt_setOwner, [Stmt, null])
+    ),
+    % a dead owner gives the statement up
+    Monitor = erlang:monitor(process, Owner),
+    Owner ! stop,
+    receive {'DOWN', Monitor, process, Owner, _} -> ok end,
+    ok = dpiCall(TestCtx, stmt_setOwner, [Stmt, null]),
+    ?assertEqual(null, dpiCall(TestCtx, stmt_getOwner, [Stmt])),
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
+
+scanStart(#{context := Context, session := Conn} = TestCtx) ->
+    % rows generated from dual stand in for a partitioned table
+    Sql = <<
+        "select :partition, level from dual"
+        " connect by level <= :partitions + :partition"
+    >>,
+    Owner = localPid(TestCtx),
+    ?ASSERT_EX(
+        "Unable to retrieve list of resource connection from arg0",
+        dpiCall(TestCtx, scan_start, [[?BAD_REF], Sql, 1, Owner, 1, 1])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint partitions from arg2",
+        dpiCall(TestCtx, scan_start, [[Conn], Sql, 0, Owner, 1, 1])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve local pid or list of local pid owners from arg3",
+        dpiCall(TestCtx, scan_start, [[Conn], Sql, 2, [Owner], 1, 1])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint batchRows from arg4",
+        dpiCall(TestCtx, scan_start, [[Conn], Sql, 1, Owner, 0, 1])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint credits from arg5",
+        dpiCall(TestCtx, scan_start, [[Conn], Sql, 1, Owner, 1, ?BAD_INT])
+    ),
+    #{tns := Tns, user := User, password := Password} = getConfig(),
+    Conn1 = dpiCall(
+        TestCtx, conn_create,
+        [
+            Context, User, Password, Tns,
+            #{encoding => "AL32UTF8", nencoding => "AL32UTF8"}, #{}
+        ]
+    ),
+    #{scan := Scan, ref := Ref} = dpiCall(
+        TestCtx, scan_start, [[Conn, Conn1], Sql, 3, Owner, 2, 100]
+    ),
+    Rows = receiveScan(Ref, 3),
+    ?assertEqual(
+        [
+            {P, [[float(P), float(L)] || L <- lists:seq(1, 3 + P)]}
+         || P <- [0, 1, 2]
+        ],
+        [{P, lists:append(proplists:get_all_values(P, Rows))}
+         || P <- [0, 1, 2]]
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint credits from arg1",
+        dpiCall(TestCtx, scan_ack, [Scan, ?BAD_INT])
+    ),
+    ok = dpiCall(TestCtx, scan_ack, [Scan, 1]),
+    ok = dpiCall(TestCtx, scan_stop, [Scan]),
+    % stopping twice is a no-op
+    ok = dpiCall(TestCtx, scan_stop, [Scan]),
+    ?ASSERT_EX(
+        "scan is stopped", dpiCall(TestCtx, scan_ack, [Scan, 1])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource scan from arg0",
+        dpiCall(TestCtx, scan_stop, [?BAD_REF])
+    ),
+    % an owner killed while the workers wait for credits stops the scan
+    Owner1 = localPid(TestCtx),
+    #{scan := Scan1} = dpiCall(
+        TestCtx, scan_start, [[Conn, Conn1], Sql, 3, Owner1, 2, 0]
+    ),
+    exit(Owner1, kill),
+    ?assertEqual(stopped, waitScanStopped(TestCtx, Scan1, 50)),
+    % the workers have ended, so stopping doesn't wait for them
+    ok = dpiCall(TestCtx, scan_stop, [Scan1]),
+    dpiCall(TestCtx, conn_close, [Conn1, [], <<>>]),
+    Owner ! stop.
+
+waitScanStopped(_TestCtx, _Scan, 0) -> running;
+waitScanStopped(TestCtx, Scan, Tries) ->
+    try dpiCall(TestCtx, scan_ack, [Scan, 0]) of
+        ok ->
+            timer:sleep(100),
+            waitScanStopped(TestCtx, Scan, Tries - 1)
+    catch
+        error:{error, _File, _Line, "scan is stopped"} -> stopped
+    end.
+
+routerRoute(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve list of lists of resource connection from arg0",
+        dpiCall(TestCtx, router_create, [[[Conn], []], {hash, 16}])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve tuple {hash, VNodes} or {range, Bounds} table"
+        " from arg1",
+        dpiCall(TestCtx, router_create, [[[Conn]], {hash, 0}])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve tuple {hash, VNodes} or {range, Bounds} table"
+        " from arg1",
+        dpiCall(TestCtx, router_create, [[[Conn], [Conn]], {range, [1, 2]}])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource router from arg0",
+        dpiCall(TestCtx, router_route, [?BAD_REF, 1])
+    ),
+    % every shard is the test session, routing itself needs no database
+    Shards = fun(N) -> [[Conn] || _ <- lists:seq(1, N)] end,
+    Router3 = dpiCall(TestCtx, router_create, [Shards(3), {hash, 64}]),
+    Router4 = dpiCall(TestCtx, router_create, [Shards(4), {hash, 64}]),
+    ?ASSERT_EX(
+        "Unable to retrieve shard key from arg1",
+        dpiCall(TestCtx, router_route, [Router3, 1.5])
+    ),
+    Keys =
+        lists:seq(1, 1000) ++
+        [integer_to_binary(K) || K <- lists:seq(1, 1000)],
+    Routes = [
+        {
+            dpiCall(TestCtx, router_route, [Router3, K]),
+            dpiCall(TestCtx, router_route, [Router4, K])
+        }
+     || K <- Keys
+    ],
+    ?assertEqual([0, 1, 2], lists:usort([S3 || {S3, _} <- Routes])),
+    % the added shard takes keys from the others, no other key moves
+    Moved = [S4 || {S3, S4} <- Routes, S3 =/= S4],
+    ?assertEqual([3], lists:usort(Moved)),
+    ?assert(length(Moved) < length(Keys) div 2),
+    ?assertEqual(
+        dpiCall(TestCtx, router_route, [Router3, <<"key">>]),
+        dpiCall(TestCtx, router_route, [Router3, <<"key">>])
+    ),
+    RouterR = dpiCall(TestCtx, router_create, [Shards(3), {range, [0, 100]}]),
+    ?assertEqual(
+        [0, 1, 1, 2],
+        [dpiCall(TestCtx, router_route, [RouterR, K]) || K <- [-5, 0, 99, 100]]
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve shard key from arg1",
+        dpiCall(TestCtx, router_route, [RouterR, <<"key">>])
+    ),
+    ?assert(is_reference(dpiCall(TestCtx, router_getConn, [RouterR, 7]))),
+    ?ASSERT_EX(
+        "Unable to retrieve bool/atom scrollable from arg2",
+        dpiCall(
+            TestCtx, router_prepareStmt,
+            [RouterR, 7, bad, <<"select 1 from dual">>, <<>>]
+        )
+    ),
+    Stmt = dpiCall(
+        TestCtx, router_prepareStmt,
+        [RouterR, 7, false, <<"select 1 from dual">>, <<>>]
+    ),
+    ok = dpiCall(TestCtx, router_release, [RouterR]),
+    % the statement keeps its connection
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    ?ASSERT_EX(
+        "router is released",
+        dpiCall(TestCtx, router_route, [RouterR, 7])
+    ),
+    % releasing twice is a no-op
+    ok = dpiCall(TestCtx, router_release, [RouterR]),
+    ok = dpiCall(TestCtx, router_release, [Router3]),
+    ok = dpiCall(TestCtx, router_release, [Router4]).
+
+routerScatter(#{context := Context, session := Conn} = TestCtx) ->
+    #{tns := Tns, user := User, password := Password} = getConfig(),
+    Conn1 = dpiCall(
+        TestCtx, conn_create,
+        [
+            Context, User, Password, Tns,
+            #{encoding => "AL32UTF8", nencoding => "AL32UTF8"}, #{}
+        ]
+    ),
+    Router = dpiCall(TestCtx, router_create, [[[Conn], [Conn1]], {hash, 16}]),
+    Owner = localPid(TestCtx),
+    Sql = <<"select :partition, level from dual connect by level <= 3">>,
+    ?ASSERT_EX(
+        "Unable to retrieve uint batchRows from arg3",
+        dpiCall(TestCtx, router_scatter, [Router, Sql, Owner, 0, 1])
+    ),
+    % the batches of both shards are merged into the stream of the owner
+    #{scan := Scan, ref := Ref} = dpiCall(
+        TestCtx, router_scatter, [Router, Sql, Owner, 2, 100]
+    ),
+    Rows = receiveScan(Ref, 2),
+    ?assertEqual(
+        [{S, [[float(S), float(L)] || L <- [1, 2, 3]]} || S <- [0, 1]],
+        [{S, lists:append(proplists:get_all_values(S, Rows))} || S <- [0, 1]]
+    ),
+    ok = dpiCall(TestCtx, scan_stop, [Scan]),
+    ok = dpiCall(TestCtx, router_release, [Router]),
+    dpiCall(TestCtx, conn_close, [Conn1, [], <<>>]),
+    Owner ! stop.
+
+connSubscribe(#{context := Context, session := Conn} = TestCtx) ->
+    Owner = localPid(TestCtx),
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_subscribe, [?BAD_REF, #{}, Owner])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve map params from arg1",
+        dpiCall(TestCtx, conn_subscribe, [Conn, badMap, Owner])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve pid owner from arg2",
+        dpiCall(TestCtx, conn_subscribe, [Conn, #{}, badPid])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve DPI_SUBSCR_QOS atom from arg1",
+        dpiCall(TestCtx, conn_subscribe, [Conn, #{qos => [badAtom]}, Owner])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve DPI_OPCODE atom from arg1",
+        dpiCall(
+            TestCtx, conn_subscribe, [Conn, #{operations => [badAtom]}, Owner]
+        )
+    ),
+    #{tns := Tns, user := User, password := Password} = getConfig(),
+    Conn1 = dpiCall(
+        TestCtx, conn_create,
+        [
+            Context, User, Password, Tns,
+            #{encoding => "AL32UTF8", nencoding => "AL32UTF8",
+              createMode => ['DPI_MODE_CREATE_EVENTS']},
+            #{}
+        ]
+    ),
+    Subscr = dpiCall(
+        TestCtx, conn_subscribe,
+        [
+            Conn1,
+            #{qos => ['DPI_SUBSCR_QOS_QUERY', 'DPI_SUBSCR_QOS_ROWIDS'],
+              operations => ['DPI_OPCODE_ALL_OPS'], timeout => 60},
+            Owner
+        ]
+    ),
+    Stmt = dpiCall(
+        TestCtx, subscr_prepareStmt, [Subscr, <<"select 1 from dual">>]
+    ),
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    % the stub backend feeds synthetic events through the OCI callback path
+    ?ASSERT_EX(
+        "Unable to retrieve DPI_EVENT atom from arg1",
+        dpiCall(TestCtx, subscr_notify, [Subscr, badAtom, []])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list tables of {Name, Rowids} from arg2",
+        dpiCall(
+            TestCtx, subscr_notify, [Subscr, 'DPI_EVENT_OBJCHANGE', [bad]]
+        )
+    ),
+    ok = dpiCall(
+        TestCtx, subscr_notify,
+        [
+            Subscr, 'DPI_EVENT_OBJCHANGE',
+            [{<<"SCOTT.EMP">>, [<<"AAAR1">>, <<"AAAR2">>]}, {<<"T">>, []}]
+        ]
+    ),
+    receive
+        {dpi_subscr, _, Msg} ->
+            ?assertMatch(
+                #{eventType := 'DPI_EVENT_OBJCHANGE', error := null,
+                  queries := [],
+                  tables := [
+                      #{name := <<"SCOTT.EMP">>,
+                        operation := ['DPI_OPCODE_UPDATE'],
+                        rows := [#{rowid := <<"AAAR1">>},
+                                 #{rowid := <<"AAAR2">>}]},
+                      #{name := <<"T">>, rows := []}
+                  ]},
+                Msg
+            )
+    after 1000 -> error(timeout)
+    end,
+    ?ASSERT_EX(
+        "subscription belongs to another connection",
+        dpiCall(TestCtx, conn_unsubscribe, [Conn, Subscr])
+    ),
+    ok = dpiCall(TestCtx, conn_unsubscribe, [Conn1, Subscr]),
+    ?ASSERT_EX(
+        "subscription is closed",
+        dpiCall(TestCtx, conn_unsubscribe, [Conn1, Subscr])
+    ),
+    ?ASSERT_EX(
+        "subscription is closed",
+        dpiCall(TestCtx, subscr_prepareStmt, [Subscr, <<"select 1 from dual">>])
+    ),
+    % closed subscriptions drop events
+    ok = dpiCall(
+        TestCtx, subscr_notify, [Subscr, 'DPI_EVENT_DEREG', []]
+    ),
+    receive {dpi_subscr, _, _} -> error(unexpected)
+    after 100 -> ok
+    end,
+    dpiCall(TestCtx, conn_close, [Conn1, [], <<>>]),
+    Owner ! stop.
+
+queueEnqDeqMany(#{session := Conn} = TestCtx) ->
+    Queue = <<"ORANIF_TEST_Q">>,
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, queue_enqMany, [?BAD_REF, Queue, [<<"a">>]])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve binary/string queueName from arg1",
+        dpiCall(TestCtx, queue_enqMany, [Conn, badBin, [<<"a">>]])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list payloads from arg2",
+        dpiCall(TestCtx, queue_enqMany, [Conn, Queue, []])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list of binary payloads from arg2",
+        dpiCall(TestCtx, queue_enqMany, [Conn, Queue, [<<"a">>, badBin]])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint maxMessages from arg2",
+        dpiCall(TestCtx, queue_deqMany, [Conn, Queue, 0, 10, 0])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint maxSize from arg3",
+        dpiCall(TestCtx, queue_deqMany, [Conn, Queue, 1, 32768, 0])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve int wait from arg4",
+        dpiCall(TestCtx, queue_deqMany, [Conn, Queue, 1, 10, -2])
+    ),
+    ?EXEC_STMT(
+        Conn,
+        <<"begin"
+          " dbms_aqadm.stop_queue('ORANIF_TEST_Q');"
+          " dbms_aqadm.drop_queue('ORANIF_TEST_Q');"
+          " dbms_aqadm.drop_queue_table('ORANIF_TEST_QT');"
+          " exception when others then null; end;">>
+    ),
+    0 = ?EXEC_STMT(
+        Conn,
+        <<"begin"
+          " dbms_aqadm.create_queue_table('ORANIF_TEST_QT', 'RAW');"
+          " dbms_aqadm.create_queue('ORANIF_TEST_Q', 'ORANIF_TEST_QT');"
+          " dbms_aqadm.start_queue('ORANIF_TEST_Q');"
+          " end;">>
+    ),
+    Payloads = [
+        <<"{\"id\":", (integer_to_binary(I))/binary, "}">>
+     || I <- lists:seq(1, 500)
+    ],
+    500 = dpiCall(TestCtx, queue_enqMany, [Conn, Queue, Payloads]),
+    ok = dpiCall(TestCtx, conn_commit, [Conn]),
+    {First, Rest} = lists:split(200, Payloads),
+    ?assertEqual(
+        First, dpiCall(TestCtx, queue_deqMany, [Conn, Queue, 200, 100, 0])
+    ),
+    % a batch ends early when the queue runs empty
+    ?assertEqual(
+        Rest, dpiCall(TestCtx, queue_deqMany, [Conn, Queue, 1000, 100, 1])
+    ),
+    ?assertEqual(
+        [], dpiCall(TestCtx, queue_deqMany, [Conn, Queue, 10, 100, 0])
+    ),
+    ok = dpiCall(TestCtx, conn_commit, [Conn]),
+    ?ASSERT_EX(
+        #{message := "ORA-24010" ++ _},
+        dpiCall(TestCtx, queue_deqMany, [Conn, <<"NO_SUCH_Q">>, 1, 10, 0])
+    ),
+    0 = ?EXEC_STMT(
+        Conn,
+        <<"begin"
+          " dbms_aqadm.stop_queue('ORANIF_TEST_Q');"
+          " dbms_aqadm.drop_queue('ORANIF_TEST_Q');"
+          " dbms_aqadm.drop_queue_table('ORANIF_TEST_QT');"
+          " end;">>
+    ).
+
+objectCollection(#{session := Conn} = TestCtx) ->
+    0 = ?EXEC_STMT(
+        Conn, <<"create or replace type oranif_num_tab as table of number">>
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_getObjectType, [?BAD_REF, <<"ORANIF_NUM_TAB">>])
+    ),
+    ?ASSERT_EX(
+        #{message := "DPI-1062" ++ _},
+        dpiCall(TestCtx, conn_getObjectType, [Conn, <<"ORANIF_NO_TYPE">>])
+    ),
+    ObjType = dpiCall(
+        TestCtx, conn_getObjectType, [Conn, <<"ORANIF_NUM_TAB">>]
+    ),
+    #{
+        name := "ORANIF_NUM_TAB", isCollection := true,
+        elementOracleTypeNum := 'DPI_ORACLE_TYPE_NUMBER',
+        elementNativeTypeNum := 'DPI_NATIVE_TYPE_DOUBLE'
+    } = dpiCall(TestCtx, objectType_getInfo, [ObjType]),
+    ?ASSERT_EX(
+        "Unable to retrieve resource objectType from arg0",
+        dpiCall(TestCtx, object_fromList, [?BAD_REF, [1]])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list elements of integer/float/binary/null"
+        " from arg1",
+        dpiCall(TestCtx, object_fromList, [ObjType, [1, badAtom]])
+    ),
+    % the whole collection is built and read back in one call each
+    Elements = [1, 2.5, null | lists:seq(4, 1000)],
+    Obj = dpiCall(TestCtx, object_fromList, [ObjType, Elements]),
+    ?assertEqual(1000, dpiCall(TestCtx, object_getSize, [Obj])),
+    ?assertEqual(
+        [if E =:= null -> null; true -> float(E) end || E <- Elements],
+        dpiCall(TestCtx, object_toList, [ObjType, Obj])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource object from arg1",
+        dpiCall(TestCtx, object_toList, [ObjType, ?BAD_REF])
+    ),
+    % bound as one collection instead of one call per row
+    #{var := Var, data := [VarData]} = dpiCall(
+        TestCtx, conn_newVar,
+        [
+            Conn, 'DPI_ORACLE_TYPE_OBJECT', 'DPI_NATIVE_TYPE_OBJECT', 1, 0,
+            false, false, ObjType
+        ]
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource object from arg2",
+        dpiCall(TestCtx, var_setFromObject, [Var, 0, ?BAD_REF])
+    ),
+    ok = dpiCall(TestCtx, var_setFromObject, [Var, 0, Obj]),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [
+            Conn, false,
+            <<"select sum(column_value), count(*) from table(:1)">>, <<>>
+        ]
+    ),
+    ok = dpiCall(TestCtx, stmt_bindByPos, [Stmt, 1, Var]),
+    2 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    #{rows := [[Sum, 1000.0]]} = dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1]),
+    ?assertEqual(lists:sum(lists:seq(4, 1000)) + 3.5, Sum),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    % collections fetched from a query
+    Stmt1 = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [Conn, false, <<"select oranif_num_tab(7, 8, 9) from dual">>, <<>>]
+    ),
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt1, []]),
+    #{typeInfo := #{objectType := QueryObjType}} =
+        dpiCall(TestCtx, stmt_getQueryInfo, [Stmt1, 1]),
+    ?assert(is_reference(QueryObjType)),
+    #{found := true} = dpiCall(TestCtx, stmt_fetch, [Stmt1]),
+    #{nativeTypeNum := 'DPI_NATIVE_TYPE_OBJECT', data := Data} =
+        dpiCall(TestCtx, stmt_getQueryValue, [Stmt1, 1]),
+    FetchedObj = dpiCall(TestCtx, data_get, [Data]),
+    ?assertEqual(
+        [7.0, 8.0, 9.0],
+        dpiCall(TestCtx, object_toList, [QueryObjType, FetchedObj])
+    ),
+    ok = dpiCall(TestCtx, object_release, [FetchedObj]),
+    dpiCall(TestCtx, data_release, [Data]),
+    ok = dpiCall(TestCtx, objectType_release, [QueryObjType]),
+    dpiCall(TestCtx, stmt_close, [Stmt1, <<>>]),
+    dpiCall(TestCtx, data_release, [VarData]),
+    ok = dpiCall(TestCtx, var_release, [Var]),
+    ok = dpiCall(TestCtx, object_release, [Obj]),
+    ok = dpiCall(TestCtx, objectType_release, [ObjType]),
+    ?EXEC_STMT(Conn, <<"drop type oranif_num_tab">>).
+
+connNewArrayVar(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_newArrayVar, [?BAD_REF, null, 1, 0, []])
+    ),
+    ?ASSERT_EX(
+        "wrong or unsupported dpiNativeType type",
+        dpiCall(TestCtx, conn_newArrayVar, [Conn, badAtom, 1, 0, []])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint maxArraySize from arg2",
+        dpiCall(TestCtx, conn_newArrayVar, [Conn, null, 0, 0, []])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint size from arg3",
+        dpiCall(TestCtx, conn_newArrayVar, [Conn, null, 1, ?BAD_INT, []])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list values from arg4",
+        dpiCall(TestCtx, conn_newArrayVar, [Conn, null, 1, 0, [1, 2]])
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list values of nativeTypeNum from arg4",
+        dpiCall(TestCtx, conn_newArrayVar, [Conn, null, 2, 0, [1, <<"a">>]])
+    ),
+    ?ASSERT_EX(
+        "unsupported array nativeTypeNum",
+        dpiCall(
+            TestCtx, conn_newArrayVar,
+            [Conn, 'DPI_NATIVE_TYPE_TIMESTAMP', 1, 0, []]
+        )
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve list values of at most size bytes from arg4",
+        dpiCall(TestCtx, conn_newArrayVar, [Conn, null, 2, 2, [<<"abc">>]])
+    ),
+    0 = ?EXEC_STMT(
+        Conn,
+        <<"create or replace package oranif_arr as"
+          " type num_tab is table of number index by binary_integer;"
+          " type str_tab is table of varchar2(100) index by binary_integer;"
+          " procedure twice(ids in num_tab, doubled out num_tab);"
+          " procedure upper(strs in str_tab, uppers out str_tab);"
+          " end;">>
+    ),
+    0 = ?EXEC_STMT(
+        Conn,
+        <<"create or replace package body oranif_arr as"
+          " procedure twice(ids in num_tab, doubled out num_tab) is begin"
+          " for i in 1 .. ids.count loop doubled(i) := ids(i) * 2; end loop;"
+          " end;"
+          " procedure upper(strs in str_tab, uppers out str_tab) is begin"
+          " for i in 1 .. strs.count loop"
+          " uppers(i) := nls_upper(strs(i)); end loop;"
+          " end;"
+          " end;">>
+    ),
+    Ids = lists:seq(1, 10000),
+    In = dpiCall(TestCtx, conn_newArrayVar, [Conn, null, 10000, 0, Ids]),
+    ?assertEqual(Ids, dpiCall(TestCtx, var_getArrayValues, [In])),
+    Out = dpiCall(
+        TestCtx, conn_newArrayVar,
+        [Conn, 'DPI_NATIVE_TYPE_INT64', 10000, 0, []]
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [Conn, false, <<"begin oranif_arr.twice(:1, :2); end;">>, <<>>]
+    ),
+    ok = dpiCall(TestCtx, stmt_bindByPos, [Stmt, 1, In]),
+    ok = dpiCall(TestCtx, stmt_bindByPos, [Stmt, 2, Out]),
+    0 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    ?assertEqual(
+        [I * 2 || I <- Ids], dpiCall(TestCtx, var_getArrayValues, [Out])
+    ),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    dpiCall(TestCtx, var_release, [In]),
+    dpiCall(TestCtx, var_release, [Out]),
+    % floats mixed with integers and nulls
+    Doubles = dpiCall(
+        TestCtx, conn_newArrayVar,
+        [Conn, 'DPI_NATIVE_TYPE_DOUBLE', 4, 0, [1, 2.5, null]]
+    ),
+    ?assertEqual(
+        [1.0, 2.5, null], dpiCall(TestCtx, var_getArrayValues, [Doubles])
+    ),
+    dpiCall(TestCtx, var_release, [Doubles]),
+    StrIn = dpiCall(
+        TestCtx, conn_newArrayVar, [Conn, null, 3, 0, [<<"a">>, <<"bc">>]]
+    ),
+    StrOut = dpiCall(
+        TestCtx, conn_newArrayVar,
+        [Conn, 'DPI_NATIVE_TYPE_BYTES', 3, 100, []]
+    ),
+    Stmt1 = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [Conn, false, <<"begin oranif_arr.upper(:1, :2); end;">>, <<>>]
+    ),
+    ok = dpiCall(TestCtx, stmt_bindByPos, [Stmt1, 1, StrIn]),
+    ok = dpiCall(TestCtx, stmt_bindByPos, [Stmt1, 2, StrOut]),
+    0 = dpiCall(TestCtx, stmt_execute, [Stmt1, []]),
+    ?assertEqual(
+        [<<"A">>, <<"BC">>], dpiCall(TestCtx, var_getArrayValues, [StrOut])
     ),
+    dpiCall(TestCtx, stmt_close, [Stmt1, <<>>]),
+    dpiCall(TestCtx, var_release, [StrIn]),
+    dpiCall(TestCtx, var_release, [StrOut]),
+    ?EXEC_STMT(Conn, <<"drop package oranif_arr">>).
+
+connVarPool(#{session := Conn} = TestCtx) ->
     ?ASSERT_EX(
-        "Unable to retrieve mode list value from arg1",
-        dpiCall(TestCtx, conn_close, [Conn, ["badAtom"], <<>>])
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_recycleVar, [?BAD_REF, ?BAD_REF])
     ),
     ?ASSERT_EX(
-        "Unable to retrieve DPI_MODE atom from arg1",
-        dpiCall(TestCtx, conn_close, [Conn, [wrongAtom], <<>>])
+        "Unable to retrieve resource var from arg1",
+        dpiCall(TestCtx, conn_recycleVar, [Conn, ?BAD_REF])
     ),
     ?ASSERT_EX(
-        "Unable to retrieve binary/string tag from arg2",
-        dpiCall(TestCtx, conn_close, [Conn, [], badBinary])
+        "Unable to retrieve resource connection from arg0",
+        dpiCall(TestCtx, conn_varPoolStats, [?BAD_REF])
     ),
-    % fails due to the reference being wrong
+    NewVar = fun() ->
+        dpiCall(
+            TestCtx, conn_newVar,
+            [Conn, 'DPI_ORACLE_TYPE_NATIVE_DOUBLE', 'DPI_NATIVE_TYPE_DOUBLE',
+             10, 0, false, false, null]
+        )
+    end,
+    #{hits := Hits0, misses := Misses0} =
+        dpiCall(TestCtx, conn_varPoolStats, [Conn]),
+    #{var := Var, data := [Data | _]} = NewVar(),
+    ok = dpiCall(TestCtx, data_setIsNull, [Data, false]),
+    ?assert(dpiCall(TestCtx, conn_recycleVar, [Conn, Var])),
     ?ASSERT_EX(
-        "Unable to retrieve resource connection from arg0",
-        dpiCall(TestCtx, conn_close, [Context, [], <<>>])
+        "variable is released or can't be pooled",
+        dpiCall(TestCtx, conn_recycleVar, [Conn, Var])
     ),
-    #{tns := Tns, user := User, password := Password} = getConfig(),
-    Conn1 = dpiCall(
-        TestCtx, conn_create,
-        [
-            Context, User, Password, Tns,
-            #{encoding => "AL32UTF8", nencoding => "AL32UTF8"}, #{}
-        ]
+    ?ASSERT_EX(
+        "Unable to retrieve resource data from arg0",
+        dpiCall(TestCtx, data_get, [Data])
     ),
-    % the other two don't work without a session pool
-    Result = dpiCall(
-        TestCtx, conn_close, [Conn1, ['DPI_MODE_CONN_CLOSE_DEFAULT'], <<>>]
+    ?assertMatch(#{idle := 1}, dpiCall(TestCtx, conn_varPoolStats, [Conn])),
+    % same creation parameters reuse the recycled buffers, reset to null
+    #{var := Var1, data := [Data1 | _]} = NewVar(),
+    ?assertEqual(null, dpiCall(TestCtx, data_get, [Data1])),
+    ?assertMatch(
+        #{hits := H, misses := M, idle := 0}
+            when H == Hits0 + 1 andalso M == Misses0 + 1,
+        dpiCall(TestCtx, conn_varPoolStats, [Conn])
     ),
-    ?assertEqual(ok, Result).
-
-connGetServerVersion(#{session := Conn} = TestCtx) ->
+    ok = dpiCall(TestCtx, var_release, [Var1]),
     ?ASSERT_EX(
-        "Unable to retrieve resource connection from arg0",
-        dpiCall(TestCtx, conn_getServerVersion, [?BAD_REF])
+        "variable is released or can't be pooled",
+        dpiCall(TestCtx, conn_recycleVar, [Conn, Var1])
     ),
-    #{
-        releaseNum := ReleaseNum, versionNum := VersionNum,
-        fullVersionNum := FullVersionNum, portReleaseNum := PortReleaseNum,
-        portUpdateNum := PortUpdateNum, releaseString := ReleaseString
-    } = dpiCall(TestCtx, conn_getServerVersion, [Conn]),
-    ?assert(is_integer(ReleaseNum)),
-    ?assert(is_integer(VersionNum)),
-    ?assert(is_integer(FullVersionNum)),
-    ?assert(is_integer(PortReleaseNum)),
-    ?assert(is_integer(PortUpdateNum)),
-    ?assert(is_list(ReleaseString)).
-
-connSetClientIdentifier(#{session := Conn} = TestCtx) ->
-    ?ASSERT_EX(
-        "Unable to retrieve resource connection from arg0",
-        dpiCall(TestCtx, conn_setClientIdentifier, [?BAD_REF, <<"myCoolConn">>])
+    % a variable bound to a statement is pooled only after the close
+    #{var := Var2} = NewVar(),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [Conn, false, <<"select :1 from dual">>, <<>>]
     ),
+    ok = dpiCall(TestCtx, stmt_bindByPos, [Stmt, 1, Var2]),
     ?ASSERT_EX(
-        "Unable to retrieve string/binary value from arg1",
-        dpiCall(TestCtx, conn_setClientIdentifier, [Conn, badBinary])
+        "variable is bound or defined on a statement",
+        dpiCall(TestCtx, conn_recycleVar, [Conn, Var2])
     ),
-    ?assertEqual(ok,
-        dpiCall(TestCtx, conn_setClientIdentifier, [Conn, <<"myCoolConn">>])
-    ).
-
-%-------------------------------------------------------------------------------
-% Statement APIs
-%-------------------------------------------------------------------------------
+    ok = dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
+    ?assert(dpiCall(TestCtx, conn_recycleVar, [Conn, Var2])).
 
-stmtExecuteMany_varGetReturnedData(#{session := Conn} = TestCtx) ->
+stmtScroll(#{session := Conn} = TestCtx) ->
     ?ASSERT_EX(
         "Unable to retrieve resource statement from arg0",
-        dpiCall(TestCtx, stmt_executeMany, [?BAD_REF, [], 0])
-    ),
-    StmtDrop = dpiCall(
-        TestCtx, conn_prepareStmt, 
-        [Conn, false, <<"drop table oranif_test">>, <<>>]
-    ),
-    catch dpiCall(TestCtx, stmt_execute, [StmtDrop, []]),
-    catch dpiCall(TestCtx, stmt_close, [StmtDrop, <<>>]),
-    StmtCreate = dpiCall(
-        TestCtx, conn_prepareStmt, 
-        [Conn, false, <<"create table oranif_test (col1 varchar2(100))">>, <<>>]
+        dpiCall(
+            TestCtx, stmt_scroll, [?BAD_REF, 'DPI_MODE_FETCH_FIRST', 0, 0]
+        )
     ),
-    0 = dpiCall(TestCtx, stmt_execute, [StmtCreate, []]),
-    ok = dpiCall(TestCtx, stmt_close, [StmtCreate, <<>>]),
     Stmt = dpiCall(
-        TestCtx, conn_prepareStmt, 
+        TestCtx, conn_prepareStmt,
         [
-            Conn, false,
-            <<
-                "insert into oranif_test values(:col1)"
-                " returning rowid into :rid"
-            >>,
+            Conn, true, <<"select level from dual connect by level <= 100">>,
             <<>>
         ]
     ),
     ?ASSERT_EX(
-        "Unable to retrieve list of atoms from arg1",
-        dpiCall(TestCtx, stmt_executeMany, [Stmt, badList, 0])
+        "Unable to retrieve DPI_MODE_FETCH atom from arg1",
+        dpiCall(TestCtx, stmt_scroll, [Stmt, badAtom, 0, 0])
     ),
     ?ASSERT_EX(
-        "Unable to retrieve uint32 numIters from arg2",
-        dpiCall(TestCtx, stmt_executeMany, [Stmt, [], ?BAD_INT])
+        "Unable to retrieve int offset from arg2",
+        dpiCall(
+            TestCtx, stmt_scroll, [Stmt, 'DPI_MODE_FETCH_FIRST', ?BAD_INT, 0]
+        )
     ),
     ?ASSERT_EX(
-        "mode must be a list of atoms",
-        dpiCall(TestCtx, stmt_executeMany, [Stmt, ["badAtom"], 0])
-    ),
-    #{var := Var} = dpiCall(
-        TestCtx, conn_newVar,
-        [
-            Conn, 'DPI_ORACLE_TYPE_VARCHAR', 'DPI_NATIVE_TYPE_BYTES', 10,
-            10, true, false, null
-        ]
-    ),
-    #{var := VarRowId} = dpiCall(
-        TestCtx, conn_newVar,
-        [
-            Conn, 'DPI_ORACLE_TYPE_ROWID', 'DPI_NATIVE_TYPE_ROWID',
-            10, 0, false, false, null
-        ]
+        "Unable to retrieve int rowCountOffset from arg3",
+        dpiCall(
+            TestCtx, stmt_scroll, [Stmt, 'DPI_MODE_FETCH_FIRST', 0, ?BAD_INT]
+        )
     ),
-    dpiCall(TestCtx, stmt_bindByName, [Stmt, <<"col1">>, Var]),
-    dpiCall(TestCtx, stmt_bindByName, [Stmt, <<"rid">>, VarRowId]),
-    Data = lists:seq($0, $z),
-    DataLen = length(Data),
-    Indices = lists:seq(0, 9),
-    rand:seed(exsplus, {0, 0, 0}),
-    [dpiCall(
-        TestCtx, var_setFromBytes,
-        [
-            Var, Idx,
-            << <<(lists:nth(rand:uniform(DataLen), Data))>>
-                || _ <- lists:seq(1, 10) >>
-        ]
-    ) || Idx <- Indices],
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    % jump to page 5 of 10 rows each
     ?assertEqual(
         ok,
         dpiCall(
-            TestCtx, stmt_executeMany,
-            [Stmt, ['DPI_MODE_EXEC_COMMIT_ON_SUCCESS'], 10]
+            TestCtx, stmt_scroll, [Stmt, 'DPI_MODE_FETCH_ABSOLUTE', 41, 0]
         )
     ),
-    ?ASSERT_EX(
-        "Unable to retrieve resource var from arg0",
-        dpiCall(TestCtx, var_getReturnedData, [?BAD_REF, 0])
+    #{rows := [[41.0] | _] = Page} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 10]),
+    ?assertEqual([float(R) || R <- lists:seq(41, 50)], [R || [R] <- Page]),
+    ok = dpiCall(TestCtx, stmt_scroll, [Stmt, 'DPI_MODE_FETCH_LAST', 0, 0]),
+    ?assertMatch(
+        #{rows := [[100.0]]}, dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1])
+    ),
+    ok = dpiCall(TestCtx, stmt_scroll, [Stmt, 'DPI_MODE_FETCH_FIRST', 0, 0]),
+    ?assertMatch(
+        #{rows := [[1.0]]}, dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1])
     ),
+    % fails due to the position being out of range
     ?ASSERT_EX(
-        "Unable to retrieve uint pos from arg1",
-        dpiCall(TestCtx, var_getReturnedData, [VarRowId, ?BAD_INT])
+        #{message := "DPI-1027: scroll operation would go out of the"
+                     " result set"},
+        dpiCall(
+            TestCtx, stmt_scroll, [Stmt, 'DPI_MODE_FETCH_ABSOLUTE', 1000, 0]
+        )
     ),
-    [begin
-        Result = dpiCall(TestCtx, var_getReturnedData, [VarRowId, Idx]),
-        ?assertMatch(#{numElements := 1, data := [_]}, Result),
-        [D] = maps:get(data, Result),
-        ?assert(byte_size(dpiCall(TestCtx, data_get, [D])) > 0)
-    end || Idx <- Indices],
-    dpiCall(TestCtx, var_release, [Var]),
-    dpiCall(TestCtx, var_release, [VarRowId]),
     dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
 
-stmtExecute(#{session := Conn} = TestCtx) ->
+stmtGetRowCount(#{session := Conn} = TestCtx) ->
     ?ASSERT_EX(
         "Unable to retrieve resource statement from arg0",
-        dpiCall(TestCtx, stmt_execute, [?BAD_REF, []])
+        dpiCall(TestCtx, stmt_getRowCount, [?BAD_REF])
     ),
     Stmt = dpiCall(
-        TestCtx, conn_prepareStmt, 
-        [Conn, false, <<"select 1 from dual">>, <<>>]
-    ),
-    ?ASSERT_EX(
-        "Unable to retrieve list of atoms from arg1",
-        dpiCall(TestCtx, stmt_execute, [Stmt, badList])
+        TestCtx, conn_prepareStmt,
+        [Conn, false, <<"select level from dual connect by level <= 10">>, <<>>]
     ),
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    ?assertEqual(0, dpiCall(TestCtx, stmt_getRowCount, [Stmt])),
+    dpiCall(TestCtx, stmt_fetchRows, [Stmt, 3]),
+    ?assertEqual(3, dpiCall(TestCtx, stmt_getRowCount, [Stmt])),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
+
+stmtGetImplicitResult(#{session := Conn} = TestCtx) ->
     ?ASSERT_EX(
-        "mode must be a list of atoms",
-        dpiCall(TestCtx, stmt_execute, [Stmt, ["badAtom"]])
-    ),
-    ?assertEqual(
-        1,
-        dpiCall(
-            TestCtx, stmt_execute, [Stmt, ['DPI_MODE_EXEC_DEFAULT']]
-        )
-    ),
-    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]),
-    % fails due to the SQL being invalid
-    Stmt1 = dpiCall(
-        TestCtx, conn_prepareStmt, 
-        [Conn, false, <<"all your base are belong to us">>, <<>>]
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_getImplicitResult, [?BAD_REF])
     ),
-    ?ASSERT_EX(
-        #{message := "ORA-00900: invalid SQL statement"},
-        dpiCall(TestCtx, stmt_execute, [Stmt1, []])
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [Conn, false, <<"select 1 from dual">>, <<>>]
     ),
-    dpiCall(TestCtx, stmt_close, [Stmt1, <<>>]).
+    1 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    % a plain query has no implicit results
+    ?assertEqual(null, dpiCall(TestCtx, stmt_getImplicitResult, [Stmt])),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
 
-stmtFetch(#{session := Conn} = TestCtx) ->
+stmtFetchArraySize(#{session := Conn} = TestCtx) ->
     ?ASSERT_EX(
         "Unable to retrieve resource statement from arg0",
-        dpiCall(TestCtx, stmt_fetch, [?BAD_REF])
+        dpiCall(TestCtx, stmt_getFetchArraySize, [?BAD_REF])
     ),
-    % fails due to the reference being of the wrong type
     ?ASSERT_EX(
         "Unable to retrieve resource statement from arg0",
-        dpiCall(TestCtx, stmt_fetch, [Conn])
+        dpiCall(TestCtx, stmt_setFetchArraySize, [?BAD_REF, 10])
     ),
     Stmt = dpiCall(
         TestCtx, conn_prepareStmt,
-        [Conn, false, <<"select 1337 from dual">>, <<>>]
+        [Conn, false, <<"select 1 from dual">>, <<>>]
     ),
-    dpiCall(TestCtx, stmt_execute, [Stmt, []]),
-    #{found := Found, bufferRowIndex := BufferRowIndex} =
-        dpiCall(TestCtx, stmt_fetch, [Stmt]),
-    ?assert(is_atom(Found)),
-    ?assert(is_integer(BufferRowIndex)),
+    ?ASSERT_EX(
+        "Unable to retrieve uint arraySize from arg1",
+        dpiCall(TestCtx, stmt_setFetchArraySize, [Stmt, ?BAD_INT])
+    ),
+    ?assertEqual(ok, dpiCall(TestCtx, stmt_setFetchArraySize, [Stmt, 1000])),
+    ?assertEqual(1000, dpiCall(TestCtx, stmt_getFetchArraySize, [Stmt])),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
+
+stmtRefCursorFetchRows(#{session := Conn} = TestCtx) ->
+    SQL = <<"
+        BEGIN
+            OPEN :c1 FOR SELECT level FROM dual CONNECT BY level <= 10;
+            OPEN :c2 FOR SELECT 'a', 'b' FROM dual;
+            OPEN :c3 FOR SELECT 1 FROM dual WHERE 1 = 0;
+        END;
+    ">>,
+    Stmt = dpiCall(TestCtx, conn_prepareStmt, [Conn, false, SQL, <<>>]),
+    Cursors = [begin
+        #{var := Var, data := [Data]} = dpiCall(
+            TestCtx, conn_newVar,
+            [
+                Conn, 'DPI_ORACLE_TYPE_STMT', 'DPI_NATIVE_TYPE_STMT', 1, 0,
+                false, false, null
+            ]
+        ),
+        ok = dpiCall(TestCtx, stmt_bindByName, [Stmt, Name, Var]),
+        {Var, Data}
+    end || Name <- [<<"c1">>, <<"c2">>, <<"c3">>]],
+    0 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    [Rows1, Rows2, Rows3] = [begin
+        RefCursor = dpiCall(TestCtx, data_get, [Data]),
+        ok = dpiCall(TestCtx, stmt_setFetchArraySize, [RefCursor, 100]),
+        #{rows := Rows, moreRows := false} =
+            dpiCall(TestCtx, stmt_fetchRows, [RefCursor, 100]),
+        Rows
+    end || {_, Data} <- Cursors],
+    ?assertEqual(10, length(Rows1)),
+    ?assertEqual([[<<"a">>, <<"b">>]], Rows2),
+    ?assertEqual([], Rows3),
+    [begin
+        dpiCall(TestCtx, data_release, [Data]),
+        dpiCall(TestCtx, var_release, [Var])
+    end || {Var, Data} <- Cursors],
     dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
 
 stmtGetQueryValue(#{session := Conn} = TestCtx) ->
@@ -879,6 +2296,74 @@ stmtDefine(#{session := Conn} = TestCtx) ->
     dpiCall(TestCtx, var_release, [Var]),
     dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
 
+stmtDefineDecimal(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_defineDecimal, [?BAD_REF, 1])
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [
+            Conn, false,
+            <<
+                "select 12345678901234567890123456.7890123456,"
+                " -0.05, 1e38, 42, 1.50, null from dual"
+            >>,
+            <<>>
+        ]
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve uint pos from arg1",
+        dpiCall(TestCtx, stmt_defineDecimal, [Stmt, ?BAD_INT])
+    ),
+    6 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    [ok = dpiCall(TestCtx, stmt_defineDecimal, [Stmt, Pos])
+     || Pos <- lists:seq(1, 6)],
+    ?assertEqual(
+        #{
+            rows => [[
+                {123456789012345678901234567890123456, -10}, {-5, -2},
+                100000000000000000000000000000000000000, 42, {15, -1}, null
+            ]],
+            moreRows => false
+        },
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 10])
+    ),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
+
+stmtSetCharsetMode(#{session := Conn} = TestCtx) ->
+    ?ASSERT_EX(
+        "Unable to retrieve resource statement from arg0",
+        dpiCall(TestCtx, stmt_setCharsetMode, [?BAD_REF, 'DPI_CHARSET_UTF8'])
+    ),
+    Stmt = dpiCall(
+        TestCtx, conn_prepareStmt,
+        [
+            Conn, false,
+            <<"select 'abc', to_char(unistr('\\00e4')), 1 from dual">>, <<>>
+        ]
+    ),
+    ?ASSERT_EX(
+        "Unable to retrieve DPI_CHARSET atom from arg1",
+        dpiCall(TestCtx, stmt_setCharsetMode, [Stmt, badAtom])
+    ),
+    ok = dpiCall(TestCtx, stmt_setCharsetMode, [Stmt, 'DPI_CHARSET_UTF8']),
+    3 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    #{rows := [[<<"abc">>, <<195, 164>>, 1.0]]} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1]),
+    % the session is AL32UTF8, so single byte modes transcode every byte
+    3 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    ok = dpiCall(
+        TestCtx, stmt_setCharsetMode, [Stmt, 'DPI_CHARSET_WE8ISO8859P1']
+    ),
+    #{rows := [[<<"abc">>, <<195, 131, 194, 164>>, 1.0]]} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1]),
+    3 = dpiCall(TestCtx, stmt_execute, [Stmt, []]),
+    ok = dpiCall(TestCtx, stmt_setCharsetMode, [Stmt, 'DPI_CHARSET_NONE']),
+    #{rows := [[<<"abc">>, <<195, 164>>, 1.0]]} =
+        dpiCall(TestCtx, stmt_fetchRows, [Stmt, 1]),
+    dpiCall(TestCtx, stmt_close, [Stmt, <<>>]).
+
 stmtDefineValue(#{session := Conn} = TestCtx) -> 
     ?ASSERT_EX(
         "Unable to retrieve resource statement from arg0",
@@ -938,6 +2423,16 @@ stmtDefineValue(#{session := Conn} = TestCtx) ->
             ]
         )
     ),
+    ?ASSERT_EX(
+        "Unable to retrieve resource objectType or null from arg6",
+        dpiCall(
+            TestCtx, stmt_defineValue,
+            [
+                Stmt, 1, 'DPI_ORACLE_TYPE_NATIVE_INT', 'DPI_NATIVE_TYPE_INT64',
+                0, false, badAtom
+            ]
+        )
+    ),
     dpiCall(TestCtx, stmt_execute, [Stmt, []]),
     ?assertEqual(ok, 
         dpiCall(
@@ -1506,7 +3001,8 @@ resourceCounting(#{context := Context, session := Conn} = TestCtx) ->
     ?assertEqual(5, Conns - IConns),
     ?assertEqual(5, Stmts - IStmts),
     ?assertEqual(5, Datas - IDatas),
-    ?assertEqual(5, DataPtrs - IDataPtrs),
+    % variable elements are handles into a var-owned slab, not resources
+    ?assertEqual(0, DataPtrs - IDataPtrs),
 
     lists:foreach(
         fun({Ctx, LConn, Stmt, #{var := Var}, Data}) ->
@@ -1610,6 +3106,40 @@ dpiCall(#{safe := true, node := Node}, F, A) ->
     end;
 dpiCall(#{safe := false}, F, A) -> apply(dpi, F, A).
 
+% stream messages are only sent to local pids, in safe mode they are
+% relayed from the slave node
+localPid(#{safe := true, node := Node}) ->
+    Self = self(),
+    spawn(Node, fun() -> relay(Self) end);
+localPid(#{safe := false}) ->
+    Self = self(),
+    spawn(fun() -> relay(Self) end).
+
+relay(Pid) ->
+    receive
+        stop -> ok;
+        Msg ->
+            Pid ! Msg,
+            relay(Pid)
+    end.
+
+receiveStream(Ref) ->
+    receive
+        {dpi_stream, Ref, Rows} -> Rows;
+        {dpi_stream_done, Ref} -> done;
+        {dpi_stream_error, Ref, Error} -> error(Error)
+    after 1000 -> timeout
+    end.
+
+receiveScan(_Ref, 0) -> [];
+receiveScan(Ref, Partitions) ->
+    receive
+        {dpi_scan, Ref, P, Rows} -> [{P, Rows} | receiveScan(Ref, Partitions)];
+        {dpi_scan_done, Ref, _} -> receiveScan(Ref, Partitions - 1);
+        {dpi_scan_error, Ref, _, Error} -> error(Error)
+    after 5000 -> error(timeout)
+    end.
+
 getConfig() ->
     case file:get_cwd() of
         {ok, Cwd} ->
@@ -1650,12 +3180,37 @@ getConfig() ->
     ?F(connCommit),
     ?F(connRollback),
     ?F(connPing),
+    ?F(connHealthCheck),
+    ?F(connStmtCacheSize),
+    ?F(connCachedQuery),
+    ?F(connTransaction),
+    ?F(connInjectLatency),
+    ?F(connMemoryLimit),
     ?F(connClose),
     ?F(connGetServerVersion),
     ?F(connSetClientIdentifier),
+    ?F(connSessionAttrs),
     ?F(stmtExecute),
     ?F(stmtExecuteMany_varGetReturnedData),
+    ?F(stmtGetRowCounts_getBatchErrors),
     ?F(stmtFetch),
+    ?F(stmtFetchRows),
+    ?F(stmtStream),
+    ?F(stmtOwner),
+    ?F(stmtSetPrefetch),
+    ?F(scanStart),
+    ?F(routerRoute),
+    ?F(routerScatter),
+    ?F(connSubscribe),
+    ?F(queueEnqDeqMany),
+    ?F(objectCollection),
+    ?F(connNewArrayVar),
+    ?F(connVarPool),
+    ?F(stmtScroll),
+    ?F(stmtGetRowCount),
+    ?F(stmtGetImplicitResult),
+    ?F(stmtFetchArraySize),
+    ?F(stmtRefCursorFetchRows),
     ?F(stmtGetQueryValue),
     ?F(stmtGetQueryInfo),
     ?F(stmtGetInfo),
@@ -1666,6 +3221,8 @@ getConfig() ->
     ?F(stmtBindByName),
     ?F(stmtDefine),
     ?F(stmtDefineValue),
+    ?F(stmtDefineDecimal),
+    ?F(stmtSetCharsetMode),
     ?F(stmtClose),
     ?F(varSetNumElementsInArray),
     ?F(varSetFromBytes),